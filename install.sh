@@ -23,6 +23,9 @@ ninja
 echo "Running unit tests..."
 ./unit_tests
 
+echo "Generating antichess EGTB..."
+./egtb_gen antichess.egtb
+
 # Change cmake settings to not build all executables by default.
 echo "Updating cmake default settings..."
 cmake .. -DBUILD_ALL_EXECUTABLES=OFF
@@ -3,12 +3,16 @@
 #include "compact.h"
 #include "fen.h"
 #include "move.h"
+#include "nnue.h"
 #include "zobrist.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
+#include <utility>
 
 namespace {
 
@@ -66,6 +70,14 @@ Board::Board(const Variant variant, const std::string& fen) {
 
   top->zobrist_key = GenerateZobristKey();
   top->pawn_zobrist_key = GeneratePawnZobristKey();
+  top->psq_score = GeneratePsqScore();
+  top->material_signature = GenerateMaterialSignature();
+  network_ = IsStandard(variant) ? nnue::ActiveNetwork() : nullptr;
+  if (network_) {
+    accumulators_ = std::make_unique_for_overwrite<nnue::Accumulator[]>(
+        MoveStack::kCapacity);
+    accumulators_[0] = GenerateAccumulator();
+  }
 }
 
 Board::Board(const Variant variant, const BoardDesc& board_desc) {
@@ -100,6 +112,60 @@ Board::Board(const Variant variant, const BoardDesc& board_desc) {
 
   top->zobrist_key = GenerateZobristKey();
   top->pawn_zobrist_key = GeneratePawnZobristKey();
+  top->psq_score = GeneratePsqScore();
+  top->material_signature = GenerateMaterialSignature();
+  network_ = IsStandard(variant) ? nnue::ActiveNetwork() : nullptr;
+  if (network_) {
+    accumulators_ = std::make_unique_for_overwrite<nnue::Accumulator[]>(
+        MoveStack::kCapacity);
+    accumulators_[0] = GenerateAccumulator();
+  }
+}
+
+Board::Board(const Board& board) { *this = board; }
+
+Board::Board(Board&& board) noexcept { *this = std::move(board); }
+
+void Board::CopyPosition(const Board& board) {
+  std::copy(std::begin(board.board_array_), std::end(board.board_array_),
+            board_array_);
+  std::copy(std::begin(board.bitboard_sides_), std::end(board.bitboard_sides_),
+            bitboard_sides_);
+  std::copy(std::begin(board.bitboard_pieces_),
+            std::end(board.bitboard_pieces_), bitboard_pieces_);
+  side_to_move_ = board.side_to_move_;
+  castling_allowed_ = board.castling_allowed_;
+  network_ = board.network_;
+  move_stack_ = board.move_stack_;
+}
+
+Board& Board::operator=(const Board& board) {
+  if (this == &board) {
+    return *this;
+  }
+  CopyPosition(board);
+  if (!network_) {
+    accumulators_.reset();
+    return *this;
+  }
+  if (!accumulators_) {
+    accumulators_ = std::make_unique_for_overwrite<nnue::Accumulator[]>(
+        MoveStack::kCapacity);
+  }
+  std::copy_n(board.accumulators_.get(), move_stack_.Size() + 1,
+              accumulators_.get());
+  return *this;
+}
+
+Board& Board::operator=(Board&& board) noexcept {
+  if (this == &board) {
+    return *this;
+  }
+  CopyPosition(board);
+  accumulators_ = std::move(board.accumulators_);
+  // The accumulators are gone, so the network must go too.
+  board.network_ = nullptr;
+  return *this;
 }
 
 void Board::MakeMove(const Move move) {
@@ -120,6 +186,11 @@ void Board::MakeMove(const Move move) {
   top->captured_piece = dest_piece;
   top->zobrist_key = prev->zobrist_key;
   top->pawn_zobrist_key = prev->pawn_zobrist_key;
+  top->psq_score = prev->psq_score;
+  top->material_signature = prev->material_signature;
+  if (network_) {
+    accumulators_[move_stack_.Size()] = accumulators_[move_stack_.Size() - 1];
+  }
   top->castle = prev->castle;
   top->half_move_clock = prev->half_move_clock + 1;
 
@@ -233,6 +304,11 @@ void Board::MakeNullMove() {
   top->ep_index = prev->ep_index;
   top->zobrist_key = prev->zobrist_key;
   top->pawn_zobrist_key = prev->pawn_zobrist_key;
+  top->psq_score = prev->psq_score;
+  top->material_signature = prev->material_signature;
+  if (network_) {
+    accumulators_[move_stack_.Size()] = accumulators_[move_stack_.Size() - 1];
+  }
   top->castle = prev->castle;
   top->half_move_clock = 0;
   FlipSideToMove();
@@ -356,15 +432,56 @@ U64 Board::GeneratePawnZobristKey() {
   return zkey;
 }
 
+psqt::Score Board::GeneratePsqScore() const {
+  psqt::Score psq_score;
+  for (int i = 0; i < BOARD_SIZE; ++i) {
+    if (IsValidPiece(board_array_[i])) {
+      const psqt::Score score = psqt::Get(board_array_[i], i);
+      psq_score.mgame += score.mgame;
+      psq_score.egame += score.egame;
+      psq_score.game_phase += score.game_phase;
+    }
+  }
+  return psq_score;
+}
+
+U64 Board::GenerateMaterialSignature() const {
+  U64 signature = 0;
+  for (int i = 0; i < 12; ++i) {
+    signature |= U64(PopCount(bitboard_pieces_[i])) << (4 * i);
+  }
+  return signature;
+}
+
+nnue::Accumulator Board::GenerateAccumulator() const {
+  nnue::Accumulator accumulator;
+  nnue::Reset(*network_, accumulator);
+  for (int i = 0; i < BOARD_SIZE; ++i) {
+    if (IsValidPiece(board_array_[i])) {
+      nnue::AddPiece(*network_, board_array_[i], i, accumulator);
+    }
+  }
+  return accumulator;
+}
+
 void Board::PlacePiece(const int index, const Piece piece) {
   board_array_[index] = piece;
   const U64 bit_mask = (1ULL << index);
   bitboard_sides_[SideIndex(PieceSide(piece))] |= bit_mask;
   bitboard_pieces_[PieceIndex(piece)] |= bit_mask;
+  MoveStackEntry* top = move_stack_.Top();
   const U64 zob = zobrist::Get(piece, index);
-  move_stack_.Top()->zobrist_key ^= zob;
+  top->zobrist_key ^= zob;
   if (piece == PAWN || piece == -PAWN) {
-    move_stack_.Top()->pawn_zobrist_key ^= zob;
+    top->pawn_zobrist_key ^= zob;
+  }
+  const psqt::Score score = psqt::Get(piece, index);
+  top->psq_score.mgame += score.mgame;
+  top->psq_score.egame += score.egame;
+  top->psq_score.game_phase += score.game_phase;
+  top->material_signature += 1ULL << (4 * PieceIndex(piece));
+  if (network_) {
+    nnue::AddPiece(*network_, piece, index, accumulators_[move_stack_.Size()]);
   }
 }
 
@@ -381,10 +498,20 @@ void Board::RemovePiece(const int index) {
   const U64 bit_mask = ~(1ULL << index);
   bitboard_sides_[SideIndex(PieceSide(piece))] &= bit_mask;
   bitboard_pieces_[PieceIndex(piece)] &= bit_mask;
+  MoveStackEntry* top = move_stack_.Top();
   const U64 zob = zobrist::Get(piece, index);
-  move_stack_.Top()->zobrist_key ^= zob;
+  top->zobrist_key ^= zob;
   if (piece == PAWN || piece == -PAWN) {
-    move_stack_.Top()->pawn_zobrist_key ^= zob;
+    top->pawn_zobrist_key ^= zob;
+  }
+  const psqt::Score score = psqt::Get(piece, index);
+  top->psq_score.mgame -= score.mgame;
+  top->psq_score.egame -= score.egame;
+  top->psq_score.game_phase -= score.game_phase;
+  top->material_signature -= 1ULL << (4 * PieceIndex(piece));
+  if (network_) {
+    nnue::RemovePiece(*network_, piece, index,
+                      accumulators_[move_stack_.Size()]);
   }
 }
 
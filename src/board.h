@@ -4,7 +4,10 @@
 #include "common.h"
 #include "compact.h"
 #include "move.h"
+#include "nnue.h"
+#include "psqt.h"
 
+#include <memory>
 #include <string>
 #include <type_traits>
 
@@ -19,6 +22,14 @@ public:
 
   Board(Variant variant, const BoardDesc& board_desc);
 
+  // Copies are plain copies of the board arrays, plus of the accumulators up
+  // to the current move if the board has a network. Moves take the
+  // accumulators, and leave the moved-from board without a network.
+  Board(const Board& board);
+  Board& operator=(const Board& board);
+  Board(Board&& board) noexcept;
+  Board& operator=(Board&& board) noexcept;
+
   // Moves piece on the board. Does not check for validity of move.
   void MakeMove(Move move);
 
@@ -75,6 +86,30 @@ public:
     return move_stack_.Seek(num_half_moves)->pawn_zobrist_key;
   }
 
+  // Material plus piece-square table scores of the position under
+  // BlessedParams(), from white's point of view, and its game phase. These are
+  // maintained incrementally as moves are made.
+  int PsqMGameScore() const { return move_stack_.Top()->psq_score.mgame; }
+  int PsqEGameScore() const { return move_stack_.Top()->psq_score.egame; }
+  int GamePhase() const { return move_stack_.Top()->psq_score.game_phase; }
+
+  // Number of pieces of each kind on the board, 4 bits each in the order of
+  // PieceIndex(). Maintained incrementally as moves are made, so that
+  // positions can be matched against endgame tables without counting pieces.
+  U64 MaterialSignature() const {
+    return move_stack_.Top()->material_signature;
+  }
+
+  // The network evaluating the board, or null if the board is not of standard
+  // chess or no network was active when it was constructed. See nnue.h.
+  const nnue::Network* Network() const { return network_; }
+
+  // Hidden layer of Network() for the position, maintained incrementally as
+  // moves are made. Only valid if Network() is not null.
+  const nnue::Accumulator& NnueAccumulator() const {
+    return accumulators_[move_stack_.Size()];
+  }
+
   // Returns the board as an FEN (Forsyth-Edwards Notation) string.
   std::string ParseIntoFEN() const;
 
@@ -90,8 +125,9 @@ public:
 
   // WARNING!
   // The below public methods are only useful for EGTB code for offline
-  // processing. They do not handle Zobrist key updates correctly as it is not
-  // required for the EGTB code. For other use cases, handle with care!
+  // processing. They do not handle Zobrist key and piece-square score updates
+  // correctly as it is not required for the EGTB code. For other use cases,
+  // handle with care!
 
   void SetPiece(const int index, const Piece piece) {
     board_array_[index] = piece;
@@ -135,12 +171,21 @@ private:
 
     // Number of half-moves since a pawn move or capture.
     int half_move_clock = 0;
+
+    // Material and piece-square scores and game phase after this move is
+    // played.
+    psqt::Score psq_score;
+
+    // See MaterialSignature().
+    U64 material_signature;
   };
 
   // A thin wrapper around an array of MoveStackEntry elements that provides a
   // stack-like interface. Methods don't check array bounds.
   class MoveStack {
   public:
+    static constexpr int kCapacity = 1000;
+
     void Push() { ++size_; }
 
     void Pop() { --size_; }
@@ -155,7 +200,7 @@ private:
     const MoveStackEntry* Seek(int pos) const { return Top() - pos; }
 
   private:
-    MoveStackEntry entries_[1000];
+    MoveStackEntry entries_[kCapacity];
     int size_ = 0;
   };
 
@@ -165,15 +210,24 @@ private:
 
   U64 GeneratePawnZobristKey();
 
-  // Places piece on the board. Two versions - one updates zobrist key and
-  // another doesn't. It's an error to call these methods if the square given by
-  // index is not empty.
+  psqt::Score GeneratePsqScore() const;
+
+  U64 GenerateMaterialSignature() const;
+
+  nnue::Accumulator GenerateAccumulator() const;
+
+  // Copies everything but the accumulators from board.
+  void CopyPosition(const Board& board);
+
+  // Places piece on the board. Two versions - one updates zobrist keys and
+  // piece-square scores and another doesn't. It's an error to call these
+  // methods if the square given by index is not empty.
   void PlacePiece(int index, Piece piece);
   void PlacePieceNoZ(int index, Piece piece);
 
   // Removes piece from given index on the board. Two versions - one updates
-  // zobrist key and another doesn't. It's an error to call these methods if the
-  // square given by index is not empty.
+  // zobrist keys and piece-square scores and another doesn't. It's an error
+  // to call these methods if the square given by index is not empty.
   void RemovePiece(int index);
   void RemovePieceNoZ(int index);
 
@@ -191,10 +245,15 @@ private:
   // True if the variant allows castling.
   bool castling_allowed_;
 
+  const nnue::Network* network_;
+
   MoveStack move_stack_;
-};
+  static_assert(std::is_trivially_copyable_v<MoveStack>);
 
-static_assert(std::is_trivially_copy_constructible_v<Board> &&
-              std::is_trivially_copy_assignable_v<Board>);
+  // Accumulators of network_ by move stack position, kept apart from the move
+  // stack so that boards without a network do not carry them. Null if there is
+  // no network.
+  std::unique_ptr<nnue::Accumulator[]> accumulators_;
+};
 
 #endif
@@ -0,0 +1,232 @@
+#include "attacks.h"
+#include "board.h"
+#include "common.h"
+#include "eval.h"
+#include "id_search.h"
+#include "move.h"
+#include "move_array.h"
+#include "movegen.h"
+#include "stopwatch.h"
+#include "thread_pool.h"
+#include "timer.h"
+#include "training_data.h"
+#include "transpos.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Generates tuning positions by fixed-depth self-play of standard chess: every
+// thread plays games on its own, searching each move to given depth, and the
+// quiet positions of a game are appended to the output file with their search
+// scores once the game result is known. The tuner reads the file directly,
+// see training_data.h.
+
+namespace {
+
+// Random moves played from the initial position, so that games differ.
+constexpr int kRandomOpeningPlies = 8;
+// Positions of the opening are not recorded.
+constexpr int kMinRecordPly = 16;
+// Games still going after this many plies are drawn.
+constexpr int kMaxPlies = 400;
+// A game is won once the search score stays at least this far from 0 in favour
+// of the same side for kAdjudicatePlies plies in a row.
+constexpr int kAdjudicateScore = 1500;
+constexpr int kAdjudicatePlies = 8;
+constexpr int kTransposMemoryMB = 16;
+
+// True if the position is drawn by the 50 move rule, by repetition (a single
+// repetition is enough here) or because only kings are left.
+bool IsDraw(const Board& board) {
+  if (board.HalfMoveClock() >= 100 || PopCount(board.BitBoard()) == 2) {
+    return true;
+  }
+  const int plies_back = std::min(board.HalfMoveClock(), board.HalfMoves());
+  for (int i = 4; i <= plies_back; i += 2) {
+    if (board.ZobristKey(i) == board.ZobristKey()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+struct Game {
+  // Quiet positions with their scores and the game result.
+  std::vector<PackedPosition> positions;
+  // Result for white: 0, 0.5 or 1.
+  double result = 0.5;
+};
+
+// Plays a game and returns its result and quiet positions.
+Game PlayGame(const int depth, std::mt19937_64& rng) {
+  Board board(Variant::STANDARD);
+  for (int ply = 0; ply < kRandomOpeningPlies; ++ply) {
+    const MoveArray move_array = GenerateMoves<Variant::STANDARD>(board);
+    if (move_array.size() == 0) {
+      // The random opening ended the game, which is scored below.
+      break;
+    }
+    board.MakeMove(move_array.get(rng() % move_array.size()));
+  }
+
+  TranspositionTable transpos(
+      TranspositionTable::SizeForMemory(kTransposMemoryMB));
+  Game game;
+  // Plies in a row scored at least kAdjudicateScore for white if positive, or
+  // for black if negative.
+  int adjudicate_plies = 0;
+  for (int ply = kRandomOpeningPlies; ply < kMaxPlies; ++ply) {
+    const int eval_result = EvalResult<Variant::STANDARD>(board);
+    if (eval_result != UNKNOWN) {
+      if (eval_result != DRAW) {
+        game.result =
+            (eval_result == WIN) == (board.SideToMove() == Side::WHITE) ? 1.0
+                                                                        : 0.0;
+      }
+      break;
+    }
+    if (IsDraw(board)) {
+      break;
+    }
+
+    transpos.SetEpoch(board.HalfMoves());
+    Timer timer;
+    timer.Run();
+    const IDSResult ids_result = IDSearch<Variant::STANDARD>(
+        IDSParams{.search_depth = depth}, board, timer, transpos, nullptr);
+    const Move move = ids_result.best_move;
+    if (!move.is_valid()) {
+      break;
+    }
+    // Forced moves are not searched and have no score.
+    const int score = ids_result.best_move_score;
+    if (score == INF) {
+      board.MakeMove(move);
+      continue;
+    }
+    const int white_score =
+        board.SideToMove() == Side::WHITE ? score : -score;
+
+    const bool quiet = board.PieceAt(move.to_index()) == NULLPIECE &&
+                       !move.is_promotion() &&
+                       !(PieceType(board.PieceAt(move.from_index())) == PAWN &&
+                         move.to_index() == board.EnpassantTarget()) &&
+                       !attacks::InCheck(board, board.SideToMove());
+    if (ply >= kMinRecordPly && quiet && std::abs(score) < kAdjudicateScore) {
+      game.positions.push_back(PackPosition(board, white_score, 0.5));
+    }
+
+    if (white_score >= kAdjudicateScore) {
+      adjudicate_plies = std::max(adjudicate_plies, 0) + 1;
+    } else if (white_score <= -kAdjudicateScore) {
+      adjudicate_plies = std::min(adjudicate_plies, 0) - 1;
+    } else {
+      adjudicate_plies = 0;
+    }
+    if (std::abs(adjudicate_plies) >= kAdjudicatePlies) {
+      game.result = adjudicate_plies > 0 ? 1.0 : 0.0;
+      break;
+    }
+    board.MakeMove(move);
+  }
+
+  for (PackedPosition& position : game.positions) {
+    position.result = static_cast<uint8_t>(game.result * 2);
+  }
+  return game;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2 || argc > 5) {
+    std::cerr << "Expect arguments: <output file> [games] [depth] [threads]\n"
+              << "Eg: ./datagen selfplay.bin 10000 6 8\n"
+              << "Plays games (default 1000) of standard chess against itself, "
+                 "searching every move to depth (default 6), and appends "
+                 "their quiet positions to the output file for the tuner. "
+                 "Plays one game per thread on all cores unless threads is "
+                 "given."
+              << std::endl;
+    return 0;
+  }
+  const int num_games = argc > 2 ? std::stoi(argv[2]) : 1000;
+  const int depth = argc > 3 ? std::stoi(argv[3]) : 6;
+  const int num_threads =
+      argc > 4 ? std::stoi(argv[4])
+               : std::max(1u, std::thread::hardware_concurrency());
+
+  std::unique_ptr<PackedPositionWriter> writer;
+  try {
+    writer = std::make_unique<PackedPositionWriter>(argv[1]);
+  } catch (const std::runtime_error& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::mutex mutex;
+  std::atomic<int> next_game = 0;
+  // Set once the output cannot be written, after which no more games start.
+  std::atomic<bool> failed = false;
+  int games_played = 0;
+  uint64_t num_positions = 0;
+  double results_sum = 0.0;
+  StopWatch stop_watch;
+  stop_watch.Start();
+  const uint64_t seed = std::random_device()();
+
+  ThreadPool thread_pool;
+  thread_pool.Resize(num_threads);
+  thread_pool.Run([&](int) {
+    for (int game_index = next_game++; game_index < num_games && !failed;
+         game_index = next_game++) {
+      std::mt19937_64 rng(seed + game_index);
+      const Game game = PlayGame(depth, rng);
+      std::lock_guard<std::mutex> lock(mutex);
+      if (failed) {
+        return;
+      }
+      for (const PackedPosition& position : game.positions) {
+        writer->Write(position);
+      }
+      ++games_played;
+      num_positions += game.positions.size();
+      results_sum += game.result;
+      if (games_played % 100 == 0 || games_played == num_games) {
+        try {
+          writer->Flush();
+        } catch (const std::runtime_error& e) {
+          std::cerr << "ERROR: " << e.what() << std::endl;
+          failed = true;
+          return;
+        }
+        const double hours = stop_watch.ElapsedTime() / 100 / 3600;
+        std::cout << "Games: " << games_played
+                  << ", positions: " << num_positions
+                  << ", positions/hour: " << uint64_t(num_positions / hours)
+                  << ", white score: " << results_sum / games_played
+                  << std::endl;
+      }
+    }
+  });
+  thread_pool.Wait();
+  if (failed) {
+    return 1;
+  }
+  try {
+    writer->Flush();
+  } catch (const std::runtime_error& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -2,53 +2,35 @@
 #include "board.h"
 #include "common.h"
 #include "compact.h"
+#include "egtb_generator.h"
+#include "egtb_index.h"
 #include "eval.h"
 #include "move.h"
 #include "move_array.h"
 #include "movegen.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
 #include <cstdint>
-#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
 #include <iostream>
 #include <list>
-#include <memory>
-#include <set>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <vector>
 
-constexpr int piece_primes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
-
-int ComputeBoardDescriptionId(const Board& board) {
-  U64 bitboard = board.BitBoard();
-  int value = 1;
-  while (bitboard) {
-    const int lsb_index = Lsb1(bitboard);
-    value *= piece_primes[PieceIndex(board.PieceAt(lsb_index))];
-    bitboard ^= (1ULL << lsb_index);
-  }
-  return value;
-}
-
-U64 ComputeEGTBIndex(const Board& board) {
-  U64 index = 0, half_space = 1;
-  int num_pieces = 0;
-  for (Piece piece = -PAWN; piece <= PAWN; ++piece) {
-    if (piece == NULLPIECE)
-      continue;
-    U64 piece_bitboard = board.BitBoard(piece);
-    while (piece_bitboard) {
-      const int lsb_index = Lsb1(piece_bitboard);
-      index = 64 * index + lsb_index;
-      half_space *= 64;
-      ++num_pieces;
-      piece_bitboard ^= (1ULL << lsb_index);
-    }
-  }
-  index = SideIndex(board.SideToMove()) * half_space + index;
-  return index;
-}
+using egtb::Entry;
+using egtb::MaterialKey;
+using egtb::Result;
 
 int EGTBResult(const EGTBIndexEntry& entry) {
   if (entry.result == 1) {
@@ -62,272 +44,560 @@ int EGTBResult(const EGTBIndexEntry& entry) {
   }
 }
 
-class EGTBStore {
-public:
-  EGTBIndexEntry* Get(const Board& board) {
-    if (board.EnpassantTarget() != NO_EP)
-      return nullptr;
-    int board_desc_id = ComputeBoardDescriptionId(board);
-    if (store_.find(board_desc_id) == store_.end()) {
-      return nullptr;
+namespace egtb {
+
+namespace {
+
+// Entries are read atomically, as the table being generated is written by all
+// generator threads at once.
+Entry LoadEntry(const Entry& entry) {
+  return std::atomic_ref<Entry>(const_cast<Entry&>(entry))
+      .load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+} // namespace egtb
+
+namespace {
+
+// Returns the entry of the position on board, taking the entries of positions
+// without en passant captures from get_entry(board).
+template <typename GetEntry>
+Entry ProbeWith(Board& board, const GetEntry& get_entry) {
+  if (board.EnpassantTarget() != NO_EP) {
+    const MoveArray move_array = GenerateMoves<Variant::ANTICHESS>(board);
+    const int num_pieces = PopCount(board.BitBoard());
+    bool captures = false;
+    if (move_array.size()) {
+      board.MakeMove(move_array.get(0));
+      captures = PopCount(board.BitBoard()) < num_pieces;
+      board.UnmakeLastMove();
     }
-    U64 index = ComputeEGTBIndex(board);
-    auto elem = store_[board_desc_id].find(index);
-    if (elem == store_[board_desc_id].end()) {
-      return nullptr;
+    if (captures) {
+      int best_win = INT_MAX;
+      int worst_loss = 0;
+      bool all_won = true;
+      bool all_known = true;
+      for (size_t i = 0; i < move_array.size(); ++i) {
+        board.MakeMove(move_array.get(i));
+        const Entry entry = ProbeWith(board, get_entry);
+        board.UnmakeLastMove();
+        switch (egtb::EntryResult(entry)) {
+        case Result::LOST:
+          best_win = std::min(best_win, egtb::EntryPliesToEnd(entry) + 1);
+          all_won = false;
+          break;
+        case Result::WON:
+          worst_loss = std::max(worst_loss, egtb::EntryPliesToEnd(entry) + 1);
+          break;
+        case Result::DRAWN:
+          all_won = false;
+          break;
+        case Result::NONE:
+          all_won = false;
+          all_known = false;
+          break;
+        }
+      }
+      if (best_win != INT_MAX) {
+        return egtb::MakeEntry(Result::WON, best_win);
+      } else if (all_won) {
+        return egtb::MakeEntry(Result::LOST, worst_loss);
+      }
+      return egtb::MakeEntry(all_known ? Result::DRAWN : Result::NONE, 0);
     }
-    return &elem->second;
+    // Without captures the en passant target does not change the moves.
   }
+  return get_entry(board);
+}
 
-  void Put(const Board& board, int moves_to_end, Move next_move,
-           int8_t result) {
-    EGTBIndexEntry e;
-    e.moves_to_end = moves_to_end;
-    e.next_move = next_move;
-    e.result = result;
-    int board_desc_id = ComputeBoardDescriptionId(board);
-    U64 index = ComputeEGTBIndex(board);
-    assert(store_[board_desc_id].find(index) == store_[board_desc_id].end());
-    store_[board_desc_id][index] = e;
-  }
+} // namespace
 
-  void MergeFrom(EGTBStore store) {
-    const auto& egtb_map = store.GetMap();
-    for (const auto& elem : egtb_map) {
-      for (const auto& elem2 : elem.second) {
-        assert(store_[elem.first].find(elem2.first) ==
-               store_[elem.first].end());
-        store_[elem.first][elem2.first] = elem2.second;
-      }
+egtb::Entry egtb::Probe(const Tables& tables, Board& board) {
+  return ProbeWith(board, [&tables](const Board& board) {
+    const auto table = tables.find(CanonicalKey(GetMaterialKey(board)));
+    if (table == tables.end()) {
+      return MakeEntry(Result::NONE, 0);
     }
-  }
+    return LoadEntry(table->second.entries[table->second.indexer.Index(board)]);
+  });
+}
 
-  const std::unordered_map<int, std::unordered_map<uint64_t, EGTBIndexEntry>>&
-  GetMap() {
-    return store_;
-  }
+namespace {
 
-private:
-  std::unordered_map<int, std::unordered_map<uint64_t, EGTBIndexEntry>> store_;
+// Layout of an EGTB file: a header, then one TableInfo for each material in
+// egtb::GenerationOrder(), then the tables. The entries of a table, indexed
+// by egtb::TableIndexer, are split into blocks of EGTB::kBlockSize entries
+// and each block is compressed twice: once for the results alone and once for
+// the plies to the end. A table is laid out as its result blocks, the offsets
+// of the result blocks, its plies blocks and the offsets of the plies blocks.
+// Offsets are from the start of the file, one more than there are blocks so
+// that the last one gives the end of the last block.
+//
+// A result block starts with its format: kRawBlock for 2 bits per entry, or
+// kRunLengthBlock for runs of entries with equal results, a byte each with the
+// result in the low 2 bits and the length less one in the high 6 bits. A plies
+// block has the plies to the end of the won and lost entries of the block, in
+// order, after a format of kBytePlies or kShortPlies for 1 or 2 bytes each.
+struct EGTBFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t block_size;
+  uint32_t max_pieces;
+  uint32_t num_tables;
 };
 
-void EGTBGenerate(std::list<BoardDesc> all_pos_list, EGTBStore* store) {
-  const size_t init_pos = all_pos_list.size();
-  for (auto iter = all_pos_list.begin(); iter != all_pos_list.end();) {
-    Board board(Variant::ANTICHESS, *iter);
-    int result = EvalResult<Variant::ANTICHESS>(board);
-    if (result == WIN) {
-      store->Put(board, 0, Move(), 1);
-      iter = all_pos_list.erase(iter);
-    } else if (result == -WIN) {
-      store->Put(board, 0, Move(), -1);
-      iter = all_pos_list.erase(iter);
-    } else if (result == DRAW) {
-      store->Put(board, 0, Move(), 0);
-      iter = all_pos_list.erase(iter);
-    } else {
-      ++iter;
+struct EGTBTableInfo {
+  uint64_t material_key;
+  uint64_t num_entries;
+  // From the start of the file.
+  uint64_t wdl_offsets;
+  uint64_t dtm_offsets;
+};
+
+constexpr char kEGTBMagic[8] = {'N', 'K', 'E', 'G', 'T', 'B', '\0', '\0'};
+constexpr uint32_t kEGTBVersion = 3;
+
+constexpr uint8_t kRawBlock = 0;
+constexpr uint8_t kRunLengthBlock = 1;
+constexpr uint8_t kBytePlies = 0;
+constexpr uint8_t kShortPlies = 1;
+
+// Tables generated when there is no EGTB file.
+constexpr int kGeneratedMaxPieces = 2;
+
+// Number of result blocks each thread keeps in its own cache.
+constexpr int kLocalWDLBlocks = 64;
+
+// Source of EGTB::id_.
+std::atomic<uint64_t> next_egtb_id = 1;
+
+std::runtime_error EGTBError(const std::string& path, const std::string& what) {
+  return std::runtime_error("EGTB " + path + ": " + what);
+}
+
+void Append(std::string* out, const void* data, const size_t size) {
+  out->append(static_cast<const char*>(data), size);
+}
+
+// Appends the result blocks and then the plies blocks of entries to image,
+// each followed by their offsets, and sets the offsets of table_info.
+void AppendCompressedTable(const std::vector<Entry>& entries,
+                           const size_t block_size, std::string* image,
+                           EGTBTableInfo* table_info) {
+  const auto align = [image] { image->resize((image->size() + 7) & ~7ULL); };
+  const uint64_t num_blocks = (entries.size() + block_size - 1) / block_size;
+  std::vector<uint64_t> offsets;
+
+  for (uint64_t block = 0; block < num_blocks; ++block) {
+    offsets.push_back(image->size());
+    const uint64_t begin = block * block_size;
+    const uint64_t end = std::min<uint64_t>(entries.size(), begin + block_size);
+    std::string runs(1, kRunLengthBlock);
+    for (uint64_t i = begin; i < end;) {
+      const Result result = egtb::EntryResult(entries[i]);
+      uint64_t length = 1;
+      while (length < 64 && i + length < end &&
+             egtb::EntryResult(entries[i + length]) == result) {
+        ++length;
+      }
+      runs += static_cast<char>(static_cast<uint8_t>(result) |
+                                ((length - 1) << 2));
+      i += length;
     }
+    std::string raw(1 + (end - begin + 3) / 4, '\0');
+    raw[0] = kRawBlock;
+    for (uint64_t i = begin; i < end; ++i) {
+      raw[1 + (i - begin) / 4] |= static_cast<char>(
+          static_cast<uint8_t>(egtb::EntryResult(entries[i]))
+          << (2 * ((i - begin) % 4)));
+    }
+    *image += runs.size() < raw.size() ? runs : raw;
   }
+  offsets.push_back(image->size());
+  align();
+  table_info->wdl_offsets = image->size();
+  Append(image, offsets.data(), offsets.size() * sizeof(uint64_t));
 
-  int superbest = 0;
-  int s = 0;
-  for (;; ++s) {
-    EGTBStore temp_store;
-    bool deleted = false;
-    for (auto iter = all_pos_list.begin(); iter != all_pos_list.end();) {
-      Board board(Variant::ANTICHESS, *iter);
-      MoveArray movelist = GenerateMoves<Variant::ANTICHESS>(board);
-      int count_winning = 0;
-      int count_losing = 0;
-      int count_draw = 0;
-      int best_winning = 10000;
-      int best_losing = -1;
-      int best_draw = 10000;
-      Move best_winning_move;
-      Move best_losing_move;
-      Move best_draw_move;
-      for (size_t i = 0; i < movelist.size(); ++i) {
-        const Move move = movelist.get(i);
-        board.MakeMove(move);
-        EGTBIndexEntry* e = store->Get(board);
-        if (e != nullptr) {
-          if (e->result == -1) {
-            if (e->moves_to_end + 1 < best_winning) {
-              best_winning = e->moves_to_end + 1;
-              best_winning_move = move;
-            }
-            ++count_winning;
-          } else if (e->result == 1) {
-            if (e->moves_to_end + 1 > best_losing) {
-              best_losing = e->moves_to_end + 1;
-              best_losing_move = move;
-            }
-            ++count_losing;
-          } else if (e->result == 0) {
-            if (e->moves_to_end + 1 < best_draw) {
-              best_draw = e->moves_to_end + 1;
-              best_draw_move = move;
-            }
-            ++count_draw;
-          } else {
-            assert(false);
-          }
-        }
-        board.UnmakeLastMove();
+  offsets.clear();
+  for (uint64_t block = 0; block < num_blocks; ++block) {
+    offsets.push_back(image->size());
+    const uint64_t begin = block * block_size;
+    const uint64_t end = std::min<uint64_t>(entries.size(), begin + block_size);
+    std::vector<uint16_t> plies;
+    for (uint64_t i = begin; i < end; ++i) {
+      const Result result = egtb::EntryResult(entries[i]);
+      if (result == Result::WON || result == Result::LOST) {
+        plies.push_back(egtb::EntryPliesToEnd(entries[i]));
       }
-      if (count_winning >= 1) {
-        if (best_winning > superbest)
-          superbest = best_winning;
-        temp_store.Put(board, best_winning, best_winning_move, 1);
-        iter = all_pos_list.erase(iter);
-        deleted = true;
-      } else if (count_losing == int(movelist.size())) {
-        if (best_losing > superbest)
-          superbest = best_losing;
-        temp_store.Put(board, best_losing, best_losing_move, -1);
-        iter = all_pos_list.erase(iter);
-        deleted = true;
-      } else if (count_draw >= 1 &&
-                 (count_losing + count_draw == int(movelist.size()))) {
-        if (best_draw > superbest)
-          superbest = best_draw;
-        temp_store.Put(board, best_draw, best_draw_move, 0);
-        iter = all_pos_list.erase(iter);
-        deleted = true;
-      } else {
-        ++iter;
+    }
+    if (std::all_of(plies.begin(), plies.end(),
+                    [](const uint16_t p) { return p <= UINT8_MAX; })) {
+      *image += static_cast<char>(kBytePlies);
+      for (const uint16_t p : plies) {
+        *image += static_cast<char>(p);
       }
+    } else {
+      *image += static_cast<char>(kShortPlies);
+      Append(image, plies.data(), plies.size() * sizeof(uint16_t));
     }
-    if (!deleted)
-      break;
-    store->MergeFrom(temp_store);
   }
-  std::cout << "# [EGTB gen] debug info: #iters: " << s
-            << ", max moves_to_end: " << superbest
-            << ", inserted: " << init_pos - all_pos_list.size()
-            << ", discarded: " << all_pos_list.size() << std::endl;
+  offsets.push_back(image->size());
+  align();
+  table_info->dtm_offsets = image->size();
+  Append(image, offsets.data(), offsets.size() * sizeof(uint64_t));
 }
 
-void GeneratePermutations(const std::vector<Piece>& pieces,
-                          const std::vector<Side>& next_player_sides,
-                          size_t start_index, Board* board,
-                          std::set<BoardDesc>* permutations) {
-  if (start_index == pieces.size()) {
-    for (const Side side : next_player_sides) {
-      board->SetPlayerColor(side);
-      permutations->insert(board->ToCompactBoardDesc());
-    }
+// Generates the tables of up to max_pieces pieces and returns the image of
+// their EGTB file.
+std::string MakeEGTBImage(const int max_pieces, const int num_threads,
+                          const size_t block_size, std::ostream& out) {
+  const std::vector<MaterialKey> keys = egtb::GenerationOrder(max_pieces);
+  EGTBFileHeader header = {};
+  std::memcpy(header.magic, kEGTBMagic, sizeof(kEGTBMagic));
+  header.version = kEGTBVersion;
+  header.block_size = block_size;
+  header.max_pieces = max_pieces;
+  header.num_tables = keys.size();
+  std::string image;
+  Append(&image, &header, sizeof(header));
+  // Filled in as the tables are laid out.
+  image.resize(image.size() + keys.size() * sizeof(EGTBTableInfo));
+
+  // Tables stay in memory uncompressed, as later tables depend on them.
+  egtb::Tables tables;
+  std::list<std::vector<Entry>> storage;
+  egtb::Generator generator(num_threads, &tables, &storage);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const egtb::TableStats stats = generator.Generate(keys[i]);
+    out << "# [EGTB gen] " << egtb::MaterialName(keys[i])
+        << ": wins: " << stats.wins << ", losses: " << stats.losses
+        << ", draws: " << stats.draws
+        << ", max plies to end: " << stats.max_plies << std::endl;
+    EGTBTableInfo table_info = {.material_key = keys[i],
+                                .num_entries = storage.back().size()};
+    AppendCompressedTable(storage.back(), block_size, &image, &table_info);
+    std::memcpy(image.data() + sizeof(header) + i * sizeof(EGTBTableInfo),
+                &table_info, sizeof(table_info));
+  }
+  return image;
+}
+
+} // namespace
+
+EGTB::~EGTB() {
+  if (mapped_) {
+    munmap(mapped_, mapped_size_);
+  }
+}
+
+void EGTB::Initialize(const std::string& path) {
+  if (initialized_) {
     return;
   }
-  Piece piece = pieces.at(start_index);
-  for (int i = 0; i < 8; i++) {
-    if (PieceType(piece) == PAWN && (i == 0 || i == 7)) {
-      continue;
+  const int fd = path.empty() ? -1 : open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cout << "# [EGTB gen] generating antichess EGTB of up to "
+              << kGeneratedMaxPieces << " pieces..." << std::endl;
+    generated_ =
+        MakeEGTBImage(kGeneratedMaxPieces, 1, kBlockSize, nullstream);
+    IndexTables(generated_.data(), generated_.size());
+    max_pieces_ = kGeneratedMaxPieces;
+  } else {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < off_t(sizeof(EGTBFileHeader))) {
+      close(fd);
+      throw EGTBError(path, "cannot read header");
+    }
+    mapped_size_ = st.st_size;
+    mapped_ = mmap(nullptr, mapped_size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped_ == MAP_FAILED) {
+      mapped_ = nullptr;
+      throw EGTBError(path, strerror(errno));
     }
-    for (int j = 0; j < 8; j++) {
-      if (board->PieceAt(i, j) == NULLPIECE) {
-        board->SetPiece(INDX(i, j), piece);
-        GeneratePermutations(pieces, next_player_sides, start_index + 1, board,
-                             permutations);
-        board->SetPiece(INDX(i, j), NULLPIECE);
+    try {
+      const auto* header = static_cast<const EGTBFileHeader*>(mapped_);
+      if (std::memcmp(header->magic, kEGTBMagic, sizeof(kEGTBMagic)) != 0 ||
+          header->version != kEGTBVersion ||
+          header->block_size != kBlockSize ||
+          header->max_pieces > uint32_t(egtb::MAX_PIECES)) {
+        throw std::runtime_error("not an EGTB file of this engine version");
       }
+      IndexTables(static_cast<const char*>(mapped_), mapped_size_);
+      max_pieces_ = header->max_pieces;
+    } catch (const std::runtime_error& e) {
+      tables_.clear();
+      munmap(mapped_, mapped_size_);
+      mapped_ = nullptr;
+      throw EGTBError(path, e.what());
     }
+    std::cout << "# Loaded EGTB of up to " << max_pieces_ << " pieces from "
+              << path << std::endl;
   }
+  initialized_ = true;
 }
 
-void All1p(std::set<BoardDesc>* positions) {
-  Board board(Variant::ANTICHESS, "8/8/8/8/8/8/8/8 w - -");
-  for (Piece piece = KING; piece <= PAWN; ++piece) {
-    GeneratePermutations({piece}, {Side::BLACK}, 0, &board, positions);
-    GeneratePermutations({-piece}, {Side::WHITE}, 0, &board, positions);
+void EGTB::IndexTables(const char* data, const size_t size) {
+  const auto* header = reinterpret_cast<const EGTBFileHeader*>(data);
+  const auto* table_infos =
+      reinterpret_cast<const EGTBTableInfo*>(data + sizeof(EGTBFileHeader));
+  if (sizeof(EGTBFileHeader) + header->num_tables * sizeof(EGTBTableInfo) >
+      size) {
+    throw std::runtime_error("truncated table directory");
+  }
+  data_ = data;
+  id_ = next_egtb_id++;
+  for (uint32_t i = 0; i < header->num_tables; ++i) {
+    const EGTBTableInfo& table_info = table_infos[i];
+    const egtb::TableIndexer indexer(table_info.material_key);
+    const uint64_t num_blocks =
+        (table_info.num_entries + kBlockSize - 1) / kBlockSize;
+    const uint64_t offsets_size = (num_blocks + 1) * sizeof(uint64_t);
+    if (table_info.num_entries != indexer.Size() ||
+        table_info.wdl_offsets + offsets_size > size ||
+        table_info.dtm_offsets + offsets_size > size) {
+      throw std::runtime_error("truncated table");
+    }
+    const auto* wdl_offsets =
+        reinterpret_cast<const uint64_t*>(data + table_info.wdl_offsets);
+    const auto* dtm_offsets =
+        reinterpret_cast<const uint64_t*>(data + table_info.dtm_offsets);
+    // Every block is in the image, holds at least its format byte, and holds
+    // no more bytes than its entries take in the least compact format, so
+    // that decoding a block reads neither past it nor past the image.
+    const auto valid_blocks = [num_blocks, size](const uint64_t* offsets,
+                                                 const uint64_t max_bytes) {
+      for (uint64_t block = 0; block < num_blocks; ++block) {
+        if (offsets[block] >= offsets[block + 1] ||
+            offsets[block + 1] - offsets[block] > max_bytes) {
+          return false;
+        }
+      }
+      return offsets[num_blocks] <= size;
+    };
+    if (!valid_blocks(wdl_offsets, 1 + kBlockSize) ||
+        !valid_blocks(dtm_offsets, 1 + 2 * kBlockSize)) {
+      throw std::runtime_error("corrupt or truncated table");
+    }
+    tables_.emplace(table_info.material_key,
+                    CompressedTable{.indexer = indexer,
+                                    .id = i,
+                                    .wdl_offsets = wdl_offsets,
+                                    .dtm_offsets = dtm_offsets});
   }
 }
 
-void All2p(std::set<BoardDesc>* positions) {
-  Board board(Variant::ANTICHESS, "8/8/8/8/8/8/8/8 w - -");
-  for (Piece piece = KING; piece <= PAWN; ++piece) {
-    for (Piece piece2 = KING; piece2 <= PAWN; ++piece2) {
-      GeneratePermutations({piece, piece2}, {Side::BLACK}, 0, &board,
-                           positions);
-      GeneratePermutations({-piece, -piece2}, {Side::WHITE}, 0, &board,
-                           positions);
-      GeneratePermutations({piece, -piece2}, {Side::BLACK, Side::WHITE}, 0,
-                           &board, positions);
+std::shared_ptr<const EGTB::WDLBlock>
+EGTB::GetWDLBlock(const CompressedTable& table, const uint64_t block) {
+  const uint64_t key = (uint64_t(table.id) << 32) | block;
+  std::shared_ptr<const WDLBlock> cached = wdl_cache_.Get(key);
+  if (cached) {
+    return cached;
+  }
+  stats_.Add(BLOCK_MISSES);
+  auto wdl_block = std::make_shared<WDLBlock>();
+  const auto* begin =
+      reinterpret_cast<const uint8_t*>(data_ + table.wdl_offsets[block]);
+  const auto* end =
+      reinterpret_cast<const uint8_t*>(data_ + table.wdl_offsets[block + 1]);
+  // IndexTables() checked the size of the block, but not its contents, so
+  // decoding stops at the end of the block either way.
+  if (*begin == kRunLengthBlock) {
+    size_t i = 0;
+    for (const uint8_t* run = begin + 1; run < end && i < kBlockSize; ++run) {
+      const size_t length = std::min<size_t>((*run >> 2) + 1, kBlockSize - i);
+      std::fill_n(wdl_block->begin() + i, length, *run & 3);
+      i += length;
+    }
+  } else {
+    const size_t num_entries =
+        std::min<size_t>(4 * size_t(end - begin - 1), kBlockSize);
+    for (size_t i = 0; i < num_entries; ++i) {
+      (*wdl_block)[i] = (begin[1 + i / 4] >> (2 * (i % 4))) & 3;
     }
   }
+  wdl_cache_.Put(key, wdl_block);
+  return wdl_block;
 }
 
-std::unique_ptr<EGTBStore> Generate() {
-  std::set<BoardDesc> positions;
-  All1p(&positions);
-  All2p(&positions);
-  auto positions_list =
-      std::list<BoardDesc>(positions.begin(), positions.end());
-  positions.clear();
-  std::cout << "# [EGTB gen] generating Antichess 2 piece EGTB..." << std::endl;
-  auto store = std::make_unique<EGTBStore>();
-  EGTBGenerate(positions_list, store.get());
-  return store;
+const EGTB::WDLBlock& EGTB::GetLocalWDLBlock(const CompressedTable& table,
+                                            const uint64_t block) {
+  struct Slot {
+    uint64_t egtb_id = 0;
+    uint64_t key = 0;
+    std::shared_ptr<const WDLBlock> wdl_block;
+  };
+  // Direct mapped by key, and shared by the EGTB instances the thread probes.
+  thread_local std::array<Slot, kLocalWDLBlocks> slots;
+  const uint64_t key = (uint64_t(table.id) << 32) | block;
+  Slot& slot = slots[(key * 0x9E3779B97F4A7C15ULL >> 32) % kLocalWDLBlocks];
+  if (slot.egtb_id != id_ || slot.key != key || !slot.wdl_block) {
+    slot.wdl_block = GetWDLBlock(table, block);
+    slot.egtb_id = id_;
+    slot.key = key;
+  }
+  return *slot.wdl_block;
 }
 
-void EGTB::Initialize() {
-  if (initialized_) {
-    return;
+std::shared_ptr<const EGTB::DTMBlock>
+EGTB::GetDTMBlock(const CompressedTable& table, const uint64_t block) {
+  const uint64_t key = (uint64_t(table.id) << 32) | block;
+  std::shared_ptr<const DTMBlock> cached = dtm_cache_.Get(key);
+  if (cached) {
+    return cached;
   }
-  auto egtb_store = Generate();
-  for (const auto& elem : egtb_store->GetMap()) {
-    const int board_desc_id = elem.first;
-    const auto& store_map = elem.second;
-    assert(egtb_index_.find(board_desc_id) == egtb_index_.end());
-    uint64_t max_index_val = 0;
-    for (const auto& elem2 : store_map) {
-      if (elem2.first > max_index_val) {
-        max_index_val = elem2.first;
+  const std::shared_ptr<const WDLBlock> wdl_block = GetWDLBlock(table, block);
+  auto dtm_block = std::make_shared<DTMBlock>();
+  const auto* plies =
+      reinterpret_cast<const uint8_t*>(data_ + table.dtm_offsets[block]);
+  const auto* plies_end =
+      reinterpret_cast<const uint8_t*>(data_ + table.dtm_offsets[block + 1]);
+  const bool short_plies = *plies++ == kShortPlies;
+  const ptrdiff_t plies_size = short_plies ? sizeof(uint16_t) : 1;
+  for (int i = 0; i < kBlockSize; ++i) {
+    const Result result = static_cast<Result>((*wdl_block)[i]);
+    int plies_to_end = 0;
+    // A block with fewer plies than wins and losses is corrupt, and the
+    // entries past its end are left at 0 plies.
+    if ((result == Result::WON || result == Result::LOST) &&
+        plies_end - plies >= plies_size) {
+      if (short_plies) {
+        uint16_t value;
+        std::memcpy(&value, plies, sizeof(value));
+        plies_to_end = value;
+        plies += sizeof(value);
+      } else {
+        plies_to_end = *plies++;
       }
     }
-    auto& v = egtb_index_[board_desc_id];
-    v.resize(static_cast<size_t>(max_index_val) + 1);
-    for (const auto& elem2 : store_map) {
-      v[elem2.first] = elem2.second;
-    }
+    (*dtm_block)[i] = egtb::MakeEntry(result, plies_to_end);
   }
-  initialized_ = true;
+  dtm_cache_.Put(key, dtm_block);
+  return dtm_block;
 }
 
-const EGTBIndexEntry* EGTB::Lookup(const Board& board) {
+Entry EGTB::ProbeTable(const Board& board, const bool with_plies) {
+  const auto it = tables_.find(egtb::CanonicalKey(board.MaterialSignature()));
+  if (it == tables_.end()) {
+    return egtb::MakeEntry(Result::NONE, 0);
+  }
+  const CompressedTable& table = it->second;
+  const uint64_t index = table.indexer.Index(board);
+  if (with_plies) {
+    return (*GetDTMBlock(table, index / kBlockSize))[index % kBlockSize];
+  }
+  return egtb::MakeEntry(
+      static_cast<Result>(
+          GetLocalWDLBlock(table, index / kBlockSize)[index % kBlockSize]),
+      0);
+}
+
+Entry EGTB::Probe(Board& board, const bool with_plies) {
+  return ProbeWith(board, [this, with_plies](const Board& board) {
+    return ProbeTable(board, with_plies);
+  });
+}
+
+int EGTB::ProbeWDL(const Board& board) {
+  assert(initialized_);
+  if (board.EnpassantTarget() != NO_EP) {
+    return UNKNOWN;
+  }
+  switch (egtb::EntryResult(ProbeTable(board, false))) {
+  case Result::WON:
+    stats_.Add(HITS);
+    return WIN;
+  case Result::LOST:
+    stats_.Add(HITS);
+    return -WIN;
+  case Result::DRAWN:
+    stats_.Add(HITS);
+    return DRAW;
+  case Result::NONE:
+    break;
+  }
+  stats_.Add(MISSES);
+  return UNKNOWN;
+}
+
+std::optional<EGTBIndexEntry> EGTB::Lookup(Board& board) {
   assert(initialized_);
-  int board_desc_id = ComputeBoardDescriptionId(board);
-  auto v = egtb_index_.find(board_desc_id);
-  if (v == egtb_index_.end()) {
-    return nullptr;
+  if (PopCount(board.BitBoard()) > max_pieces_) {
+    return std::nullopt;
+  }
+  const Entry entry = Probe(board, false);
+  const Result result = egtb::EntryResult(entry);
+  if (result == Result::NONE) {
+    stats_.Add(MISSES);
+    return std::nullopt;
   }
-  U64 index = ComputeEGTBIndex(board);
-  if (index >= v->second.size()) {
-    return nullptr;
+  stats_.Add(HITS);
+  return EGTBIndexEntry{
+      .moves_to_end = 0,
+      .next_move = Move(),
+      .result = static_cast<int8_t>(result == Result::WON    ? 1
+                                    : result == Result::LOST ? -1
+                                                             : 0)};
+}
+
+std::optional<EGTBIndexEntry> EGTB::LookupWithMove(Board& board) {
+  std::optional<EGTBIndexEntry> entry = Lookup(board);
+  if (!entry) {
+    return entry;
+  }
+  entry->moves_to_end = egtb::EntryPliesToEnd(Probe(board, true));
+  // The move leads to the position with the opposite result and one ply less
+  // to the end, or to a drawn position.
+  const Entry best_child =
+      entry->result == 0
+          ? egtb::MakeEntry(Result::DRAWN, 0)
+          : egtb::MakeEntry(entry->result == 1 ? Result::LOST : Result::WON,
+                            entry->moves_to_end - 1);
+  const MoveArray move_array = GenerateMoves<Variant::ANTICHESS>(board);
+  for (size_t i = 0; i < move_array.size(); ++i) {
+    board.MakeMove(move_array.get(i));
+    const Entry child = Probe(board, true);
+    board.UnmakeLastMove();
+    if (child == best_child) {
+      entry->next_move = move_array.get(i);
+      break;
+    }
+  }
+  return entry;
+}
+
+void WriteEGTBFile(const std::string& path, const int max_pieces,
+                   const int num_threads) {
+  if (max_pieces < 1 || max_pieces > egtb::MAX_PIECES) {
+    throw EGTBError(path, "tables of up to " +
+                              std::to_string(egtb::MAX_PIECES) +
+                              " pieces are supported");
   }
-  EGTBIndexEntry& entry = v->second.at(index);
-  if (!entry.next_move.is_valid()) {
-    ++egtb_misses_;
-    return nullptr;
+  const std::string image =
+      MakeEGTBImage(max_pieces, num_threads, EGTB::kBlockSize, std::cout);
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(image.data(), image.size());
+  out.close();
+  if (!out) {
+    throw EGTBError(path, "write failed");
   }
-  ++egtb_hits_;
-  return &entry;
 }
 
 void EGTB::LogStats() {
   assert(initialized_);
-  std::cout << "# EGTB hits: " << egtb_hits_ << std::endl;
-  std::cout << "# EGTB misses: " << egtb_misses_ << std::endl;
+  std::cout << "# EGTB hits: " << stats_.Sum(HITS) << std::endl;
+  std::cout << "# EGTB misses: " << stats_.Sum(MISSES) << std::endl;
+  std::cout << "# EGTB block cache misses: " << stats_.Sum(BLOCK_MISSES)
+            << std::endl;
 }
 
 void PrintEGTBIndexEntry(const EGTBIndexEntry& entry) {
-  if (!entry.next_move.is_valid()) {
-    std::cout << "# EGTBIndexEntry object not valid." << std::endl;
-    return;
+  if (entry.next_move.is_valid()) {
+    std::cout << "# EGTB best move: " << entry.next_move.str() << std::endl;
   }
-  std::cout << "# EGTB best move: " << entry.next_move.str() << std::endl;
-  std::cout << "# Moves to end: " << entry.moves_to_end << std::endl;
+  std::cout << "# Plies to end: " << entry.moves_to_end << std::endl;
   std::string result = "Unknown";
   if (entry.result == 1) {
     result = "Win";
@@ -339,11 +609,24 @@ void PrintEGTBIndexEntry(const EGTBIndexEntry& entry) {
   std::cout << "# Result for side to move: " << result << std::endl;
 }
 
+namespace {
+std::string egtb_file = "antichess.egtb";
+} // namespace
+
+void SetEGTBFile(const std::string& path) { egtb_file = path; }
+
 EGTB* GetEGTB(const Variant variant) {
-  if (IsAntichessLike(variant)) {
+  // The tables are of antichess, where a side without moves wins. In suicide
+  // such a side may lose or draw, so its positions would be misjudged.
+  if (IsAntichess(variant)) {
     static EGTB* antichess_egtb = [] {
       auto egtb = new EGTB();
-      egtb->Initialize();
+      try {
+        egtb->Initialize(egtb_file);
+      } catch (const std::runtime_error& e) {
+        std::cout << "# " << e.what() << std::endl;
+        egtb->Initialize();
+      }
       return egtb;
     }();
     return antichess_egtb;
@@ -2,14 +2,25 @@
 #define EGTB_H
 
 #include "board.h"
+#include "egtb_index.h"
+#include "lru_cache.h"
 #include "move.h"
+#include "stats.h"
 
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 struct EGTBIndexEntry {
+  // Plies to the end of the game with best play. Only set by
+  // EGTB::LookupWithMove().
   uint16_t moves_to_end;
+  // Only set by EGTB::LookupWithMove().
   Move next_move;
   // '1' if the next side to move wins.
   // '-1' if the next side to move loses.
@@ -17,27 +28,138 @@ struct EGTBIndexEntry {
   int8_t result;
 };
 
+namespace egtb {
+
+// The table of one material, with entries at the indices of indexer.
+struct Table {
+  TableIndexer indexer;
+  std::span<const Entry> entries;
+};
+
+// Tables by canonical material key.
+using Tables = std::unordered_map<MaterialKey, Table>;
+
+// Returns the entry of the antichess position on board, or an entry with
+// Result::NONE if its table is not in tables. If there is an en passant target
+// and captures, which are compulsory, the entry is worked out from the tables
+// of the captures. Safe to call while other threads write to the tables.
+Entry Probe(const Tables& tables, Board& board);
+
+} // namespace egtb
+
 class EGTB final {
 public:
-  void Initialize();
+  EGTB() = default;
+  ~EGTB();
+
+  EGTB(const EGTB&) = delete;
+  EGTB& operator=(const EGTB&) = delete;
+
+  // Memory-maps the tables from the file at given path, written by
+  // WriteEGTBFile(), so that engine processes using the same file share them.
+  // If path is empty or there is no file at path, generates the tables of up
+  // to two pieces in memory instead. Throws std::runtime_error if the file
+  // cannot be used.
+  void Initialize(const std::string& path = "");
+
+  // Positions of up to this many pieces are in the tables.
+  int MaxPieces() const { return max_pieces_; }
+
+  // Returns WIN, -WIN or DRAW for the side to move in the position on board,
+  // or UNKNOWN if its material has no table. The table is found from
+  // Board::MaterialSignature() before any index is computed, so this is cheap
+  // enough for search leaves. Positions with an en passant target are
+  // UNKNOWN, as a compulsory en passant capture would need moves to be made.
+  int ProbeWDL(const Board& board);
+
+  // Returns the result of the position on board, or nothing if the position
+  // is not in the tables. Only reads the win/draw/loss blocks, which are small
+  // enough to stay cached during search. The board is restored before
+  // returning.
+  std::optional<EGTBIndexEntry> Lookup(Board& board);
 
-  const EGTBIndexEntry* Lookup(const Board& board);
+  // As Lookup(), and also sets the plies to the end and the move that keeps
+  // the result with the fewest plies to the end when winning and the most when
+  // losing. Meant for the root, as it also reads the plies to the end blocks.
+  std::optional<EGTBIndexEntry> LookupWithMove(Board& board);
 
   void LogStats();
 
+  // Tables are compressed in blocks of this many entries, and lookups
+  // decompress whole blocks into a cache.
+  static constexpr int kBlockSize = 4096;
+
 private:
+
+  // Compressed table in the mapped file or the generated image. Block i of
+  // the results is in [wdl_offsets[i], wdl_offsets[i + 1]) of the image, and
+  // likewise for the plies to the end.
+  struct CompressedTable {
+    egtb::TableIndexer indexer;
+    uint32_t id;
+    const uint64_t* wdl_offsets;
+    const uint64_t* dtm_offsets;
+  };
+
+  // Results (egtb::Result) of a block.
+  using WDLBlock = std::array<uint8_t, kBlockSize>;
+  // Entries of a block.
+  using DTMBlock = std::array<egtb::Entry, kBlockSize>;
+
+  // Indexes the tables in given image of an EGTB file. Throws
+  // std::runtime_error if the image is truncated.
+  void IndexTables(const char* data, size_t size);
+
+  // Returns the entry of the position on board, see egtb::Probe(), with 0
+  // plies to the end unless with_plies.
+  egtb::Entry Probe(Board& board, bool with_plies);
+
+  // As Probe(), for a position whose en passant target, if any, is ignored.
+  egtb::Entry ProbeTable(const Board& board, bool with_plies);
+
+  std::shared_ptr<const WDLBlock> GetWDLBlock(const CompressedTable& table,
+                                              uint64_t block);
+  // As GetWDLBlock(), but first looks in a small cache of the blocks the
+  // calling thread probed recently, which takes no lock. The block stays valid
+  // until the thread's next call.
+  const WDLBlock& GetLocalWDLBlock(const CompressedTable& table,
+                                   uint64_t block);
+  std::shared_ptr<const DTMBlock> GetDTMBlock(const CompressedTable& table,
+                                              uint64_t block);
+
   bool initialized_ = false;
-  std::unordered_map<int, std::vector<EGTBIndexEntry>> egtb_index_;
-  uint64_t egtb_hits_ = 0ULL;
-  uint64_t egtb_misses_ = 0ULL;
+  int max_pieces_ = 0;
+  // Backing memory of the tables, either the mapped file or, if there was no
+  // file, the image of the tables generated in memory.
+  void* mapped_ = nullptr;
+  size_t mapped_size_ = 0;
+  std::string generated_;
+  const char* data_ = nullptr;
+  std::unordered_map<egtb::MaterialKey, CompressedTable> tables_;
+  // Tells the blocks of this instance from those of others in the per-thread
+  // caches of GetLocalWDLBlock().
+  uint64_t id_ = 0;
+  // Decompressed blocks, keyed by table id and block.
+  LRUCache<uint64_t, WDLBlock> wdl_cache_{256};
+  LRUCache<uint64_t, DTMBlock> dtm_cache_{64};
+  // Lookups come from concurrent search threads, so they are counted per
+  // thread.
+  enum Stat { HITS, MISSES, BLOCK_MISSES, NUM_STATS };
+  ThreadCounters<NUM_STATS> stats_;
 };
 
+// Generates the antichess tables of up to max_pieces pieces on num_threads
+// threads and writes them to the file at given path. Throws
+// std::runtime_error if the file cannot be written.
+void WriteEGTBFile(const std::string& path, int max_pieces, int num_threads);
+
+// Sets the path of the file GetEGTB() loads the antichess tables from, see
+// EGTB::Initialize. Must be called before the first call to GetEGTB().
+void SetEGTBFile(const std::string& path);
+
 void PrintEGTBIndexEntry(const EGTBIndexEntry& entry);
 int EGTBResult(const EGTBIndexEntry& entry);
 
-int ComputeBoardDescriptionId(const Board& board);
-U64 ComputeEGTBIndex(const Board& board);
-
 EGTB* GetEGTB(const Variant variant);
 
 #endif
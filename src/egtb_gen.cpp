@@ -0,0 +1,30 @@
+#include "egtb.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+int main(int argc, char* argv[]) {
+  if (argc < 2 || argc > 4) {
+    std::cerr << "Expect arguments: <output file> [max pieces] [threads]\n"
+              << "Eg: ./egtb_gen antichess.egtb 3 8\n"
+              << "Generates the antichess EGTB of up to max pieces (default "
+                 "3, at most 4) into the file, which the engine memory-maps "
+                 "at startup. Uses all cores unless threads is given."
+              << std::endl;
+    return 0;
+  }
+  const int max_pieces = argc > 2 ? std::stoi(argv[2]) : 3;
+  const int num_threads =
+      argc > 3 ? std::stoi(argv[3])
+               : std::max(1u, std::thread::hardware_concurrency());
+  try {
+    WriteEGTBFile(argv[1], max_pieces, num_threads);
+  } catch (const std::runtime_error& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,388 @@
+#include "egtb_generator.h"
+#include "attacks.h"
+#include "bitmanip.h"
+#include "board.h"
+#include "common.h"
+#include "compact.h"
+#include "egtb.h"
+#include "egtb_index.h"
+#include "eval.h"
+#include "move_array.h"
+#include "movegen.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <climits>
+#include <tuple>
+
+namespace egtb {
+
+std::vector<MaterialKey> GenerationOrder(const int max_pieces) {
+  std::vector<MaterialKey> keys = AllCanonicalKeys(max_pieces);
+  std::sort(keys.begin(), keys.end(),
+            [](const MaterialKey a, const MaterialKey b) {
+              return std::make_tuple(NumPieces(a), NumPawns(a), a) <
+                     std::make_tuple(NumPieces(b), NumPawns(b), b);
+            });
+  return keys;
+}
+
+std::string MaterialName(const MaterialKey key) {
+  std::string name;
+  for (const Side side : {Side::WHITE, Side::BLACK}) {
+    if (side == Side::BLACK) {
+      name += 'v';
+    }
+    for (Piece piece_type = KING; piece_type <= PAWN; ++piece_type) {
+      const Piece piece = PieceOfSide(piece_type, side);
+      name.append((key >> (4 * PieceIndex(piece))) & 0xF,
+                  PieceToChar(piece_type));
+    }
+  }
+  return name;
+}
+
+namespace {
+
+// One bit per index of a table. Bits are set from concurrent threads with
+// SetBit(), and words are otherwise written by one thread at a time.
+using Bitmap = std::vector<uint64_t>;
+
+bool TestBit(const Bitmap& bitmap, const uint64_t index) {
+  return (bitmap[index / 64] >> (index % 64)) & 1;
+}
+
+void SetBit(Bitmap& bitmap, const uint64_t index) {
+  std::atomic_ref<uint64_t>(bitmap[index / 64])
+      .fetch_or(1ULL << (index % 64), std::memory_order_relaxed);
+}
+
+Entry LoadEntry(const Entry& entry) {
+  return std::atomic_ref<Entry>(const_cast<Entry&>(entry))
+      .load(std::memory_order_relaxed);
+}
+
+void StoreEntry(Entry& entry, const Entry value) {
+  std::atomic_ref<Entry>(entry).store(value, std::memory_order_relaxed);
+}
+
+U64 SideBitBoard(const BoardDesc& board_desc, const Side side) {
+  U64 bitboard = 0ULL;
+  for (Piece piece_type = KING; piece_type <= PAWN; ++piece_type) {
+    bitboard |=
+        board_desc.bitboard_pieces[PieceIndex(PieceOfSide(piece_type, side))];
+  }
+  return bitboard;
+}
+
+// Returns true if side has a capture, including an en passant capture to
+// ep_index unless it is NO_EP.
+bool HasCaptures(const BoardDesc& board_desc, const Side side,
+                 const int ep_index) {
+  const U64 opp_bitboard = SideBitBoard(board_desc, OppositeSide(side));
+  const U64 occupied = opp_bitboard | SideBitBoard(board_desc, side);
+  const U64 pawns =
+      board_desc.bitboard_pieces[PieceIndex(PieceOfSide(PAWN, side))];
+  const U64 pawn_attacks =
+      side == Side::WHITE
+          ? bitmanip::PushNorthEast(pawns) | bitmanip::PushNorthWest(pawns)
+          : bitmanip::PushSouthEast(pawns) | bitmanip::PushSouthWest(pawns);
+  if (pawn_attacks &
+      (opp_bitboard | (ep_index == NO_EP ? 0ULL : (1ULL << ep_index)))) {
+    return true;
+  }
+  for (Piece piece_type = KING; piece_type < PAWN; ++piece_type) {
+    const Piece piece = PieceOfSide(piece_type, side);
+    for (U64 bitboard = board_desc.bitboard_pieces[PieceIndex(piece)];
+         bitboard; bitboard &= bitboard - 1) {
+      if (attacks::Attacks(occupied, Lsb1(bitboard), piece) & opp_bitboard) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Calls visit(predecessor) for every position with the same material from
+// which a legal move leads to board_desc. A double pawn push only leads to
+// board_desc if its en passant target cannot be captured, or else the position
+// after the push is resolved from the tables of the captures.
+template <typename Visit>
+void ForEachPredecessor(const BoardDesc& board_desc, Visit visit) {
+  const Side side_to_move = board_desc.side_to_move;
+  const Side side = OppositeSide(side_to_move);
+  const U64 occupied = SideBitBoard(board_desc, Side::WHITE) |
+                       SideBitBoard(board_desc, Side::BLACK);
+  BoardDesc predecessor = board_desc;
+  predecessor.side_to_move = side;
+  const auto unmove = [&](const Piece piece, const int from, const int to) {
+    U64& bitboard = predecessor.bitboard_pieces[PieceIndex(piece)];
+    bitboard ^= (1ULL << from) | (1ULL << to);
+    // Captures are compulsory, so a quiet move is only legal without them.
+    if (!HasCaptures(predecessor, side, NO_EP)) {
+      visit(static_cast<const BoardDesc&>(predecessor));
+    }
+    bitboard ^= (1ULL << from) | (1ULL << to);
+  };
+
+  for (Piece piece_type = KING; piece_type < PAWN; ++piece_type) {
+    const Piece piece = PieceOfSide(piece_type, side);
+    for (U64 bitboard = board_desc.bitboard_pieces[PieceIndex(piece)];
+         bitboard; bitboard &= bitboard - 1) {
+      const int to = Lsb1(bitboard);
+      for (U64 from_bitboard =
+               attacks::Attacks(occupied, to, piece) & ~occupied;
+           from_bitboard; from_bitboard &= from_bitboard - 1) {
+        unmove(piece, Lsb1(from_bitboard), to);
+      }
+    }
+  }
+
+  const Piece pawn = PieceOfSide(PAWN, side);
+  const int forward = side == Side::WHITE ? 8 : -8;
+  // Rows relative to side.
+  const auto row = [side](const int sq) {
+    return side == Side::WHITE ? int(ROW(sq)) : 7 - int(ROW(sq));
+  };
+  for (U64 bitboard = board_desc.bitboard_pieces[PieceIndex(pawn)]; bitboard;
+       bitboard &= bitboard - 1) {
+    const int to = Lsb1(bitboard);
+    const int one_back = to - forward;
+    if (row(to) < 2 || (occupied & (1ULL << one_back))) {
+      continue;
+    }
+    unmove(pawn, one_back, to);
+    const int two_back = one_back - forward;
+    if (row(to) == 3 && !(occupied & (1ULL << two_back)) &&
+        !HasCaptures(board_desc, side_to_move, one_back)) {
+      unmove(pawn, two_back, to);
+    }
+  }
+}
+
+Entry ResultEntry(const int result) {
+  return MakeEntry(result == WIN    ? Result::WON
+                   : result == -WIN ? Result::LOST
+                                    : Result::DRAWN,
+                   0);
+}
+
+} // namespace
+
+Generator::Generator(const int num_threads, Tables* tables,
+                     std::list<std::vector<Entry>>* storage)
+    : tables_(tables), storage_(storage) {
+  pool_.Resize(num_threads);
+}
+
+void Generator::ParallelFor(
+    const uint64_t size,
+    const std::function<void(int, uint64_t, uint64_t)>& task) {
+  constexpr uint64_t kChunkSize = 1024;
+  std::atomic<uint64_t> next_chunk = 0;
+  pool_.Run([&](const int worker_num) {
+    for (uint64_t begin = next_chunk.fetch_add(kChunkSize); begin < size;
+         begin = next_chunk.fetch_add(kChunkSize)) {
+      task(worker_num, begin, std::min(size, begin + kChunkSize));
+    }
+  });
+  pool_.Wait();
+}
+
+TableStats Generator::Generate(const MaterialKey key) {
+  const TableIndexer indexer(key);
+  const uint64_t size = indexer.Size();
+  const uint64_t num_words = (size + 63) / 64;
+  std::vector<Entry>& entries =
+      storage_->emplace_back(size, MakeEntry(Result::NONE, 0));
+  // Entries are only set once final, so that positions probed for the
+  // predecessors in this table read as unresolved until then.
+  tables_->emplace(key, Table{.indexer = indexer, .entries = entries});
+
+  // The result a position is known to reach once its plies to the end come up.
+  std::vector<Entry> pending(size, MakeEntry(Result::NONE, 0));
+  Bitmap unresolved(num_words);
+  Bitmap resolved(num_words);
+  Bitmap to_check(num_words);
+  std::vector<int> max_pending_plies(pool_.NumWorkers(), 0);
+
+  // Positions at the end of the game, and positions resolved by moves to
+  // other tables. Chunks are whole words of the bitmaps.
+  ParallelFor(size, [&](const int worker_num, const uint64_t begin,
+                        const uint64_t end) {
+    BoardDesc board_desc;
+    for (uint64_t index = begin; index < end; ++index) {
+      if (!indexer.Position(index, &board_desc)) {
+        continue;
+      }
+      unresolved[index / 64] |= 1ULL << (index % 64);
+      Board board(Variant::ANTICHESS, board_desc);
+      const int result = EvalResult<Variant::ANTICHESS>(board);
+      if (result != UNKNOWN) {
+        pending[index] = ResultEntry(result);
+        continue;
+      }
+      const MoveArray move_array = GenerateMoves<Variant::ANTICHESS>(board);
+      int best_win = INT_MAX;
+      int worst_loss = 0;
+      bool all_won = true;
+      bool to_this_table = false;
+      for (size_t i = 0; i < move_array.size(); ++i) {
+        board.MakeMove(move_array.get(i));
+        const Entry child = Probe(*tables_, board);
+        board.UnmakeLastMove();
+        switch (EntryResult(child)) {
+        case Result::LOST:
+          best_win = std::min(best_win, EntryPliesToEnd(child) + 1);
+          all_won = false;
+          break;
+        case Result::WON:
+          worst_loss = std::max(worst_loss, EntryPliesToEnd(child) + 1);
+          break;
+        case Result::DRAWN:
+          all_won = false;
+          break;
+        case Result::NONE:
+          // Positions of other tables are all resolved.
+          to_this_table = true;
+          break;
+        }
+      }
+      if (best_win != INT_MAX) {
+        pending[index] = MakeEntry(Result::WON, best_win);
+      } else if (all_won && !to_this_table) {
+        pending[index] = MakeEntry(Result::LOST, worst_loss);
+      } else {
+        continue;
+      }
+      max_pending_plies[worker_num] =
+          std::max(max_pending_plies[worker_num],
+                   EntryPliesToEnd(pending[index]));
+    }
+  });
+
+  for (int plies = 0;; ++plies) {
+    assert(plies <= MAX_PLIES_TO_END);
+    // Finalizes the positions resolved in plies.
+    std::vector<uint64_t> num_resolved(pool_.NumWorkers(), 0);
+    ParallelFor(num_words, [&](const int worker_num, const uint64_t begin,
+                               const uint64_t end) {
+      for (uint64_t word = begin; word < end; ++word) {
+        resolved[word] = 0ULL;
+        for (U64 bits = unresolved[word]; bits; bits &= bits - 1) {
+          const uint64_t index = 64 * word + Lsb1(bits);
+          const Entry entry = LoadEntry(pending[index]);
+          if (EntryResult(entry) != Result::NONE &&
+              EntryPliesToEnd(entry) == plies) {
+            StoreEntry(entries[index], entry);
+            resolved[word] |= 1ULL << (index % 64);
+          }
+        }
+        unresolved[word] &= ~resolved[word];
+        num_resolved[worker_num] += PopCount(resolved[word]);
+      }
+    });
+    const int max_pending = *std::max_element(max_pending_plies.begin(),
+                                              max_pending_plies.end());
+    if (std::count(num_resolved.begin(), num_resolved.end(), 0) ==
+            int(num_resolved.size()) &&
+        plies >= max_pending) {
+      break;
+    }
+
+    // Unmoves the positions just resolved. A position that can move to a lost
+    // one is won in a ply more; one that can move to a won one is checked.
+    ParallelFor(num_words, [&](const int worker_num, const uint64_t begin,
+                               const uint64_t end) {
+      BoardDesc board_desc;
+      for (uint64_t word = begin; word < end; ++word) {
+        for (U64 bits = resolved[word]; bits; bits &= bits - 1) {
+          const uint64_t index = 64 * word + Lsb1(bits);
+          const Result result = EntryResult(entries[index]);
+          if (result == Result::DRAWN) {
+            continue;
+          }
+          indexer.Position(index, &board_desc);
+          ForEachPredecessor(board_desc, [&](const BoardDesc& predecessor) {
+            const uint64_t predecessor_index = indexer.Index(predecessor);
+            if (!TestBit(unresolved, predecessor_index)) {
+              return;
+            }
+            if (result == Result::WON) {
+              SetBit(to_check, predecessor_index);
+              return;
+            }
+            // All writers in this pass store the same entry.
+            const Entry won = MakeEntry(Result::WON, plies + 1);
+            const Entry entry = LoadEntry(pending[predecessor_index]);
+            if (EntryResult(entry) != Result::WON ||
+                EntryPliesToEnd(entry) > plies + 1) {
+              StoreEntry(pending[predecessor_index], won);
+              max_pending_plies[worker_num] =
+                  std::max(max_pending_plies[worker_num], plies + 1);
+            }
+          });
+        }
+      }
+    });
+
+    // A checked position is lost once all its moves lead to won positions.
+    ParallelFor(num_words, [&](const int worker_num, const uint64_t begin,
+                               const uint64_t end) {
+      BoardDesc board_desc;
+      for (uint64_t word = begin; word < end; ++word) {
+        const U64 check_bits = to_check[word] & unresolved[word];
+        to_check[word] = 0ULL;
+        for (U64 bits = check_bits; bits; bits &= bits - 1) {
+          const uint64_t index = 64 * word + Lsb1(bits);
+          if (EntryResult(pending[index]) == Result::WON) {
+            continue;
+          }
+          indexer.Position(index, &board_desc);
+          Board board(Variant::ANTICHESS, board_desc);
+          const MoveArray move_array = GenerateMoves<Variant::ANTICHESS>(board);
+          int worst_loss = 0;
+          bool all_won = true;
+          for (size_t i = 0; all_won && i < move_array.size(); ++i) {
+            board.MakeMove(move_array.get(i));
+            const Entry child = Probe(*tables_, board);
+            board.UnmakeLastMove();
+            all_won = EntryResult(child) == Result::WON;
+            worst_loss = std::max(worst_loss, EntryPliesToEnd(child) + 1);
+          }
+          if (all_won) {
+            pending[index] = MakeEntry(Result::LOST, worst_loss);
+            max_pending_plies[worker_num] =
+                std::max(max_pending_plies[worker_num], worst_loss);
+          }
+        }
+      }
+    });
+  }
+
+  TableStats stats;
+  for (uint64_t index = 0; index < size; ++index) {
+    if (TestBit(unresolved, index)) {
+      entries[index] = MakeEntry(Result::DRAWN, 0);
+    }
+    switch (EntryResult(entries[index])) {
+    case Result::WON:
+      ++stats.wins;
+      break;
+    case Result::LOST:
+      ++stats.losses;
+      break;
+    case Result::DRAWN:
+      ++stats.draws;
+      break;
+    case Result::NONE:
+      break;
+    }
+    stats.max_plies =
+        std::max(stats.max_plies, EntryPliesToEnd(entries[index]));
+  }
+  return stats;
+}
+
+} // namespace egtb
@@ -0,0 +1,65 @@
+#ifndef EGTB_GENERATOR_H
+#define EGTB_GENERATOR_H
+
+#include "egtb.h"
+#include "egtb_index.h"
+#include "thread_pool.h"
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <vector>
+
+namespace egtb {
+
+// Returns the canonical keys of the materials of 1 to max_pieces pieces in the
+// order they are generated in, after the tables they depend on: those of fewer
+// pieces for captures and those of fewer pawns for promotions.
+std::vector<MaterialKey> GenerationOrder(int max_pieces);
+
+// Name of the material, such as "KRvK".
+std::string MaterialName(MaterialKey key);
+
+struct TableStats {
+  uint64_t wins = 0;
+  uint64_t losses = 0;
+  uint64_t draws = 0;
+  int max_plies = 0;
+};
+
+// Generates tables by retrograde analysis over dense arrays indexed by
+// TableIndexer. Positions at the end of the game are resolved first, in 0
+// plies. Then, for increasing n, the positions resolved in n plies are
+// finalized and unmoved: a predecessor of a position lost in n plies is won in
+// n + 1 plies, and a predecessor of a position won in n plies is lost if all
+// its moves now lead to won positions. Moves to other tables, captures and
+// promotions, are resolved from those tables up front. Positions left
+// unresolved are draws.
+//
+// The unresolved, newly resolved and to be checked positions are kept in
+// bitmaps, and every pass over them is split into chunks for the threads of a
+// thread pool.
+class Generator {
+public:
+  // Generated tables are added to tables, with their entries in storage.
+  Generator(int num_threads, Tables* tables,
+            std::list<std::vector<Entry>>* storage);
+
+  // Generates the table of material key, after the tables it depends on, see
+  // GenerationOrder().
+  TableStats Generate(MaterialKey key);
+
+private:
+  // Runs task(worker_num, begin, end) on the pool for chunks [begin, end) of
+  // [0, size).
+  void ParallelFor(uint64_t size,
+                   const std::function<void(int, uint64_t, uint64_t)>& task);
+
+  ThreadPool pool_;
+  Tables* tables_;
+  std::list<std::vector<Entry>>* storage_;
+};
+
+} // namespace egtb
+
+#endif
@@ -0,0 +1,254 @@
+#include "egtb_index.h"
+#include "board.h"
+#include "common.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+
+namespace egtb {
+
+namespace {
+
+// Maps the squares of the first piece of tables without pawns (the a1-d1-d4
+// triangle) and with pawns (files a-d, ranks 2-7) to dense indices and back.
+struct FirstSquares {
+  std::array<int, 64> index;
+  std::vector<int> squares;
+};
+
+FirstSquares MakeFirstSquares(const bool pawns) {
+  FirstSquares first_squares;
+  first_squares.index.fill(-1);
+  for (int sq = 0; sq < 64; ++sq) {
+    const int row = ROW(sq);
+    const int col = COL(sq);
+    if (pawns ? (1 <= row && row <= 6 && col <= 3) : (row <= col && col <= 3)) {
+      first_squares.index[sq] = first_squares.squares.size();
+      first_squares.squares.push_back(sq);
+    }
+  }
+  return first_squares;
+}
+
+const FirstSquares pawnless_first_squares = MakeFirstSquares(false);
+const FirstSquares pawn_first_squares = MakeFirstSquares(true);
+
+// Applies one of the 8 symmetries of the board: bit 0 of t reflects files,
+// bit 1 reflects ranks and bit 2 reflects along the a1-h8 diagonal.
+constexpr int Transform(const int sq, const int t) {
+  int row = ROW(sq);
+  int col = COL(sq);
+  if (t & 1) {
+    col = 7 - col;
+  }
+  if (t & 2) {
+    row = 7 - row;
+  }
+  if (t & 4) {
+    std::swap(row, col);
+  }
+  return INDX(row, col);
+}
+
+// Piece with given PieceIndex().
+constexpr Piece PieceOfIndex(const int index) {
+  return index < 6 ? index + 1 : 5 - index;
+}
+
+int Count(const MaterialKey key, const Piece piece) {
+  return (key >> (4 * PieceIndex(piece))) & 0xF;
+}
+
+void AddKeys(const int piece_index, const int pieces_left,
+             const MaterialKey key, std::vector<MaterialKey>* keys) {
+  if (piece_index == 12) {
+    if (key && CanonicalKey(key) == key) {
+      keys->push_back(key);
+    }
+    return;
+  }
+  for (int count = 0; count <= pieces_left; ++count) {
+    AddKeys(piece_index + 1, pieces_left - count,
+            key | (MaterialKey(count) << (4 * piece_index)), keys);
+  }
+}
+
+} // namespace
+
+MaterialKey GetMaterialKey(const Board& board) {
+  return board.MaterialSignature();
+}
+
+MaterialKey GetMaterialKey(const BoardDesc& board_desc) {
+  MaterialKey key = 0;
+  for (int i = 0; i < 12; ++i) {
+    key |= MaterialKey(PopCount(board_desc.bitboard_pieces[i])) << (4 * i);
+  }
+  return key;
+}
+
+int NumPieces(const MaterialKey key) {
+  int num_pieces = 0;
+  for (int i = 0; i < 12; ++i) {
+    num_pieces += (key >> (4 * i)) & 0xF;
+  }
+  return num_pieces;
+}
+
+int NumPawns(const MaterialKey key) {
+  return Count(key, PAWN) + Count(key, -PAWN);
+}
+
+std::vector<MaterialKey> AllCanonicalKeys(const int max_pieces) {
+  std::vector<MaterialKey> keys;
+  AddKeys(0, max_pieces, 0, &keys);
+  return keys;
+}
+
+TableIndexer::TableIndexer(const MaterialKey key)
+    : key_(key), has_pawns_(NumPawns(key) > 0) {
+  assert(NumPieces(key) <= MAX_PIECES);
+  for (const Piece piece : {PAWN, -PAWN}) {
+    pieces_.insert(pieces_.end(), Count(key, piece), piece);
+  }
+  for (const Side side : {Side::WHITE, Side::BLACK}) {
+    for (Piece piece_type = KING; piece_type < PAWN; ++piece_type) {
+      const Piece piece = PieceOfSide(piece_type, side);
+      pieces_.insert(pieces_.end(), Count(key, piece), piece);
+    }
+  }
+  size_ = 2 * (has_pawns_ ? pawn_first_squares : pawnless_first_squares)
+                  .squares.size();
+  for (size_t i = 1; i < pieces_.size(); ++i) {
+    size_ *= PieceType(pieces_[i]) == PAWN ? 48 : 64;
+  }
+}
+
+uint64_t TableIndexer::IndexOf(const int* squares, const Side side) const {
+  uint64_t index = 0;
+  for (size_t i = pieces_.size() - 1; i >= 1; --i) {
+    index = PieceType(pieces_[i]) == PAWN ? 48 * index + squares[i] - 8
+                                          : 64 * index + squares[i];
+  }
+  const FirstSquares& first_squares =
+      has_pawns_ ? pawn_first_squares : pawnless_first_squares;
+  assert(first_squares.index[squares[0]] >= 0);
+  index = first_squares.squares.size() * index +
+          first_squares.index[squares[0]];
+  return 2 * index + SideIndex(side);
+}
+
+namespace {
+
+// Replaces squares, listed in the order of pieces, by the least of their
+// images under the given number of symmetries, with the squares of equal
+// pieces sorted.
+void Reduce(const std::vector<Piece>& pieces, const int num_transforms,
+            int* squares) {
+  const int n = pieces.size();
+  std::array<int, MAX_PIECES> best;
+  for (int t = 0; t < num_transforms; ++t) {
+    std::array<int, MAX_PIECES> transformed;
+    for (int i = 0; i < n; ++i) {
+      transformed[i] = Transform(squares[i], t);
+    }
+    for (int i = 0; i < n;) {
+      int j = i + 1;
+      while (j < n && pieces[j] == pieces[i]) {
+        ++j;
+      }
+      std::sort(transformed.begin() + i, transformed.begin() + j);
+      i = j;
+    }
+    if (t == 0 ||
+        std::lexicographical_compare(transformed.begin(),
+                                     transformed.begin() + n, best.begin(),
+                                     best.begin() + n)) {
+      best = transformed;
+    }
+  }
+  std::copy(best.begin(), best.begin() + n, squares);
+}
+
+} // namespace
+
+uint64_t TableIndexer::Index(const Board& board) const {
+  BoardDesc board_desc;
+  for (int i = 0; i < 12; ++i) {
+    board_desc.bitboard_pieces[i] = board.BitBoard(PieceOfIndex(i));
+  }
+  board_desc.side_to_move = board.SideToMove();
+  return Index(board_desc);
+}
+
+uint64_t TableIndexer::Index(const BoardDesc& board_desc) const {
+  // Positions of the colour swapped material are indexed after swapping
+  // colours back, which also reflects the ranks.
+  const bool flip = GetMaterialKey(board_desc) != key_;
+  assert(!flip || FlipColors(GetMaterialKey(board_desc)) == key_);
+  std::array<int, MAX_PIECES> squares;
+  int n = 0;
+  for (size_t i = 0; i < pieces_.size(); ++i) {
+    if (i > 0 && pieces_[i] == pieces_[i - 1]) {
+      continue;
+    }
+    U64 bitboard = board_desc.bitboard_pieces[PieceIndex(
+        flip ? -pieces_[i] : pieces_[i])];
+    while (bitboard) {
+      const int sq = Lsb1(bitboard);
+      squares[n++] = flip ? (sq ^ 56) : sq;
+      bitboard &= bitboard - 1;
+    }
+  }
+  Reduce(pieces_, has_pawns_ ? 2 : 8, squares.data());
+  const Side side = flip ? OppositeSide(board_desc.side_to_move)
+                         : board_desc.side_to_move;
+  return IndexOf(squares.data(), side);
+}
+
+bool TableIndexer::Position(const uint64_t index,
+                            BoardDesc* board_desc) const {
+  if (index >= size_) {
+    return false;
+  }
+  const Side side = (index & 1) ? Side::BLACK : Side::WHITE;
+  uint64_t rest = index >> 1;
+  const FirstSquares& first_squares =
+      has_pawns_ ? pawn_first_squares : pawnless_first_squares;
+  std::array<int, MAX_PIECES> squares;
+  squares[0] = first_squares.squares[rest % first_squares.squares.size()];
+  rest /= first_squares.squares.size();
+  U64 occupied = 1ULL << squares[0];
+  for (size_t i = 1; i < pieces_.size(); ++i) {
+    if (PieceType(pieces_[i]) == PAWN) {
+      squares[i] = rest % 48 + 8;
+      rest /= 48;
+    } else {
+      squares[i] = rest % 64;
+      rest /= 64;
+    }
+    if (occupied & (1ULL << squares[i])) {
+      return false;
+    }
+    occupied |= 1ULL << squares[i];
+  }
+  std::array<int, MAX_PIECES> reduced = squares;
+  Reduce(pieces_, has_pawns_ ? 2 : 8, reduced.data());
+  if (IndexOf(reduced.data(), side) != index) {
+    return false;
+  }
+
+  std::memset(board_desc->bitboard_pieces, 0,
+              sizeof(board_desc->bitboard_pieces));
+  for (size_t i = 0; i < pieces_.size(); ++i) {
+    board_desc->bitboard_pieces[PieceIndex(pieces_[i])] |= 1ULL << squares[i];
+  }
+  board_desc->side_to_move = side;
+  board_desc->castle = 0;
+  board_desc->ep_index = NO_EP;
+  return true;
+}
+
+} // namespace egtb
@@ -0,0 +1,108 @@
+#ifndef EGTB_INDEX_H
+#define EGTB_INDEX_H
+
+#include "board.h"
+#include "common.h"
+#include "compact.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Indexing of antichess endgame tables. There is one table for every material
+// combination, up to swapping colours, and each table maps its positions to a
+// dense range of indices.
+namespace egtb {
+
+// Largest number of pieces the tables are indexed for.
+constexpr int MAX_PIECES = 4;
+
+// Number of pieces of each kind on the board, 4 bits each in the order of
+// PieceIndex(), so that white pieces take the low 24 bits and black pieces the
+// next 24 bits, as in Board::MaterialSignature().
+using MaterialKey = uint64_t;
+
+MaterialKey GetMaterialKey(const Board& board);
+MaterialKey GetMaterialKey(const BoardDesc& board_desc);
+
+// Returns the key of the material with colours swapped.
+constexpr MaterialKey FlipColors(const MaterialKey key) {
+  return (key >> 24) | ((key & 0xFFFFFF) << 24);
+}
+
+// Positions with given material and with colours swapped share one table,
+// keyed by the lesser of the two keys.
+constexpr MaterialKey CanonicalKey(const MaterialKey key) {
+  return std::min(key, FlipColors(key));
+}
+
+int NumPieces(MaterialKey key);
+int NumPawns(MaterialKey key);
+
+// Returns the canonical keys of all materials of 1 to max_pieces pieces.
+std::vector<MaterialKey> AllCanonicalKeys(int max_pieces);
+
+// Maps the positions of a table to indices and back. Positions are first
+// reduced by symmetry: the colour swap for materials that are not canonical,
+// and then the 8 rotations and reflections of the board if there are no pawns,
+// or the left-right reflection if there are. Among the equivalent positions,
+// the one whose piece squares, listed in table order, are lexicographically
+// least is indexed. Its first square then lies in the a1-d1-d4 triangle (10
+// squares) without pawns, or on files a-d and ranks 2-7 (24 squares) with a
+// pawn first, and further pieces take 64 squares, or 48 for pawns.
+//
+// The index is collision free: different positions never share an index, while
+// equivalent positions always do. Indices of non-canonical squares or of
+// pieces on a shared square are not used by any position.
+class TableIndexer {
+public:
+  explicit TableIndexer(MaterialKey key);
+
+  MaterialKey key() const { return key_; }
+
+  // Number of indices in the table.
+  uint64_t Size() const { return size_; }
+
+  // Index of the position on board, whose material must be key() or its colour
+  // swap. The en passant target, if any, is ignored.
+  uint64_t Index(const Board& board) const;
+  uint64_t Index(const BoardDesc& board_desc) const;
+
+  // Sets board_desc to the position at index and returns true, or returns
+  // false if no position has the index.
+  bool Position(uint64_t index, BoardDesc* board_desc) const;
+
+private:
+  // Index from piece squares listed in table order, already reduced by
+  // symmetry.
+  uint64_t IndexOf(const int* squares, Side side) const;
+
+  MaterialKey key_;
+  // Pieces in table order: pawns first, then white and then black pieces.
+  // Equal pieces are adjacent.
+  std::vector<Piece> pieces_;
+  bool has_pawns_;
+  uint64_t size_;
+};
+
+// A table entry in 2 bytes: the result for the side to move and the number of
+// plies to the end of the game with best play.
+using Entry = uint16_t;
+
+enum class Result : uint16_t { NONE = 0, WON = 1, LOST = 2, DRAWN = 3 };
+
+constexpr int MAX_PLIES_TO_END = (1 << 14) - 1;
+
+constexpr Entry MakeEntry(const Result result, const int plies_to_end) {
+  return (static_cast<uint16_t>(result) << 14) | plies_to_end;
+}
+
+constexpr Result EntryResult(const Entry entry) {
+  return static_cast<Result>(entry >> 14);
+}
+
+constexpr int EntryPliesToEnd(const Entry entry) { return entry & 0x3FFF; }
+
+} // namespace egtb
+
+#endif
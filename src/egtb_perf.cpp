@@ -0,0 +1,60 @@
+#include "egtb.h"
+#include "egtb_generator.h"
+#include "egtb_index.h"
+#include "stopwatch.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <vector>
+
+// Generates the antichess tables of up to given number of pieces in memory and
+// reports the generation time for each number of pieces.
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "Expect arguments: <max pieces> [threads]\n"
+                    "Eg: ./egtb_perf 3 4\n");
+    return 1;
+  }
+  const int max_pieces = atoi(argv[1]);
+  const int num_threads = argc > 2 ? atoi(argv[2]) : 1;
+  if (max_pieces < 1 || max_pieces > egtb::MAX_PIECES || num_threads < 1) {
+    fprintf(stderr, "Invalid arguments\n");
+    return 1;
+  }
+
+  egtb::Tables tables;
+  std::list<std::vector<egtb::Entry>> storage;
+  egtb::Generator generator(num_threads, &tables, &storage);
+  printf("Threads: %d\n", num_threads);
+  printf("+--------+--------+------------------+-----------------+"
+         "--------------------+\n");
+  printf("| Pieces | Tables | Elapsed time (s) |  Num Positions  |"
+         "  Positions / sec   |\n");
+  printf("+--------+--------+------------------+-----------------+"
+         "--------------------+\n");
+  const std::vector<egtb::MaterialKey> keys = egtb::GenerationOrder(max_pieces);
+  for (int num_pieces = 1; num_pieces <= max_pieces; ++num_pieces) {
+    StopWatch stop_watch;
+    stop_watch.Start();
+    int num_tables = 0;
+    uint64_t num_positions = 0;
+    for (const egtb::MaterialKey key : keys) {
+      if (egtb::NumPieces(key) == num_pieces) {
+        const egtb::TableStats stats = generator.Generate(key);
+        ++num_tables;
+        num_positions += stats.wins + stats.losses + stats.draws;
+      }
+    }
+    stop_watch.Stop();
+    const double elapsed_secs = stop_watch.ElapsedTime() / 100.0;
+    printf("|%6d  |%6d  | %16.3f | %12llu    | %17.3f  |\n", num_pieces,
+           num_tables, elapsed_secs,
+           static_cast<unsigned long long>(num_positions),
+           num_positions / elapsed_secs);
+  }
+  printf("+--------+--------+------------------+-----------------+"
+         "--------------------+\n");
+  return 0;
+}
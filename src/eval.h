@@ -4,17 +4,27 @@
 #include "board.h"
 #include "common.h"
 #include "egtb.h"
+#include "nnue.h"
+#include "stats.h"
 #include "std_eval_params.h"
 #include "std_static_eval.h"
+#include "transpos.h"
 #include "params/params.h"
 
+// Evaluates board using a quiescence search. If transpos is not null, the
+// quiescence search probes it and stores its results at depth 0. If
+// search_stats is not null, quiescence search nodes are counted in it.
 template <Variant variant>
   requires(IsStandard(variant))
-int Evaluate(Board& board, EGTB* egtb, int alpha, int beta);
+int Evaluate(Board& board, EGTB* egtb, int alpha, int beta,
+             TranspositionTable* transpos = nullptr,
+             SearchStats* search_stats = nullptr);
 
 template <Variant variant>
   requires(IsAntichessLike(variant))
-int Evaluate(Board& board, EGTB* egtb, int alpha, int beta);
+int Evaluate(Board& board, EGTB* egtb, int alpha, int beta,
+             TranspositionTable* transpos = nullptr,
+             SearchStats* search_stats = nullptr);
 
 template <Variant variant>
   requires(IsStandard(variant))
@@ -24,9 +34,16 @@ template <Variant variant>
   requires(IsAntichessLike(variant))
 int EvalResult(Board& board);
 
+// Static evaluation with the board's network if it has one, else with
+// BlessedParams(), taking the material and piece-square terms from those
+// maintained incrementally by the board.
 inline int StaticEval(Board& board) {
+  if (const nnue::Network* network = board.Network()) {
+    return nnue::Evaluate(*network, board.NnueAccumulator(),
+                          board.SideToMove());
+  }
   static const StdEvalParams<int> params = BlessedParams();
-  return standard::StaticEval(params, board);
+  return standard::StaticEval<int, true, true, true, true>(params, board);
 }
 
 #endif
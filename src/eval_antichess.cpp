@@ -30,22 +30,25 @@ bool RivalBishopsOnOppositeColoredSquares(const Board& board) {
 
 template <Variant variant>
 int EvaluateInternal(Board& board, EGTB* egtb, int alpha, int beta,
+                     SearchStats* search_stats,
                      int max_depth = EVAL_MAX_DEPTH) {
+  if (search_stats) {
+    ++search_stats->qnodes_searched;
+  }
   const Side side = board.SideToMove();
   const int self_pieces = board.NumPieces(side);
   const int opp_pieces = board.NumPieces(OppositeSide(side));
 
-  if (self_pieces == 1 && opp_pieces == 1) {
-    if (egtb) {
-      const EGTBIndexEntry* egtb_entry = egtb->Lookup(board);
-      if (egtb_entry) {
-        return EGTBResult(*egtb_entry);
-      }
-    }
-    if (RivalBishopsOnOppositeColoredSquares(board)) {
-      return DRAW;
+  if (egtb && self_pieces + opp_pieces <= egtb->MaxPieces()) {
+    const int egtb_result = egtb->ProbeWDL(board);
+    if (egtb_result != UNKNOWN) {
+      return egtb_result;
     }
   }
+  if (self_pieces == 1 && opp_pieces == 1 &&
+      RivalBishopsOnOppositeColoredSquares(board)) {
+    return DRAW;
+  }
 
   const int self_moves = CountMoves<variant>(board);
   if (self_moves == 0) {
@@ -64,7 +67,8 @@ int EvaluateInternal(Board& board, EGTB* egtb, int alpha, int beta,
     MoveArray move_array = GenerateMoves<variant>(board);
     board.MakeMove(move_array.get(0));
     const int eval =
-        -EvaluateInternal<variant>(board, egtb, -beta, -alpha, max_depth);
+        -EvaluateInternal<variant>(board, egtb, -beta, -alpha, search_stats,
+                                   max_depth);
     board.UnmakeLastMove();
     return eval;
   }
@@ -73,8 +77,9 @@ int EvaluateInternal(Board& board, EGTB* egtb, int alpha, int beta,
     int score = -INF;
     for (size_t i = 0; i < move_array.size(); ++i) {
       board.MakeMove(move_array.get(i));
-      const int eval = -EvaluateInternal<variant>(board, egtb, -beta, -alpha,
-                                                  max_depth - (self_moves - 1));
+      const int eval =
+          -EvaluateInternal<variant>(board, egtb, -beta, -alpha, search_stats,
+                                     max_depth - (self_moves - 1));
       board.UnmakeLastMove();
       if (eval > score) {
         score = eval;
@@ -98,7 +103,8 @@ int EvaluateInternal(Board& board, EGTB* egtb, int alpha, int beta,
     for (size_t i = 0; i < move_array.size(); ++i) {
       const Move& move = move_array.get(i);
       board.MakeMove(move);
-      const int eval = -EvaluateInternal<variant>(board, egtb, -beta, -alpha);
+      const int eval = -EvaluateInternal<variant>(board, egtb, -beta, -alpha,
+                                                  search_stats);
       board.UnmakeLastMove();
       if (eval > score) {
         score = eval;
@@ -129,8 +135,11 @@ int EvaluateInternal(Board& board, EGTB* egtb, int alpha, int beta,
 
 template <Variant variant>
   requires(IsAntichessLike(variant))
-int Evaluate(Board& board, EGTB* egtb, int alpha, int beta) {
-  return EvaluateInternal<variant>(board, egtb, alpha, beta);
+int Evaluate(Board& board, EGTB* egtb, int alpha, int beta,
+             TranspositionTable* transpos, SearchStats* search_stats) {
+  // Positions evaluated here are mostly shallow forced lines which are cheaper
+  // to search again than to look up, so the transposition table is not used.
+  return EvaluateInternal<variant>(board, egtb, alpha, beta, search_stats);
 }
 
 template <Variant variant>
@@ -161,7 +170,9 @@ int EvalResult(Board& board) {
   return UNKNOWN;
 }
 
-template int Evaluate<Variant::ANTICHESS>(Board&, EGTB*, int, int);
-template int Evaluate<Variant::SUICIDE>(Board&, EGTB*, int, int);
+template int Evaluate<Variant::ANTICHESS>(Board&, EGTB*, int, int,
+                                          TranspositionTable*, SearchStats*);
+template int Evaluate<Variant::SUICIDE>(Board&, EGTB*, int, int,
+                                        TranspositionTable*, SearchStats*);
 template int EvalResult<Variant::ANTICHESS>(Board&);
 template int EvalResult<Variant::SUICIDE>(Board&);
@@ -10,40 +10,95 @@
 #include "pst.h"
 #include "std_eval_params.h"
 #include "std_static_eval.h"
+#include "stats.h"
 #include "stopwatch.h"
+#include "transpos.h"
 
 #include <iostream>
+#include <optional>
 
 namespace {
 
 constexpr int FUTILITY_MARGIN = 50;
 
+// Returns true if tdata's score can be returned as the result of quiescence
+// search. Entries stored at any depth are at least as deep as the quiescence
+// search.
+bool QProbe(const TTData& tdata, int alpha, int beta) {
+  const NodeType node_type = tdata.node_type();
+  return node_type == NodeType::EXACT_NODE ||
+         (node_type == NodeType::FAIL_HIGH_NODE && tdata.score >= beta) ||
+         (node_type == NodeType::FAIL_LOW_NODE && tdata.score <= alpha);
+}
+
 } // namespace
 
 template <Variant variant>
   requires(IsStandard(variant))
-int Evaluate(Board& board, EGTB* egtb, int alpha, int beta) {
+int Evaluate(Board& board, EGTB* egtb, int alpha, int beta,
+             TranspositionTable* transpos, SearchStats* search_stats) {
   assert(egtb == nullptr);
-  bool in_check = attacks::InCheck(board, board.SideToMove());
+  if (search_stats) {
+    ++search_stats->qnodes_searched;
+  }
+  const U64 zkey = board.ZobristKey();
+  std::optional<TTData> tdata;
+  PrefMoves pref_moves;
+  if (transpos) {
+    tdata = transpos->Get(zkey);
+    if (tdata) {
+      if (QProbe(*tdata, alpha, beta)) {
+        return tdata->score;
+      }
+      pref_moves.tt_move = tdata->best_move;
+    }
+  }
+  // Results are stored at depth 0, so they must not replace entries stored by
+  // the main search for this position.
+  const auto store = [&](int score, NodeType node_type, Move best_move) {
+    if (transpos && (!tdata || tdata->depth == 0)) {
+      transpos->Put(score, node_type, 0, zkey, best_move);
+    }
+  };
+
+  const int orig_alpha = alpha;
+  const Side side = board.SideToMove();
+  bool in_check = attacks::InCheck(board, side);
   int standing_pat = StaticEval(board);
   if (!in_check) {
     if (standing_pat >= beta) {
+      store(standing_pat, NodeType::FAIL_HIGH_NODE, Move());
       return standing_pat;
     }
     if (standing_pat > alpha) {
       alpha = standing_pat;
     }
   }
-  MoveArray move_array = GenerateMoves<Variant::STANDARD>(board);
+  // Quiet moves are searched only when in check, so they need not be generated
+  // otherwise.
+  MoveArray move_array = in_check ? GenerateEvasions<Variant::STANDARD>(board)
+                                  : GenerateCaptures<Variant::STANDARD>(board);
   if (move_array.size() == 0) {
-    return in_check ? -WIN : DRAW;
+    // Without captures, the side may still be stalemated, for instance with its
+    // pieces pinned or blocked, so count the quiet moves too.
+    if (in_check || CountMoves<Variant::STANDARD>(board) == 0) {
+      const int score = in_check ? -WIN : DRAW;
+      store(score, NodeType::EXACT_NODE, Move());
+      return score;
+    }
   }
   const MoveInfoArray move_info_array =
-      OrderMoves<Variant::STANDARD>(board, move_array, nullptr);
+      OrderMoves<Variant::STANDARD>(board, move_array, &pref_moves);
+  Move best_move;
   for (size_t i = 0; i < move_info_array.size; ++i) {
     const MoveInfo& move_info = move_info_array.moves[i];
     const Move move = move_info.move;
-    if (in_check || move_info.type == MoveType::SEE_GOOD_CAPTURE) {
+    // The TT move is searched only if it is a capture, as quiet moves are
+    // not searched here unless in check.
+    const bool tt_capture =
+        move_info.type == MoveType::TT && IsCapture(board, move);
+    if (in_check || move_info.type == MoveType::SEE_GOOD_CAPTURE ||
+        tt_capture) {
       board.MakeMove(move);
       if (!in_check && move_info.type == MoveType::SEE_GOOD_CAPTURE &&
           standing_pat + move_info.score + FUTILITY_MARGIN < alpha &&
@@ -51,16 +106,22 @@ int Evaluate(Board& board, EGTB* egtb, int alpha, int beta) {
         board.UnmakeLastMove();
         continue;
       }
-      int score = -Evaluate<Variant::STANDARD>(board, egtb, -beta, -alpha);
+      int score = -Evaluate<Variant::STANDARD>(board, egtb, -beta, -alpha,
+                                               transpos, search_stats);
       board.UnmakeLastMove();
       if (score >= beta) {
+        store(score, NodeType::FAIL_HIGH_NODE, move);
         return score;
       }
       if (score > alpha) {
         alpha = score;
+        best_move = move;
       }
     }
   }
+  store(alpha, alpha > orig_alpha ? NodeType::EXACT_NODE
+                                  : NodeType::FAIL_LOW_NODE,
+        best_move);
   return alpha;
 }
 
@@ -88,5 +149,6 @@ int EvalResult(Board& board) {
 }
 
 template int Evaluate<Variant::STANDARD>(Board& board, EGTB* egtb, int alpha,
-                                         int beta);
+                                         int beta, TranspositionTable* transpos,
+                                         SearchStats* search_stats);
 template int EvalResult<Variant::STANDARD>(Board& board);
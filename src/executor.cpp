@@ -6,12 +6,15 @@
 #include "move_array.h"
 #include "movegen.h"
 #include "player.h"
+#include "proof_cache.h"
 #include "transpos.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
@@ -44,10 +47,14 @@ ExecutionContext::ExecutionContext(const Variant variant,
     transpos = std::unique_ptr<TranspositionTable>(options.transpos);
     own_transpos = false;
   } else {
-    transpos = std::make_unique<TranspositionTable>(TransposSize(variant));
+    transpos = std::make_unique<TranspositionTable>(
+        options.transpos_size > 0 ? options.transpos_size
+                                  : TransposSize(variant));
     own_transpos = true;
   }
-  player = std::make_unique<Player>(variant, *board, *transpos, *timer);
+  player = std::make_unique<Player>(variant, *board, *transpos, *timer,
+                                    options.search_threads,
+                                    options.proof_cache);
 }
 
 ExecutionContext::~ExecutionContext() {
@@ -93,9 +100,27 @@ bool Executor::MatchResult(vector<string>& response) {
 void Executor::RebuildMainContext() {
   ExecutionContext::Options options;
   options.init_fen = init_fen_;
+  options.transpos_size = transpos_size_;
+  options.search_threads = &search_threads_;
+  options.proof_cache = GetProofCache();
   main_context_ = std::make_unique<ExecutionContext>(variant_, options);
 }
 
+ProofCache* Executor::GetProofCache() {
+  if (proof_cache_path_.empty() || !IsAntichessLike(variant_)) {
+    return nullptr;
+  }
+  if (!proof_cache_ || proof_cache_->variant() != variant_) {
+    proof_cache_.reset();
+    try {
+      proof_cache_ = std::make_unique<ProofCache>(proof_cache_path_, variant_);
+    } catch (const std::runtime_error& e) {
+      std::cout << "# " << e.what() << std::endl;
+    }
+  }
+  return proof_cache_.get();
+}
+
 void Executor::RebuildPonderingContext() {
   if (!main_context_) {
     RebuildMainContext();
@@ -103,6 +128,8 @@ void Executor::RebuildPonderingContext() {
   ExecutionContext::Options options;
   options.init_fen = main_context_->board->ParseIntoFEN();
   options.transpos = main_context_->transpos.get();
+  options.search_threads = &search_threads_;
+  options.proof_cache = GetProofCache();
   pondering_context_ = std::make_unique<ExecutionContext>(variant_, options);
 }
 
@@ -236,6 +263,21 @@ vector<string> Executor::Execute(const string& command_str) {
     ponder_ = true;
   } else if (cmd == "nopost") {
     search_params_.thinking_output = false;
+  } else if (cmd == "memory") {
+    // XBoard memory command: "memory N" where N is the total memory (in MB)
+    // the engine may use. All of it goes to the transposition table, which is
+    // resized in place so the current game carries on.
+    StopPondering();
+    transpos_size_ =
+        TranspositionTable::SizeForMemory(StringToInt(cmd_parts.at(1)));
+    if (main_context_) {
+      main_context_->transpos->Resize(transpos_size_);
+    }
+  } else if (cmd == "cores") {
+    StopPondering();
+    search_threads_.Resize(std::max(1, StringToInt(cmd_parts.at(1))));
+    std::cout << "# Search threads = " << search_threads_.NumThreads()
+              << std::endl;
   } else if (cmd == "ping") {
     response.push_back("pong " + cmd_parts.at(1));
   } else if (cmd == "post") {
@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "player.h"
+#include "proof_cache.h"
 #include "transpos.h"
 
 #include <memory>
@@ -25,6 +26,16 @@ struct ExecutionContext final {
 
     // Use this transposition table instead of building a new one.
     TranspositionTable* transpos = nullptr;
+
+    // Number of buckets in the transposition table if a new one is built. If
+    // this is 0, use the compile time default for given variant.
+    uint64_t transpos_size = 0;
+
+    // Threads for the player to search with.
+    SearchThreads* search_threads = nullptr;
+
+    // Proven antichess positions for the player to use, may be null.
+    ProofCache* proof_cache = nullptr;
   };
 
   ExecutionContext(const Variant variant, const Options& options);
@@ -38,7 +49,8 @@ public:
   Executor(const std::string& name, const std::string& init_fen,
            const Variant variant)
       : name_(name), variant_(variant), time_centis_(10 * 60 * 100),
-        otime_centis_(10 * 60 * 100), init_fen_(init_fen) {}
+        otime_centis_(10 * 60 * 100), init_fen_(init_fen),
+        search_threads_(NUM_THREADS) {}
 
   ~Executor() { StopPondering(); }
 
@@ -49,6 +61,10 @@ public:
   // Returns true if program has to quit.
   bool quit() { return quit_; }
 
+  // Sets the file of the proof cache used in antichess and suicide games. The
+  // file is opened when a game of either variant is set up.
+  void SetProofCachePath(const std::string& path) { proof_cache_path_ = path; }
+
 private:
   // Checks if match has a result - i.e, the result code obtained from evaluator
   // is one of WIN, -WIN or DRAW. If a result is available, returns true, else
@@ -63,6 +79,10 @@ private:
 
   void OutputFEN() const;
 
+  // Returns the proof cache for the current variant, opening it if needed, or
+  // null if there is none.
+  ProofCache* GetProofCache();
+
   long AllocateTime() const;
 
   // Name of the computer player.
@@ -83,9 +103,21 @@ private:
   int inc_centis_ = 0;        // Increment per move in centiseconds
   int movestogo_ = 0;         // Moves to next time control
 
+  // Transposition table size (in buckets) set by the memory command; 0 if
+  // the compile time default is to be used.
+  uint64_t transpos_size_ = 0;
+
   // Custom board FEN which is used as initial board for all games if it is non
   // empty.
   std::string init_fen_;
+
+  // Search threads shared by the main and pondering contexts, which never
+  // search at the same time. These persist across moves and games.
+  SearchThreads search_threads_;
+
+  // Empty if no proof cache is used.
+  std::string proof_cache_path_;
+  std::unique_ptr<ProofCache> proof_cache_;
 };
 
 #endif
@@ -7,17 +7,19 @@
 #include "movegen.h"
 #include "pv_search.h"
 #include "san.h"
+#include "search_threads.h"
 #include "stats.h"
 #include "stopwatch.h"
 #include "timer.h"
 #include "transpos.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
-#include <thread>
 
 namespace {
 
@@ -41,18 +43,6 @@ struct IterationStat {
   // Stats for searching to this depth.
   std::vector<std::pair<Move, SearchStats>> move_stats;
 
-  void MergeStats(const IterationStat& istat) {
-    std::map<Move, SearchStats> stats_by_move;
-    for (const auto& item : istat.move_stats) {
-      stats_by_move[item.first] = item.second;
-    }
-    for (auto& item : move_stats) {
-      auto iter = stats_by_move.find(item.first);
-      if (iter != stats_by_move.end()) {
-        item.second.nodes_searched += iter->second.nodes_searched;
-      }
-    }
-  }
 };
 
 template <Variant variant>
@@ -61,12 +51,26 @@ public:
   IterativeDeepener(const IDSParams& ids_params, Board& board, Timer& timer,
                     TranspositionTable& transpos, EGTB* egtb)
       : ids_params_(ids_params), board_(board), timer_(timer),
-        transpos_(transpos), egtb_(egtb) {}
+        transpos_(transpos), egtb_(egtb),
+        search_threads_(ids_params.search_threads
+                            ? *ids_params.search_threads
+                            : local_search_threads_) {}
 
   IDSResult Search();
 
 private:
-  IterationStat FindBestMove(int max_depth);
+  // Searches root moves to given max_depth on given board. Stops and returns
+  // quickly if timer expires during computation.
+  IterationStat SearchRoot(Board& board, PVSearch<variant>& pv_search,
+                           const MoveArray& root_move_array, int max_depth,
+                           const Timer& timer);
+
+  // Lazy SMP: helper threads run their own iterative deepening loops over the
+  // root moves for the duration of the search, sharing results with the main
+  // thread only through the transposition table.
+  void StartHelpers();
+  void StopHelpers();
+  void HelperSearch(int thread_num);
 
   // Returns principal variation as a string of moves.
   std::string PV(const Move& root_move);
@@ -81,6 +85,12 @@ private:
   MoveArray root_move_array_;
 
   std::vector<IterationStat> iteration_stats_;
+
+  // Used when the caller does not provide search threads.
+  SearchThreads local_search_threads_{1};
+  SearchThreads& search_threads_;
+  std::atomic<U64> helper_nodes_searched_ = 0;
+  std::atomic<U64> helper_qnodes_searched_ = 0;
 };
 
 template <Variant variant>
@@ -124,7 +134,15 @@ IDSResult IterativeDeepener<variant>::Search() {
     return ids_result;
   }
 
+  SearchThread& main_thread = *search_threads_.threads[0];
+  main_thread.board = board_;
+  PVSearch<variant> pv_search(main_thread.board, &timer_, transpos_, egtb_,
+                              &main_thread.killers);
+  StartHelpers();
+
   // Iterative deepening starts here.
+  U64 main_nodes_searched = 0;
+  U64 main_qnodes_searched = 0;
   for (int depth = 1; depth <= ids_params_.search_depth; ++depth) {
     if (!iteration_stats_.empty()) {
       auto& move_stats = iteration_stats_.back().move_stats;
@@ -148,7 +166,8 @@ IDSResult IterativeDeepener<variant>::Search() {
       }
     }
 
-    const auto istat = FindBestMove(depth);
+    const auto istat = SearchRoot(main_thread.board, pv_search,
+                                  root_move_array_, depth, timer_);
     iteration_stats_.push_back(istat);
 
     double elapsed_time = stop_watch.ElapsedTime();
@@ -166,9 +185,14 @@ IDSResult IterativeDeepener<variant>::Search() {
     ids_result.best_move = last_istat.best_move;
     ids_result.best_move_score = last_istat.score;
     for (const auto& stat : last_istat.move_stats) {
-      ids_result.id_search_stats.nodes_searched += stat.second.nodes_searched;
+      main_nodes_searched += stat.second.nodes_searched;
+      main_qnodes_searched += stat.second.qnodes_searched;
       ids_result.id_search_stats.search_depth = stat.second.search_depth;
     }
+    ids_result.id_search_stats.nodes_searched =
+        main_nodes_searched + helper_nodes_searched_.load();
+    ids_result.id_search_stats.qnodes_searched =
+        main_qnodes_searched + helper_qnodes_searched_.load();
 
     // XBoard style thinking output.
     if (ids_params_.thinking_output) {
@@ -184,113 +208,131 @@ IDSResult IterativeDeepener<variant>::Search() {
       break;
     }
   }
+  StopHelpers();
   stop_watch.Stop();
   out << "# Time taken for ID search: " << stop_watch.ElapsedTime() << " centis"
       << std::endl;
+  out << "# Nodes searched: " << ids_result.id_search_stats.nodes_searched
+      << " main, " << ids_result.id_search_stats.qnodes_searched
+      << " quiescence" << std::endl;
   return ids_result;
 }
 
-// Finds the best move by searching up to given max_depth. Stops and returns
-// quickly if timer expires during computation. Updates iteration_stats_ with
-// details of current iteration.
 template <Variant variant>
-IterationStat IterativeDeepener<variant>::FindBestMove(int max_depth) {
-
-  auto search = [max_depth, root_move_array = root_move_array_,
-                 &transpos = transpos_,
-                 egtb = egtb_](int thread_num,
-                               Board board /* copy of board for each thread */,
-                               Timer& timer, IterationStat* ret_istat) mutable {
-    if (thread_num % 2 == 1) {
-      ++max_depth;
-    }
-    PVSearch<variant> pv_search(board, &timer, transpos, egtb);
-    IterationStat istat;
-    istat.depth = max_depth;
-    istat.best_move = root_move_array.get(0);
-    istat.score = -INF;
-    istat.root_moves_covered = 0;
-    for (unsigned int i = 0; i < root_move_array.size(); ++i) {
-      const Move& move = root_move_array.get(i);
-      board.MakeMove(move);
-      SearchStats search_stats;
-      int score = -INF;
-      if (i == 0 || max_depth < 5) {
-        score =
-            -pv_search.Search(max_depth - 1, -INF, -istat.score, search_stats);
-      } else {
-        bool lmr_triggered = false;
-        if (i >= 4 && max_depth >= 2) {
-          score = -pv_search.Search(max_depth - 2, -istat.score - 1,
-                                    -istat.score, search_stats);
-          lmr_triggered = true;
-        }
-        if (!lmr_triggered || score > istat.score) {
-          score = -pv_search.Search(max_depth - 1, -istat.score - 1,
-                                    -istat.score, search_stats);
-        }
-        if (score > istat.score) {
-          score = -pv_search.Search(max_depth - 1, -INF, -istat.score,
-                                    search_stats);
-        }
+IterationStat IterativeDeepener<variant>::SearchRoot(
+    Board& board, PVSearch<variant>& pv_search,
+    const MoveArray& root_move_array, const int max_depth, const Timer& timer) {
+  IterationStat istat;
+  istat.depth = max_depth;
+  istat.best_move = root_move_array.get(0);
+  istat.score = -INF;
+  istat.root_moves_covered = 0;
+  for (unsigned int i = 0; i < root_move_array.size(); ++i) {
+    const Move& move = root_move_array.get(i);
+    board.MakeMove(move);
+    SearchStats search_stats;
+    int score = -INF;
+    if (i == 0 || max_depth < 5) {
+      score =
+          -pv_search.Search(max_depth - 1, -INF, -istat.score, search_stats);
+    } else {
+      bool lmr_triggered = false;
+      if (i >= 4 && max_depth >= 2) {
+        score = -pv_search.Search(max_depth - 2, -istat.score - 1,
+                                  -istat.score, search_stats);
+        lmr_triggered = true;
       }
-      board.UnmakeLastMove();
-      istat.move_stats.push_back(std::make_pair(move, search_stats));
-
-      // Return on timer expiry only if we are not searching at depth 1. If
-      // searching at depth 1, we should at least quickly find a meaningful
-      // move even if timer expires before all the root moves are evaluated.
-      // Without this, there is a possibility of iterative deepener not
-      // reporting any moves at all in some extremely time constrained
-      // situations. Searching all root moves at depth 1 is very quick
-      // (sub-millisecond latency).
-      if (timer.Lapsed() && max_depth > 1) {
-        break;
+      if (!lmr_triggered || score > istat.score) {
+        score = -pv_search.Search(max_depth - 1, -istat.score - 1,
+                                  -istat.score, search_stats);
       }
       if (score > istat.score) {
-        istat.best_move = move;
-        istat.score = score;
+        score =
+            -pv_search.Search(max_depth - 1, -INF, -istat.score, search_stats);
       }
-      ++istat.root_moves_covered;
     }
-    // Add move to transposition table if at least the first root move was
-    // completely searched to current depth before timer lapsed. Otherwise,
-    // we don't really have any valid move to update. Due to move ordering
-    // guarantees, the first move in root_move_array_ is guaranteed to be
-    // the best known move before current iteration, which means any other
-    // move found to be better at this depth is at least better than that.
-    if (istat.root_moves_covered > 0) {
-      transpos.Put(istat.score, NodeType::EXACT_NODE, max_depth,
-                   board.ZobristKey(), istat.best_move);
+    board.UnmakeLastMove();
+    istat.move_stats.push_back(std::make_pair(move, search_stats));
+
+    // Return on timer expiry only if we are not searching at depth 1. If
+    // searching at depth 1, we should at least quickly find a meaningful
+    // move even if timer expires before all the root moves are evaluated.
+    // Without this, there is a possibility of iterative deepener not
+    // reporting any moves at all in some extremely time constrained
+    // situations. Searching all root moves at depth 1 is very quick
+    // (sub-millisecond latency).
+    if (timer.Lapsed() && max_depth > 1) {
+      break;
     }
-    *ret_istat = istat;
-  };
-
-  const int num_threads = (max_depth < 3 ? 1 : NUM_THREADS);
-  std::vector<std::thread> threads;
-  std::vector<IterationStat> istats(num_threads);
-
-  Timer threads_timer;
-  threads_timer.Run();
-
-  // Run num_threads - 1 search threads.
-  for (int i = 1; i < num_threads; ++i) {
-    threads.push_back(
-        std::thread(search, i, board_, std::ref(threads_timer), &istats.at(i)));
+    if (score > istat.score) {
+      istat.best_move = move;
+      istat.score = score;
+    }
+    ++istat.root_moves_covered;
+  }
+  // Add move to transposition table if at least the first root move was
+  // completely searched to current depth before timer lapsed. Otherwise,
+  // we don't really have any valid move to update. Due to move ordering
+  // guarantees, the first move in root_move_array is guaranteed to be
+  // the best known move before current iteration, which means any other
+  // move found to be better at this depth is at least better than that.
+  if (istat.root_moves_covered > 0) {
+    transpos_.Put(istat.score, NodeType::EXACT_NODE, max_depth,
+                  board.ZobristKey(), istat.best_move);
   }
+  return istat;
+}
 
-  // Run search in main thread.
-  search(0, board_, timer_, &istats.at(0));
-  threads_timer.Invalidate();
+template <Variant variant>
+void IterativeDeepener<variant>::StartHelpers() {
+  // Helper state is set up here in the calling thread as board_ and
+  // root_move_array_ are modified by the main thread once search starts.
+  for (int i = 1; i < search_threads_.NumThreads(); ++i) {
+    SearchThread& thread = *search_threads_.threads[i];
+    thread.board = board_;
+    thread.root_move_array = root_move_array_;
+    thread.timer.Run();
+  }
+  search_threads_.pool.Run(
+      [this](const int worker_num) { HelperSearch(worker_num + 1); });
+}
 
-  for (auto& thread : threads) {
-    thread.join();
+template <Variant variant>
+void IterativeDeepener<variant>::StopHelpers() {
+  for (int i = 1; i < search_threads_.NumThreads(); ++i) {
+    search_threads_.threads[i]->timer.Invalidate();
   }
+  search_threads_.pool.Wait();
+}
 
-  for (size_t i = 1; i < istats.size(); ++i) {
-    istats.at(0).MergeStats(istats.at(i));
+template <Variant variant>
+void IterativeDeepener<variant>::HelperSearch(const int thread_num) {
+  SearchThread& thread = *search_threads_.threads[thread_num];
+  PVSearch<variant> pv_search(thread.board, &thread.timer, transpos_, egtb_,
+                              &thread.killers);
+  // Odd numbered helpers start a ply deeper than the main thread so that the
+  // threads are spread over adjacent depths rather than all duplicating the
+  // same iteration.
+  for (int depth = 1 + thread_num % 2;
+       depth <= ids_params_.search_depth && !thread.timer.Lapsed(); ++depth) {
+    const IterationStat istat = SearchRoot(
+        thread.board, pv_search, thread.root_move_array, depth, thread.timer);
+    U64 nodes_searched = 0;
+    U64 qnodes_searched = 0;
+    for (const auto& stat : istat.move_stats) {
+      nodes_searched += stat.second.nodes_searched;
+      qnodes_searched += stat.second.qnodes_searched;
+    }
+    helper_nodes_searched_ += nodes_searched;
+    helper_qnodes_searched_ += qnodes_searched;
+    if (istat.root_moves_covered == 0) {
+      break;
+    }
+    if (istat.score == WIN) {
+      break;
+    }
+    thread.root_move_array.PushToFront(istat.best_move);
   }
-  return istats.at(0);
 }
 
 template <Variant variant>
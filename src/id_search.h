@@ -10,10 +10,15 @@
 #include "timer.h"
 #include "transpos.h"
 
+struct SearchThreads;
+
 // Iterative deepening search parameters.
 struct IDSParams {
   bool thinking_output = false;
   int search_depth = MAX_DEPTH;
+  // Threads to run Lazy SMP search with. If this is null, search runs in the
+  // calling thread alone.
+  SearchThreads* search_threads = nullptr;
   MoveArray pruned_ordered_moves;
 };
 
@@ -0,0 +1,78 @@
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+// A cache of a bounded number of values that evicts the least recently used
+// value when full. Safe to use from concurrent threads: keys are spread over
+// shards with a lock each, so that concurrent lookups rarely wait, and values
+// are shared so that they outlive their eviction while in use.
+template <typename Key, typename Value>
+class LRUCache {
+public:
+  // Each of num_shards shards holds up to capacity / num_shards values.
+  explicit LRUCache(const size_t capacity, const size_t num_shards = 8)
+      : shard_capacity_(std::max<size_t>(1, capacity / num_shards)),
+        num_shards_(num_shards),
+        shards_(std::make_unique<Shard[]>(num_shards)) {}
+
+  LRUCache(const LRUCache&) = delete;
+  LRUCache& operator=(const LRUCache&) = delete;
+
+  // Returns the value of key and marks it most recently used, or returns null
+  // if key is not in the cache.
+  std::shared_ptr<const Value> Get(const Key& key) {
+    Shard& shard = ShardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.map.find(key);
+    if (it == shard.map.end()) {
+      return nullptr;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return it->second->second;
+  }
+
+  // Adds or replaces the value of key, evicting the least recently used value
+  // of its shard if the shard is full.
+  void Put(const Key& key, std::shared_ptr<const Value> value) {
+    Shard& shard = ShardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.map.find(key);
+    if (it != shard.map.end()) {
+      it->second->second = std::move(value);
+      shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+      return;
+    }
+    if (shard.map.size() == shard_capacity_) {
+      shard.map.erase(shard.lru.back().first);
+      shard.lru.pop_back();
+    }
+    shard.lru.emplace_front(key, std::move(value));
+    shard.map.emplace(key, shard.lru.begin());
+  }
+
+private:
+  struct Shard {
+    std::mutex mutex;
+    // Most recently used first.
+    std::list<std::pair<Key, std::shared_ptr<const Value>>> lru;
+    std::unordered_map<Key, typename decltype(lru)::iterator> map;
+  };
+
+  Shard& ShardOf(const Key& key) {
+    return shards_[std::hash<Key>()(key) % num_shards_];
+  }
+
+  const size_t shard_capacity_;
+  const size_t num_shards_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+#endif
@@ -82,6 +82,182 @@ template MoveInfoArray OrderMoves<Variant::ANTICHESS>(Board&, const MoveArray&,
 template MoveInfoArray OrderMoves<Variant::SUICIDE>(Board&, const MoveArray&,
                                                     const PrefMoves*);
 
+namespace {
+
+// Score given to queen promotions so that they come before other moves of
+// their stage.
+constexpr int QUEEN_PROMOTION_SCORE = 10000;
+
+bool IsQueenPromotion(const Move move) {
+  return move.is_promotion() && PieceType(move.promoted_piece()) == QUEEN;
+}
+
+bool MoveInfoCompare(const MoveInfo& a, const MoveInfo& b) {
+  return a.type < b.type || (a.type == b.type && a.score > b.score);
+}
+
+} // namespace
+
+template <Variant variant>
+bool MovePicker<variant>::YieldedEarly(const Move move) const {
+  return (tt_move_yielded_ && move == pref_moves_.tt_move) ||
+         (killer_yielded_[0] && move == pref_moves_.killer1) ||
+         (killer_yielded_[1] && move == pref_moves_.killer2);
+}
+
+template <Variant variant>
+void MovePicker<variant>::GenerateCaptures() {
+  if constexpr (IsStandard(variant)) {
+    const MoveArray move_array = ::GenerateCaptures<variant>(board_);
+    for (size_t i = 0; i < move_array.size(); ++i) {
+      const Move move = move_array.get(i);
+      if (YieldedEarly(move)) {
+        continue;
+      }
+      if (IsQueenPromotion(move)) {
+        moves_.moves[num_captures_++] = {move, MoveType::QUEEN_PROMOTION,
+                                         QUEEN_PROMOTION_SCORE};
+      } else {
+        const int see_val = SEE(move, board_);
+        const auto type = (see_val >= 0) ? MoveType::SEE_GOOD_CAPTURE
+                                         : MoveType::SEE_BAD_CAPTURE;
+        moves_.moves[num_captures_++] = {move, type, see_val};
+      }
+    }
+  }
+  moves_.size = num_captures_;
+}
+
+template <Variant variant>
+void MovePicker<variant>::GenerateQuiets() {
+  moves_.size = num_captures_;
+  // Captures were generated in their own stage.
+  MoveArray move_array;
+  if constexpr (IsStandard(variant)) {
+    move_array = ::GenerateQuiets<variant>(board_);
+  } else {
+    move_array = GenerateMoves<variant>(board_);
+  }
+  for (size_t i = 0; i < move_array.size(); ++i) {
+    const Move move = move_array.get(i);
+    if (YieldedEarly(move)) {
+      continue;
+    }
+    if constexpr (IsStandard(variant)) {
+      if (IsQueenPromotion(move)) {
+        moves_.moves[moves_.size++] = {move, MoveType::QUEEN_PROMOTION,
+                                       QUEEN_PROMOTION_SCORE};
+        continue;
+      }
+      const int from_sq = move.from_index();
+      const int to_sq = move.to_index();
+      const Side side = board_.SideToMove();
+      const Piece piece = board_.PieceAt(from_sq);
+      moves_.moves[moves_.size++] = {
+          move, MoveType::QUIET,
+          standard::PSTVal(side, piece, to_sq) -
+              standard::PSTVal(side, piece, from_sq)};
+    } else {
+      board_.MakeMove(move);
+      const int opp_moves = CountMoves<Variant::ANTICHESS>(board_);
+      moves_.moves[moves_.size++] = {move, MoveType::UNCATEGORIZED, -opp_moves};
+      board_.UnmakeLastMove();
+    }
+  }
+  std::sort(moves_.moves + num_captures_, moves_.moves + moves_.size,
+            MoveInfoCompare);
+}
+
+template <Variant variant>
+bool MovePicker<variant>::Next(MoveInfo& move_info) {
+  switch (stage_) {
+  case Stage::TT:
+    stage_ = IsStandard(variant) ? Stage::GENERATE_CAPTURES : Stage::KILLERS;
+    if (pref_moves_.tt_move.is_valid() &&
+        IsLegalMove<variant>(board_, pref_moves_.tt_move)) {
+      tt_move_yielded_ = true;
+      move_info = {pref_moves_.tt_move, MoveType::TT, 0};
+      return true;
+    }
+    return Next(move_info);
+
+  case Stage::GENERATE_CAPTURES:
+    GenerateCaptures();
+    stage_ = Stage::GOOD_CAPTURES;
+    [[fallthrough]];
+
+  case Stage::GOOD_CAPTURES:
+    // Partial selection sort: only as many captures are sorted as are picked.
+    if (next_ < num_captures_) {
+      size_t best = next_;
+      for (size_t i = next_ + 1; i < num_captures_; ++i) {
+        if (moves_.moves[i].score > moves_.moves[best].score) {
+          best = i;
+        }
+      }
+      if (moves_.moves[best].type != MoveType::SEE_BAD_CAPTURE) {
+        std::swap(moves_.moves[next_], moves_.moves[best]);
+        move_info = moves_.moves[next_++];
+        return true;
+      }
+    }
+    next_bad_capture_ = next_;
+    stage_ = Stage::KILLERS;
+    [[fallthrough]];
+
+  case Stage::KILLERS:
+    while (killers_tried_ < 2) {
+      const int index = killers_tried_++;
+      const Move killer =
+          index == 0 ? pref_moves_.killer1 : pref_moves_.killer2;
+      // In standard chess, killers that capture here were already picked as
+      // captures.
+      if (killer.is_valid() && !YieldedEarly(killer) &&
+          !(IsStandard(variant) && IsCapture(board_, killer)) &&
+          IsLegalMove<variant>(board_, killer)) {
+        killer_yielded_[index] = true;
+        move_info = {killer, MoveType::KILLER, 1 - index};
+        return true;
+      }
+    }
+    stage_ = Stage::GENERATE_QUIETS;
+    [[fallthrough]];
+
+  case Stage::GENERATE_QUIETS:
+    GenerateQuiets();
+    next_ = num_captures_;
+    stage_ = Stage::QUIETS;
+    [[fallthrough]];
+
+  case Stage::QUIETS:
+    if (next_ < moves_.size) {
+      move_info = moves_.moves[next_++];
+      return true;
+    }
+    std::sort(moves_.moves + next_bad_capture_, moves_.moves + num_captures_,
+              MoveInfoCompare);
+    stage_ = Stage::BAD_CAPTURES;
+    [[fallthrough]];
+
+  case Stage::BAD_CAPTURES:
+    if (next_bad_capture_ < num_captures_) {
+      move_info = moves_.moves[next_bad_capture_++];
+      return true;
+    }
+    stage_ = Stage::DONE;
+    [[fallthrough]];
+
+  case Stage::DONE:
+    return false;
+  }
+  assert(false); // unreachable
+  return false;
+}
+
+template class MovePicker<Variant::STANDARD>;
+template class MovePicker<Variant::ANTICHESS>;
+template class MovePicker<Variant::SUICIDE>;
+
 template <Variant variant>
 MoveInfoArray OrderMovesByEvalScore(Board& board, EGTB* egtb,
                                     const MoveArray& move_array,
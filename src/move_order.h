@@ -50,6 +50,57 @@ template <Variant variant>
 MoveInfoArray OrderMoves(Board& board, const MoveArray& move_array,
                          const PrefMoves* pref_moves);
 
+// Yields the moves at a node one at a time in stages, so that moves of a stage
+// are generated and scored only if the stage is reached. This saves most of
+// the move ordering work at nodes where an early move causes a cutoff.
+//
+// Standard chess stages: TT move, good captures, killers, quiet moves (queen
+// promotions first) and bad captures. Antichess stages: TT move, killers and
+// the rest of the moves.
+template <Variant variant>
+class MovePicker {
+public:
+  MovePicker(Board& board, const PrefMoves& pref_moves)
+      : board_(board), pref_moves_(pref_moves) {}
+
+  // Sets move_info to the next move and returns true. Returns false if there
+  // are no more moves.
+  bool Next(MoveInfo& move_info);
+
+private:
+  enum class Stage {
+    TT,
+    GENERATE_CAPTURES,
+    GOOD_CAPTURES,
+    KILLERS,
+    GENERATE_QUIETS,
+    QUIETS,
+    BAD_CAPTURES,
+    DONE
+  };
+
+  // Returns true if move was yielded by the TT or killers stage.
+  bool YieldedEarly(Move move) const;
+
+  void GenerateCaptures();
+  void GenerateQuiets();
+
+  Board& board_;
+  const PrefMoves pref_moves_;
+  Stage stage_ = Stage::TT;
+  bool tt_move_yielded_ = false;
+  int killers_tried_ = 0;
+  bool killer_yielded_[2] = {false, false};
+
+  // Captures are kept in [0, num_captures_) and quiet moves after them. Good
+  // captures are picked from the front of the capture range by selection,
+  // which leaves the bad captures at its end.
+  MoveInfoArray moves_;
+  size_t num_captures_ = 0;
+  size_t next_ = 0;
+  size_t next_bad_capture_ = 0;
+};
+
 template <Variant variant>
 MoveInfoArray OrderMovesByEvalScore(Board& board, EGTB* egtb,
                                     const MoveArray& move_array,
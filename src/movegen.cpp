@@ -7,7 +7,9 @@
 
 #include <array>
 #include <cassert>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <utility>
 #include <vector>
@@ -272,83 +274,338 @@ void GenerateMovesInternal(const Board& board, MoveAccumulatorType& move_acc) {
   generate(ROOK);
 }
 
-template <Variant variant, Side side>
-  requires(IsStandard(variant))
-void GenerateMovesInternal(Board& board, MoveArray& move_array) {
-  MoveArray pseudo_legal_move_array;
+// Squares strictly between two squares on a common rank, file or diagonal
+// (between_bitboards) and all squares of the line through them
+// (line_bitboards). Both are empty for squares that are not aligned.
+struct AlignedSquares {
+  std::array<std::array<U64, 64>, 64> between_bitboards = {};
+  std::array<std::array<U64, 64>, 64> line_bitboards = {};
+};
 
-  auto generate = [&](const Piece piece_type) {
-    GeneratePieceMoves<variant, side>(board, PieceOfSide(piece_type, side),
-                                      false, pseudo_legal_move_array);
-  };
+const auto aligned_squares = []() {
+  auto aligned = std::make_unique<AlignedSquares>();
+  for (int from = 0; from < 64; ++from) {
+    for (int to = 0; to < 64; ++to) {
+      const int row_diff = int(ROW(to)) - int(ROW(from));
+      const int col_diff = int(COL(to)) - int(COL(from));
+      if (from == to || (row_diff != 0 && col_diff != 0 &&
+                         abs(row_diff) != abs(col_diff))) {
+        continue;
+      }
+      const int row_step = (row_diff > 0) - (row_diff < 0);
+      const int col_step = (col_diff > 0) - (col_diff < 0);
+      U64 between = 0ULL;
+      for (int row = ROW(from) + row_step, col = COL(from) + col_step;
+           row != int(ROW(to)) || col != int(COL(to));
+           row += row_step, col += col_step) {
+        between |= SetBit(row, col);
+      }
+      U64 line = 0ULL;
+      for (int row = ROW(from), col = COL(from); IsOnBoard(row, col);
+           row -= row_step, col -= col_step) {
+        line |= SetBit(row, col);
+      }
+      for (int row = ROW(from), col = COL(from); IsOnBoard(row, col);
+           row += row_step, col += col_step) {
+        line |= SetBit(row, col);
+      }
+      aligned->between_bitboards[from][to] = between;
+      aligned->line_bitboards[from][to] = line;
+    }
+  }
+  return aligned;
+}();
 
-  generate(BISHOP);
-  generate(KING);
-  generate(KNIGHT);
-  generate(PAWN);
-  generate(QUEEN);
-  generate(ROOK);
+U64 Between(const int from, const int to) {
+  return aligned_squares->between_bitboards[from][to];
+}
+
+U64 Line(const int from, const int to) {
+  return aligned_squares->line_bitboards[from][to];
+}
+
+// Squares attacked by the opponent of given side, with the king of given side
+// taken off the board so that squares behind it on a slider's line count as
+// attacked.
+template <Side side>
+U64 KingDangerBitBoard(const Board& board) {
+  constexpr Side opp_side = OppositeSide(side);
+  const U64 occupancy_bitboard =
+      board.BitBoard() ^ board.BitBoard(PieceOfSide(KING, side));
+  U64 danger_bitboard = PawnCaptures<opp_side>(
+      board.BitBoard(PieceOfSide(PAWN, opp_side)), ~0ULL);
+  for (const Piece piece_type : {KING, QUEEN, ROOK, BISHOP, KNIGHT}) {
+    const Piece piece = PieceOfSide(piece_type, opp_side);
+    U64 piece_bitboard = board.BitBoard(piece);
+    while (piece_bitboard) {
+      const int index = Lsb1(piece_bitboard);
+      danger_bitboard |= attacks::Attacks(occupancy_bitboard, index, piece);
+      piece_bitboard &= piece_bitboard - 1;
+    }
+  }
+  return danger_bitboard;
+}
+
+// Adds moves of given pawns to squares in target_mask. En passant captures are
+// not generated.
+template <Side side>
+void GenerateStandardPawnMoves(const Board& board, const U64 pawn_bitboard,
+                               const U64 target_mask,
+                               const bool generate_captures_only,
+                               MoveArray& move_array) {
+  constexpr Variant variant = Variant::STANDARD;
+  const U64 capturable = board.BitBoard(OppositeSide(side)) & target_mask;
+  AddPawnMoves<variant, side, NE_CAPTURE>(
+      bitmanip::siderel::PushNorthEast<side>(pawn_bitboard) & capturable,
+      move_array);
+  AddPawnMoves<variant, side, NW_CAPTURE>(
+      bitmanip::siderel::PushNorthWest<side>(pawn_bitboard) & capturable,
+      move_array);
+  if (generate_captures_only) {
+    return;
+  }
+  const U64 empty_bitboard = ~board.BitBoard();
+  const U64 one_step =
+      bitmanip::siderel::PushNorth<side>(pawn_bitboard) & empty_bitboard;
+  const U64 two_step = bitmanip::siderel::PushNorth<side>(one_step) &
+                       empty_bitboard & bitmanip::siderel::MaskRow<side>(3);
+  AddPawnMoves<variant, side, ONE_STEP>(one_step & target_mask, move_array);
+  AddPawnMoves<variant, side, TWO_STEP>(two_step & target_mask, move_array);
+}
 
+// Kinds of moves GenerateStandardMoves() generates: all moves, only captures
+// (including capturing promotions and en passant), or only the rest.
+enum class GenType { ALL, CAPTURES, QUIETS };
+
+// Generates legal moves of given kind. Checkers, pinned pieces and the squares
+// that resolve a check are worked out once up front so that moves are generated
+// legal, except for en passant captures which are rare enough to be verified by
+// making them.
+template <Variant variant, Side side>
+  requires(IsStandard(variant))
+void GenerateStandardMoves(Board& board, const GenType gen_type,
+                           MoveArray& move_array) {
+  constexpr Side opp_side = OppositeSide(side);
   constexpr Piece king_piece = PieceOfSide(KING, side);
-  const int king_index = Lsb1(board.BitBoard(king_piece));
+
+  const U64 occupancy_bitboard = board.BitBoard();
+  const U64 self_bitboard = board.BitBoard(side);
+  const U64 opp_bitboard = board.BitBoard(opp_side);
+  const U64 king_bitboard = board.BitBoard(king_piece);
+  const int king_index = Lsb1(king_bitboard);
 
   assert(king_index >= 0);
 
-  // Attacks on current playing side.
-  const U64 opp_attack_map = GenerateAttackBitBoard<OppositeSide(side)>(board);
+  const U64 opp_rooks = board.BitBoard(PieceOfSide(ROOK, opp_side)) |
+                        board.BitBoard(PieceOfSide(QUEEN, opp_side));
+  const U64 opp_bishops = board.BitBoard(PieceOfSide(BISHOP, opp_side)) |
+                          board.BitBoard(PieceOfSide(QUEEN, opp_side));
+
+  const U64 checkers =
+      (attacks::Attacks(occupancy_bitboard, king_index, KNIGHT) &
+       board.BitBoard(PieceOfSide(KNIGHT, opp_side))) |
+      PawnCaptures<side>(king_bitboard,
+                         board.BitBoard(PieceOfSide(PAWN, opp_side))) |
+      (attacks::Attacks(occupancy_bitboard, king_index, ROOK) & opp_rooks) |
+      (attacks::Attacks(occupancy_bitboard, king_index, BISHOP) & opp_bishops);
+
+  // A piece is pinned if it is the only piece between own king and an
+  // opponent slider on the same line.
+  U64 pinned = 0ULL;
+  U64 snipers = (attacks::Attacks(0ULL, king_index, ROOK) & opp_rooks) |
+                (attacks::Attacks(0ULL, king_index, BISHOP) & opp_bishops);
+  while (snipers) {
+    const int sniper_index = Lsb1(snipers);
+    const U64 blockers = Between(king_index, sniper_index) & occupancy_bitboard;
+    if (blockers && !(blockers & (blockers - 1))) {
+      pinned |= blockers & self_bitboard;
+    }
+    snipers &= snipers - 1;
+  }
 
-  // If king is under check, work on evading check.
-  if (opp_attack_map & board.BitBoard(king_piece)) {
-    for (size_t i = 0; i < pseudo_legal_move_array.size(); ++i) {
-      const Move& move = pseudo_legal_move_array.get(i);
+  // Squares other pieces may move to: when in check, they must capture the
+  // checker or block the check.
+  U64 target_mask = ~self_bitboard;
+  if (gen_type == GenType::CAPTURES) {
+    target_mask &= opp_bitboard;
+  } else if (gen_type == GenType::QUIETS) {
+    target_mask &= ~opp_bitboard;
+  }
+  const bool double_check = checkers & (checkers - 1);
+  if (checkers && !double_check) {
+    const int checker_index = Lsb1(checkers);
+    target_mask &= checkers | Between(king_index, checker_index);
+  }
 
-      board.MakeMove(move);
+  const U64 king_danger = KingDangerBitBoard<side>(board);
 
-      // New opponent attack map.
-      const U64 new_opp_attack_map =
-          GenerateAttackBitBoard<OppositeSide(side)>(board);
+  if (!checkers && gen_type != GenType::CAPTURES &&
+      (board.CanCastle(side, KING) || board.CanCastle(side, QUEEN))) {
+    GenerateCastlingMoves<side>(board, king_danger, move_array);
+  }
 
-      // Include move if legal.
-      if (!(new_opp_attack_map & board.BitBoard(king_piece))) {
-        move_array.Add(move);
+  auto generate = [&](const Piece piece_type) {
+    const Piece piece = PieceOfSide(piece_type, side);
+    if (piece_type == KING) {
+      U64 king_targets =
+          attacks::Attacks(occupancy_bitboard, king_index, KING) &
+          ~self_bitboard & ~king_danger;
+      if (gen_type == GenType::CAPTURES) {
+        king_targets &= opp_bitboard;
+      } else if (gen_type == GenType::QUIETS) {
+        king_targets &= ~opp_bitboard;
       }
-
-      board.UnmakeLastMove();
+      BitBoardToMoves(king_index, king_targets, move_array);
+      return;
     }
-  } else {
-    if (board.CanCastle(side, KING) || board.CanCastle(side, QUEEN)) {
-      GenerateCastlingMoves<side>(board, opp_attack_map, move_array);
+    if (double_check) {
+      return;
     }
+    if (piece_type == PAWN) {
+      const U64 pawn_bitboard = board.BitBoard(piece);
+      const bool generate_captures_only = gen_type == GenType::CAPTURES;
+      GenerateStandardPawnMoves<side>(board, pawn_bitboard & ~pinned,
+                                      target_mask, generate_captures_only,
+                                      move_array);
+      U64 pinned_pawns = pawn_bitboard & pinned;
+      while (pinned_pawns) {
+        const int index = Lsb1(pinned_pawns);
+        GenerateStandardPawnMoves<side>(
+            board, 1ULL << index, target_mask & Line(king_index, index),
+            generate_captures_only, move_array);
+        pinned_pawns &= pinned_pawns - 1;
+      }
+      if (gen_type == GenType::QUIETS) {
+        return;
+      }
+      // En passant captures can expose the king along the rank of both
+      // pawns, so they are checked by making them.
+      if (const U64 ep_bitboard = EnpassantBitBoard<side>(board); ep_bitboard) {
+        const int ep_index = Lsb1(ep_bitboard);
+        U64 capturers = PawnCaptures<opp_side>(ep_bitboard, pawn_bitboard);
+        while (capturers) {
+          const Move move(Lsb1(capturers), ep_index);
+          board.MakeMove(move);
+          if (!attacks::InCheck(board, side)) {
+            move_array.Add(move);
+          }
+          board.UnmakeLastMove();
+          capturers &= capturers - 1;
+        }
+      }
+      return;
+    }
+    U64 piece_bitboard = board.BitBoard(piece);
+    while (piece_bitboard) {
+      const int index = Lsb1(piece_bitboard);
+      U64 piece_targets =
+          attacks::Attacks(occupancy_bitboard, index, piece) & target_mask;
+      if (pinned & (1ULL << index)) {
+        piece_targets &= Line(king_index, index);
+      }
+      BitBoardToMoves(index, piece_targets, move_array);
+      piece_bitboard &= piece_bitboard - 1;
+    }
+  };
 
-    // Check if there are any pinned pieces. This is not an exact set of
-    // pins but always a superset.
-    const U64 potential_pins =
-        attacks::Attacks(board.BitBoard(king_piece), king_index, QUEEN) &
-        board.BitBoard(side);
-
-    for (size_t i = 0; i < pseudo_legal_move_array.size(); ++i) {
-      const Move& move = pseudo_legal_move_array.get(i);
+  generate(BISHOP);
+  generate(KING);
+  generate(KNIGHT);
+  generate(PAWN);
+  generate(QUEEN);
+  generate(ROOK);
+}
 
-      // Add all non-king, non-pinned piece moves.
-      if (move.from_index() != king_index &&
-          !((1ULL << move.from_index()) & potential_pins)) {
-        move_array.Add(move);
-        continue;
-      }
+template <Variant variant, Side side>
+  requires(IsStandard(variant))
+void GenerateMovesInternal(Board& board, MoveArray& move_array) {
+  GenerateStandardMoves<variant, side>(board, GenType::ALL, move_array);
+}
 
-      // For king moves and pinned pieces, make sure the moves are valid.
-      board.MakeMove(move);
+// Returns true if move follows the movement rules of the piece being moved.
+// Castling and whether the move leaves own king in check are not considered.
+template <Variant variant, Side side>
+bool IsPseudoLegalMove(const Board& board, const Move move) {
+  const int from_index = move.from_index();
+  const int to_index = move.to_index();
+  const Piece piece = board.PieceAt(from_index);
+  const U64 to_bitboard = 1ULL << to_index;
+  if (piece == NULLPIECE || PieceSide(piece) != side ||
+      (board.BitBoard(side) & to_bitboard)) {
+    return false;
+  }
+  if (PieceType(piece) != PAWN) {
+    return !move.is_promotion() &&
+           (attacks::Attacks(board.BitBoard(), from_index, piece) &
+            to_bitboard);
+  }
 
-      const U64 new_opp_attack_map =
-          GenerateAttackBitBoard<OppositeSide(side)>(board);
+  const U64 pawn_bitboard = 1ULL << from_index;
+  const U64 empty_bitboard = ~board.BitBoard();
+  const U64 one_step =
+      bitmanip::siderel::PushNorth<side>(pawn_bitboard) & empty_bitboard;
+  const U64 two_step = bitmanip::siderel::PushNorth<side>(one_step) &
+                       empty_bitboard & bitmanip::siderel::MaskRow<side>(3);
+  const U64 captures = PawnCaptures<side>(
+      pawn_bitboard,
+      board.BitBoard(OppositeSide(side)) | EnpassantBitBoard<side>(board));
+  if (!((one_step | two_step | captures) & to_bitboard)) {
+    return false;
+  }
+  if (to_index > 7 && to_index < 56) {
+    return !move.is_promotion();
+  }
+  switch (PieceType(move.promoted_piece())) {
+  case QUEEN:
+  case ROOK:
+  case BISHOP:
+  case KNIGHT:
+    return true;
+  case KING:
+    return IsAntichessLike(variant);
+  default:
+    return false;
+  }
+}
 
-      if (!(new_opp_attack_map & board.BitBoard(king_piece))) {
-        move_array.Add(move);
-      }
+template <Variant variant, Side side>
+  requires(IsStandard(variant))
+bool IsLegalMoveInternal(Board& board, const Move move) {
+  const Piece piece = board.PieceAt(move.from_index());
+  if (PieceType(piece) == KING && PieceSide(piece) == side &&
+      abs(int(COL(move.to_index())) - int(COL(move.from_index()))) > 1) {
+    // Castling is rare enough to not be worth a dedicated check.
+    return GenerateMoves<variant>(board).Contains(move);
+  }
+  if (!IsPseudoLegalMove<variant, side>(board, move)) {
+    return false;
+  }
+  // InCheck does not consider attacks by the opponent king, which matter
+  // here only for king moves.
+  constexpr Side opp_side = OppositeSide(side);
+  if (PieceType(piece) == KING &&
+      (attacks::Attacks(0ULL, move.to_index(), KING) &
+       board.BitBoard(PieceOfSide(KING, opp_side)))) {
+    return false;
+  }
+  board.MakeMove(move);
+  const bool legal = !attacks::InCheck(board, side);
+  board.UnmakeLastMove();
+  return legal;
+}
 
-      board.UnmakeLastMove();
-    }
+template <Variant variant, Side side>
+  requires(IsAntichessLike(variant))
+bool IsLegalMoveInternal(Board& board, const Move move) {
+  if (!IsPseudoLegalMove<variant, side>(board, move)) {
+    return false;
   }
+  // Captures are compulsory.
+  const bool capture =
+      board.PieceAt(move.to_index()) != NULLPIECE ||
+      (PieceType(board.PieceAt(move.from_index())) == PAWN &&
+       COL(move.to_index()) != COL(move.from_index()));
+  return capture || !Captures<side>(board);
 }
 
 } // namespace
@@ -370,6 +627,45 @@ template MoveArray GenerateMoves<Variant::STANDARD>(Board&);
 template MoveArray GenerateMoves<Variant::ANTICHESS>(Board&);
 template MoveArray GenerateMoves<Variant::SUICIDE>(Board&);
 
+template <Variant variant>
+  requires(IsStandard(variant))
+MoveArray GenerateCaptures(Board& board) {
+  MoveArray move_array;
+  if (board.SideToMove() == Side::BLACK) {
+    GenerateStandardMoves<variant, Side::BLACK>(board, GenType::CAPTURES,
+                                                move_array);
+  } else {
+    GenerateStandardMoves<variant, Side::WHITE>(board, GenType::CAPTURES,
+                                                move_array);
+  }
+  return move_array;
+}
+
+template <Variant variant>
+  requires(IsStandard(variant))
+MoveArray GenerateQuiets(Board& board) {
+  MoveArray move_array;
+  if (board.SideToMove() == Side::BLACK) {
+    GenerateStandardMoves<variant, Side::BLACK>(board, GenType::QUIETS,
+                                                move_array);
+  } else {
+    GenerateStandardMoves<variant, Side::WHITE>(board, GenType::QUIETS,
+                                                move_array);
+  }
+  return move_array;
+}
+
+template <Variant variant>
+  requires(IsStandard(variant))
+MoveArray GenerateEvasions(Board& board) {
+  assert(attacks::InCheck(board, board.SideToMove()));
+  return GenerateMoves<variant>(board);
+}
+
+template MoveArray GenerateCaptures<Variant::STANDARD>(Board&);
+template MoveArray GenerateQuiets<Variant::STANDARD>(Board&);
+template MoveArray GenerateEvasions<Variant::STANDARD>(Board&);
+
 template <Variant variant>
   requires(IsStandard(variant))
 int CountMovesInternal(Board& board) {
@@ -399,6 +695,18 @@ template int CountMoves<Variant::STANDARD>(Board&);
 template int CountMoves<Variant::ANTICHESS>(Board&);
 template int CountMoves<Variant::SUICIDE>(Board&);
 
+template <Variant variant>
+bool IsLegalMove(Board& board, const Move move) {
+  if (board.SideToMove() == Side::BLACK) {
+    return IsLegalMoveInternal<variant, Side::BLACK>(board, move);
+  }
+  return IsLegalMoveInternal<variant, Side::WHITE>(board, move);
+}
+
+template bool IsLegalMove<Variant::STANDARD>(Board&, Move);
+template bool IsLegalMove<Variant::ANTICHESS>(Board&, Move);
+template bool IsLegalMove<Variant::SUICIDE>(Board&, Move);
+
 bool IsValidMove(const Variant variant, Board& board, const Move move) {
   if (variant == Variant::STANDARD) {
     return GenerateMoves<Variant::STANDARD>(board).Contains(move);
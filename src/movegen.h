@@ -12,8 +12,45 @@ MoveArray GenerateMoves(Board& board);
 template <Variant variant>
 int CountMoves(Board& board);
 
+// Generates legal captures, including en passant captures and promotions that
+// capture. Promotions to empty squares are not included.
+template <Variant variant>
+  requires(IsStandard(variant))
+MoveArray GenerateCaptures(Board& board);
+
+// Generates legal moves that GenerateCaptures() does not: moves to empty
+// squares other than en passant captures, including castling and promotions
+// to empty squares.
+template <Variant variant>
+  requires(IsStandard(variant))
+MoveArray GenerateQuiets(Board& board);
+
+// Generates legal moves for the side to move, which must be in check. This is
+// GenerateMoves() with the precondition asserted, not a dedicated evasion
+// generator: the legal generator already discards moves that leave the king in
+// check.
+template <Variant variant>
+  requires(IsStandard(variant))
+MoveArray GenerateEvasions(Board& board);
+
 bool IsValidMove(Variant variant, Board& board, Move move);
 
+// Returns true if move, a move of the side to move on board, is a capture.
+// Unlike a test of the destination square, this includes en passant captures,
+// as the moves of GenerateCaptures() do.
+inline bool IsCapture(const Board& board, const Move move) {
+  return board.PieceAt(move.to_index()) != NULLPIECE ||
+         (PieceType(board.PieceAt(move.from_index())) == PAWN &&
+          COL(move.to_index()) != COL(move.from_index()));
+}
+
+// Returns true if move is legal on board. Unlike IsValidMove, this does not
+// generate all moves, so it is cheap enough to vet moves carried over from
+// other positions (such as transposition table and killer moves) before they
+// are searched.
+template <Variant variant>
+bool IsLegalMove(Board& board, Move move);
+
 // Computes all possible attacks on the board by the attacking side.
 U64 ComputeAttackMap(const Board& board, Side attacker_side);
 
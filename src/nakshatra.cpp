@@ -1,8 +1,13 @@
 #include "common.h"
+#include "egtb.h"
 #include "executor.h"
 #include "movegen.h"
+#include "nnue.h"
+#include "params/params.h"
 
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -22,13 +27,57 @@ int main(int argc, char** argv) {
   cout << "feature debug=1" << endl;
   cout << "feature setboard=1" << endl;
   cout << "feature ping=1" << endl;
+  cout << "feature memory=1" << endl;
+  cout << "feature smp=1" << endl;
   cout << "feature myname=\"" << ENGINE_NAME << "\"" << endl;
   cout << "feature sigint=0" << endl;
   cout << "feature sigterm=0" << endl;
   cout << "feature done=1" << endl;
 
+  // Declared before the executor so that it outlives the executor's boards.
+  std::unique_ptr<nnue::Network> network;
   Executor executor(ENGINE_NAME);
 
+  // Optional command line argument "--memory=N" sets the memory (in MB) to be
+  // used at startup, same as the XBoard "memory N" command.
+  // "--proof_cache=FILE" keeps positions proven in antichess games in FILE
+  // across runs, see ProofCache. "--egtb=FILE" loads the antichess EGTB from
+  // FILE, written by egtb_gen, instead of ./antichess.egtb. "--nnue=FILE"
+  // evaluates standard chess with the network in FILE instead of
+  // BlessedNetwork(), see nnue.h.
+  string nnue_file = BlessedNetwork();
+  for (int i = 1; i < argc; ++i) {
+    const string arg = argv[i];
+    const string memory_flag = "--memory=";
+    const string proof_cache_flag = "--proof_cache=";
+    const string egtb_flag = "--egtb=";
+    const string nnue_flag = "--nnue=";
+    if (arg.rfind(memory_flag, 0) == 0) {
+      executor.Execute("memory " + arg.substr(memory_flag.size()));
+    } else if (arg.rfind(proof_cache_flag, 0) == 0) {
+      executor.SetProofCachePath(arg.substr(proof_cache_flag.size()));
+    } else if (arg.rfind(egtb_flag, 0) == 0) {
+      SetEGTBFile(arg.substr(egtb_flag.size()));
+    } else if (arg.rfind(nnue_flag, 0) == 0) {
+      nnue_file = arg.substr(nnue_flag.size());
+    } else {
+      std::cerr << "ERROR: Unknown argument " << arg << endl;
+      return 1;
+    }
+  }
+
+  // Boards pick up the network as they are constructed, so it is loaded
+  // before any command creates one.
+  if (!nnue_file.empty()) {
+    try {
+      network = nnue::LoadNetwork(nnue_file);
+      nnue::SetActiveNetwork(network.get());
+      cout << "# NNUE=" << nnue_file << endl;
+    } catch (const std::runtime_error& e) {
+      cout << "# " << e.what() << endl;
+    }
+  }
+
   string cmd_string;
   while (getline(std::cin, cmd_string)) {
     const std::vector<string> response = executor.Execute(cmd_string);
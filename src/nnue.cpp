@@ -0,0 +1,207 @@
+#include "nnue.h"
+#include "common.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_features;
+  uint32_t hidden_size;
+  uint32_t reserved;
+};
+
+constexpr char kMagic[8] = {'N', 'K', 'N', 'N', 'U', 'E', '\0', '\0'};
+constexpr uint32_t kVersion = 1;
+
+Header MakeHeader() {
+  Header header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.num_features = nnue::kNumFeatures;
+  header.hidden_size = nnue::kHiddenSize;
+  return header;
+}
+
+std::runtime_error Error(const std::string& path, const std::string& what) {
+  return std::runtime_error("network " + path + ": " + what);
+}
+
+const nnue::Network* active_network = nullptr;
+
+// Input index of piece on square sq from the point of view of side 0 (white)
+// or 1 (black).
+int FeatureIndex(const int side, const Piece piece, const int sq) {
+  return side == 0 ? PieceIndex(piece) * 64 + sq
+                   : PieceIndex(-piece) * 64 + (sq ^ 56);
+}
+
+// Adds (or subtracts, if Add is false) weights to values, kHiddenSize each.
+template <bool Add>
+void Update(const int16_t* weights, int16_t* values) {
+#if defined(__AVX2__)
+  for (int i = 0; i < nnue::kHiddenSize; i += 16) {
+    const __m256i v = _mm256_load_si256(reinterpret_cast<__m256i*>(values + i));
+    const __m256i w =
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(values + i),
+                       Add ? _mm256_add_epi16(v, w) : _mm256_sub_epi16(v, w));
+  }
+#elif defined(__SSE2__)
+  for (int i = 0; i < nnue::kHiddenSize; i += 8) {
+    const __m128i v = _mm_load_si128(reinterpret_cast<__m128i*>(values + i));
+    const __m128i w =
+        _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i));
+    _mm_store_si128(reinterpret_cast<__m128i*>(values + i),
+                    Add ? _mm_add_epi16(v, w) : _mm_sub_epi16(v, w));
+  }
+#else
+  for (int i = 0; i < nnue::kHiddenSize; ++i) {
+    values[i] += Add ? weights[i] : -weights[i];
+  }
+#endif
+}
+
+// Sum over i of values[i] clipped to [0, kQA] times weights[i].
+int32_t ClippedDot(const int16_t* values, const int16_t* weights) {
+#if defined(__AVX2__)
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i qa = _mm256_set1_epi16(nnue::kQA);
+  __m256i sum = zero;
+  for (int i = 0; i < nnue::kHiddenSize; i += 16) {
+    __m256i v =
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(values + i));
+    v = _mm256_min_epi16(_mm256_max_epi16(v, zero), qa);
+    const __m256i w =
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i));
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, w));
+  }
+  __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum),
+                                 _mm256_extracti128_si256(sum, 1));
+  sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4E));
+  sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xB1));
+  return _mm_cvtsi128_si32(sum128);
+#elif defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i qa = _mm_set1_epi16(nnue::kQA);
+  __m128i sum = zero;
+  for (int i = 0; i < nnue::kHiddenSize; i += 8) {
+    __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(values + i));
+    v = _mm_min_epi16(_mm_max_epi16(v, zero), qa);
+    const __m128i w =
+        _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i));
+    sum = _mm_add_epi32(sum, _mm_madd_epi16(v, w));
+  }
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+  return _mm_cvtsi128_si32(sum);
+#else
+  int32_t sum = 0;
+  for (int i = 0; i < nnue::kHiddenSize; ++i) {
+    sum += std::clamp<int32_t>(values[i], 0, nnue::kQA) * weights[i];
+  }
+  return sum;
+#endif
+}
+
+} // namespace
+
+namespace nnue {
+
+std::unique_ptr<Network> LoadNetwork(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    throw Error(path, strerror(errno));
+  }
+  Header header;
+  const Header expected = MakeHeader();
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      std::memcmp(&header, &expected, sizeof(header)) != 0) {
+    throw Error(path, "not a network of this version and architecture");
+  }
+  auto network = std::make_unique<Network>();
+  const auto read = [&in](auto& field) {
+    in.read(reinterpret_cast<char*>(&field), sizeof(field));
+  };
+  read(network->feature_weights);
+  read(network->feature_biases);
+  read(network->output_weights);
+  read(network->output_bias);
+  if (!in) {
+    throw Error(path, "truncated weights");
+  }
+  return network;
+}
+
+void SaveNetwork(const Network& network, const std::string& path) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    throw Error(path, strerror(errno));
+  }
+  const Header header = MakeHeader();
+  const auto write = [&out](const auto& field) {
+    out.write(reinterpret_cast<const char*>(&field), sizeof(field));
+  };
+  write(header);
+  write(network.feature_weights);
+  write(network.feature_biases);
+  write(network.output_weights);
+  write(network.output_bias);
+  out.flush();
+  if (!out) {
+    throw Error(path, "write failed");
+  }
+}
+
+const Network* ActiveNetwork() { return active_network; }
+
+void SetActiveNetwork(const Network* network) { active_network = network; }
+
+void Reset(const Network& network, Accumulator& accumulator) {
+  for (int side = 0; side < 2; ++side) {
+    std::memcpy(accumulator.values[side], network.feature_biases,
+                sizeof(network.feature_biases));
+  }
+}
+
+void AddPiece(const Network& network, const Piece piece, const int sq,
+              Accumulator& accumulator) {
+  for (int side = 0; side < 2; ++side) {
+    Update<true>(network.feature_weights[FeatureIndex(side, piece, sq)],
+                 accumulator.values[side]);
+  }
+}
+
+void RemovePiece(const Network& network, const Piece piece, const int sq,
+                 Accumulator& accumulator) {
+  for (int side = 0; side < 2; ++side) {
+    Update<false>(network.feature_weights[FeatureIndex(side, piece, sq)],
+                  accumulator.values[side]);
+  }
+}
+
+int Evaluate(const Network& network, const Accumulator& accumulator,
+             const Side side) {
+  const int us = side == Side::WHITE ? 0 : 1;
+  const int32_t sum =
+      ClippedDot(accumulator.values[us], network.output_weights[0]) +
+      ClippedDot(accumulator.values[us ^ 1], network.output_weights[1]);
+  const int64_t score =
+      (int64_t(sum) + network.output_bias) * kScale / (kQA * kQB);
+  return static_cast<int>(std::clamp<int64_t>(score, -WIN + 1, WIN - 1));
+}
+
+} // namespace nnue
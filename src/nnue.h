@@ -0,0 +1,76 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include "common.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// An efficiently updatable neural network evaluating standard chess positions,
+// optionally used in place of the hand-crafted evaluation of BlessedParams().
+//
+// The network is 768 -> 2x kHiddenSize -> 1. Each input is a piece on a square
+// as seen from one side, so that a position has one set of active inputs from
+// white's point of view and one from black's, the latter with colors swapped
+// and the board mirrored vertically. The hidden layer of each point of view is
+// an accumulator that the board updates incrementally as pieces are placed and
+// removed. The output layer takes both accumulators, clipped to [0, kQA], with
+// that of the side to move first.
+namespace nnue {
+
+constexpr int kNumFeatures = 768;
+constexpr int kHiddenSize = 128;
+
+// Quantization of the trained float weights: hidden layer weights and biases
+// are scaled by kQA, output weights by kQB and the output bias by kQA * kQB.
+// The output is scaled by kScale into centipawns.
+constexpr int kQA = 255;
+constexpr int kQB = 64;
+constexpr int kScale = 400;
+
+struct Network {
+  alignas(32) int16_t feature_weights[kNumFeatures][kHiddenSize];
+  alignas(32) int16_t feature_biases[kHiddenSize];
+  // Weights of the side to move's accumulator, then of the other side's.
+  alignas(32) int16_t output_weights[2][kHiddenSize];
+  int16_t output_bias;
+};
+
+// Hidden layer values of a position from white's (index 0) and black's (index
+// 1) points of view.
+struct Accumulator {
+  alignas(32) int16_t values[2][kHiddenSize];
+};
+
+// Reads a network written by SaveNetwork(). Throws std::runtime_error if the
+// file cannot be read or holds a network of another architecture.
+std::unique_ptr<Network> LoadNetwork(const std::string& path);
+
+// Writes network to a file at path, as a header followed by the weights in
+// declaration order. Throws std::runtime_error on failure.
+void SaveNetwork(const Network& network, const std::string& path);
+
+// The network standard chess boards evaluate with, or null to use the
+// hand-crafted evaluation. Boards pick it up when constructed, so it should
+// be set before any board is. The network must outlive the boards using it.
+const Network* ActiveNetwork();
+void SetActiveNetwork(const Network* network);
+
+// Sets accumulator to that of an empty board.
+void Reset(const Network& network, Accumulator& accumulator);
+
+// Updates accumulator for piece placed on or removed from square sq.
+void AddPiece(const Network& network, Piece piece, int sq,
+              Accumulator& accumulator);
+void RemovePiece(const Network& network, Piece piece, int sq,
+                 Accumulator& accumulator);
+
+// Score in centipawns of the position with given accumulator, from the point
+// of view of side.
+int Evaluate(const Network& network, const Accumulator& accumulator,
+             Side side);
+
+} // namespace nnue
+
+#endif
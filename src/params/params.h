@@ -10,6 +10,8 @@
 #include "params/ZeroParams.h"
 #include "std_eval_params.h"
 
+#include <string>
+
 inline StdEvalParams<int> BlessedParams() {
   return Exp20251229Iter1Epoch71Step45000Int();
 }
@@ -18,4 +20,9 @@ inline StdEvalParams<double> BlessedParamsDbl() {
   return Exp20251229Iter1Epoch71Step45000Dbl();
 }
 
+// Network file evaluating standard chess in place of BlessedParams() (see
+// nnue.h), or empty for the hand-crafted evaluation. Overridden by the
+// "--nnue=FILE" flag.
+inline std::string BlessedNetwork() { return ""; }
+
 #endif
@@ -12,6 +12,7 @@
 #include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <optional>
 #include <signal.h>
 #include <sys/time.h>
 
@@ -25,15 +26,17 @@ Move Player::SearchInternal(const SearchParams& search_params,
   transpos_.SetEpoch(board_.HalfMoves());
 
   std::ostream& out = search_params.thinking_output ? std::cout : nullstream;
-  if (egtb_ && OnlyOneBitSet(board_.BitBoard(Side::WHITE)) &&
-      OnlyOneBitSet(board_.BitBoard(Side::BLACK))) {
-    out << "# Num pieces <= 2, looking up EGTB..." << std::endl;
-    const EGTBIndexEntry* egtb_entry = egtb_->Lookup(board_);
-    if (egtb_entry) {
+  if (egtb_ && PopCount(board_.BitBoard()) <= egtb_->MaxPieces()) {
+    out << "# Num pieces <= " << egtb_->MaxPieces() << ", looking up EGTB..."
+        << std::endl;
+    const std::optional<EGTBIndexEntry> egtb_entry =
+        egtb_->LookupWithMove(board_);
+    if (egtb_entry && egtb_entry->next_move.is_valid()) {
       PrintEGTBIndexEntry(*egtb_entry);
       return egtb_entry->next_move;
     } else {
-      out << "# Num pieces <= 2, but EGTB missed!" << std::endl;
+      out << "# Num pieces <= " << egtb_->MaxPieces() << ", but EGTB missed!"
+          << std::endl;
     }
   }
   // If the move is forced, just move.
@@ -43,7 +46,8 @@ Move Player::SearchInternal(const SearchParams& search_params,
   }
 
   IDSParams ids_params{.thinking_output = search_params.thinking_output,
-                       .search_depth = search_params.search_depth};
+                       .search_depth = search_params.search_depth,
+                       .search_threads = search_threads_};
 
   if constexpr (IsAntichessLike(variant)) {
     if (search_params.antichess_pns) {
@@ -53,10 +57,18 @@ Move Player::SearchInternal(const SearchParams& search_params,
       StopWatch pn_stop_watch;
       pn_stop_watch.Start();
 
+      // Only df-pn searches on more than one thread.
+      const PNSParams::PNSearchType pns_type =
+          search_threads_ && search_threads_->NumThreads() > 1
+              ? PNSParams::DFPN
+              : search_params.antichess_pns_type;
       const PNSResult pns_result =
-          PNSearch<variant>(board_, &transpos_, egtb_, &pns_timer)
-              .Search({.max_nodes = 10000000,
-                       .quiet = !search_params.thinking_output});
+          PNSearch<variant>(board_, &transpos_, egtb_, &pns_timer,
+                            proof_cache_)
+              .Search({.pns_type = pns_type,
+                       .max_nodes = 10000000,
+                       .quiet = !search_params.thinking_output,
+                       .search_threads = search_threads_});
 
       pn_stop_watch.Stop();
       out << "# PNS time: " << pn_stop_watch.ElapsedTime() << " centis"
@@ -5,6 +5,9 @@
 #include "common.h"
 #include "egtb.h"
 #include "move.h"
+#include "pn_search.h"
+#include "proof_cache.h"
+#include "search_threads.h"
 #include "timer.h"
 #include "transpos.h"
 
@@ -15,14 +18,24 @@ struct SearchParams {
   bool thinking_output = false;
   int search_depth = MAX_DEPTH;
   bool antichess_pns = true;
+  // Type of proof-number search run ahead of the iterative deepening search
+  // in antichess, if antichess_pns is set. With more than one search thread,
+  // DFPN is used instead, as the only type that searches in parallel.
+  PNSParams::PNSearchType antichess_pns_type = PNSParams::PN1;
 };
 
 class Player {
 public:
+  // If search_threads is not null, iterative deepening search and antichess
+  // proof-number search are run on the given threads. If proof_cache is not
+  // null, antichess proof-number search looks up and adds proven positions
+  // there.
   Player(const Variant variant, Board& board, TranspositionTable& transpos,
-         Timer& timer)
+         Timer& timer, SearchThreads* search_threads = nullptr,
+         ProofCache* proof_cache = nullptr)
       : variant_(variant), board_(board), transpos_(transpos), timer_(timer),
-        egtb_(GetEGTB(variant)) {}
+        egtb_(GetEGTB(variant)), search_threads_(search_threads),
+        proof_cache_(proof_cache) {}
 
   Move Search(const SearchParams& search_params, long time_for_move_centis);
 
@@ -36,6 +49,8 @@ private:
   TranspositionTable& transpos_;
   Timer& timer_;
   EGTB* egtb_;
+  SearchThreads* search_threads_;
+  ProofCache* proof_cache_;
 };
 
 #endif
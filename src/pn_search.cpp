@@ -9,6 +9,7 @@
 #include "transpos.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cfloat>
 #include <climits>
@@ -16,55 +17,52 @@
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <optional>
+#include <stdexcept>
 #include <unistd.h>
 #include <utility>
 #include <vector>
 
 #define PNS_MAX_DEPTH 600
 
-template <Variant variant>
-  requires(IsAntichessLike(variant))
-PNSResult PNSearch<variant>::Search(const PNSParams& pns_params) {
-  PNSResult pns_result;
-  if (pns_tree_) {
-    Delete(pns_tree_);
-    pns_tree_ = nullptr;
-  }
-  pns_tree_ = new PNSNode;
-
-  Pns(pns_params, pns_tree_);
-  pns_result.pns_tree = pns_tree_;
-  pns_result.tree_size = pns_tree_->tree_size;
-
-  for (PNSNode* pns_node : pns_tree_->children) {
-    // This is from the current playing side perspective.
-    double score;
-    int result;
-    if (pns_node->proof == 0) {
-      score = DBL_MAX;
-      result = -WIN;
+namespace {
+
+// Proofs a search collects before putting them in the proof cache.
+constexpr size_t kMaxNewProofs = 4096;
+
+// Returns stats of a root move leading to a position with given proof and
+// disproof numbers.
+PNSResult::MoveStat MakeMoveStat(const Move move, const int proof,
+                                 const int disproof, const uint64_t tree_size) {
+  // This is from the current playing side perspective.
+  double score;
+  int result;
+  if (proof == 0) {
+    score = DBL_MAX;
+    result = -WIN;
+  } else {
+    score = static_cast<double>(disproof) / proof;
+    if (proof == INF_NODES && disproof == 0) {
+      result = WIN;
+    } else if (proof == INF_NODES && disproof == INF_NODES) {
+      result = DRAW;
     } else {
-      score = static_cast<double>(pns_node->disproof) / pns_node->proof;
-      if (pns_node->proof == INF_NODES && pns_node->disproof == 0) {
-        result = WIN;
-      } else if (pns_node->proof == INF_NODES &&
-                 pns_node->disproof == INF_NODES) {
-        result = DRAW;
-      } else {
-        result = UNKNOWN;
-      }
+      result = UNKNOWN;
     }
-    pns_result.ordered_moves.push_back(
-        {pns_node->move, score, pns_node->tree_size, result});
   }
-  sort(pns_result.ordered_moves.begin(), pns_result.ordered_moves.end(),
+  return {move, score, tree_size, result};
+}
+
+// Sorts the root moves best first and prints them unless quiet.
+void OrderMoveStats(const PNSParams& pns_params, PNSResult* pns_result) {
+  sort(pns_result->ordered_moves.begin(), pns_result->ordered_moves.end(),
        [](const PNSResult::MoveStat& a, const PNSResult::MoveStat& b) {
          return a.score < b.score;
        });
   // Print the ordered moves.
   if (!pns_params.quiet) {
     std::cout << "# Move, score, tree_size:" << std::endl;
-    for (const auto& move_stat : pns_result.ordered_moves) {
+    for (const auto& move_stat : pns_result->ordered_moves) {
       static std::map<int, std::string> result_map = {
           {WIN, "WIN"}, {-WIN, "LOSS"}, {DRAW, "DRAW"}, {UNKNOWN, "UNKNOWN"}};
       std::cout << "# " << move_stat.move.str() << ", " << move_stat.score
@@ -72,13 +70,80 @@ PNSResult PNSearch<variant>::Search(const PNSParams& pns_params) {
                 << result_map.at(move_stat.result) << std::endl;
     }
   }
+}
+
+// Adds proof or disproof numbers of children, saturating at INF_NODES - 1 for
+// sums of finite numbers.
+int SumNodes(const int64_t a, const int64_t b) {
+  if (a == INF_NODES || b == INF_NODES) {
+    return INF_NODES;
+  }
+  return static_cast<int>(std::min<int64_t>(a + b, INF_NODES - 1));
+}
+
+// Node budget of each search of a root move in the first round of a parallel
+// search. It doubles every round.
+constexpr int kParallelRoundNodes = 1000;
+
+// A threshold no proof or disproof number reaches, not even INF_NODES.
+constexpr int64_t kUnboundedNodes = int64_t(INF_NODES) + 1;
+
+// Returns true if a position with given proof and disproof numbers is won,
+// lost or drawn.
+bool DfpnSolved(const int proof, const int disproof) {
+  return proof == 0 || disproof == 0 ||
+         (proof == INF_NODES && disproof == INF_NODES);
+}
+
+} // namespace
+
+template <Variant variant>
+  requires(IsAntichessLike(variant))
+PNSResult PNSearch<variant>::Search(const PNSParams& pns_params) {
+  PNSResult pns_result;
+  if (pns_params.pns_type == PNSParams::DFPN) {
+    pns_result = pns_params.search_threads &&
+                         pns_params.search_threads->NumThreads() > 1
+                     ? ParallelSearch(pns_params)
+                     : DfpnSearch(pns_params);
+  } else if (pns_params.node_store == PNSParams::COMPACT_NODES) {
+    pns_result = Search(compact_pns_tree_, pns_params);
+  } else {
+    pns_result = Search(pns_tree_, pns_params);
+    pns_result.pns_tree = pns_tree_.Root();
+  }
+  FlushProofs();
+  return pns_result;
+}
+
+template <Variant variant>
+  requires(IsAntichessLike(variant))
+template <typename Tree>
+PNSResult PNSearch<variant>::Search(Tree& tree, const PNSParams& pns_params) {
+  PNSResult pns_result;
+  const typename Tree::Node root = tree.Reset();
+
+  Pns(tree, pns_params, root);
+  pns_result.tree_size = tree.TreeSize(root);
+  pns_result.proof = tree.Proof(root);
+  pns_result.disproof = tree.Disproof(root);
+
+  for (int i = 0; i < tree.NumChildren(root); ++i) {
+    const typename Tree::Node pns_node = tree.Child(root, i);
+    pns_result.ordered_moves.push_back(
+        MakeMoveStat(tree.GetMove(pns_node), tree.Proof(pns_node),
+                     tree.Disproof(pns_node), tree.TreeSize(pns_node)));
+  }
+  OrderMoveStats(pns_params, &pns_result);
   return pns_result;
 }
 
 template <Variant variant>
   requires(IsAntichessLike(variant))
-void PNSearch<variant>::Pns(const PNSParams& pns_params, PNSNode* pns_root) {
-  PNSNode* cur_node = pns_root;
+template <typename Tree>
+void PNSearch<variant>::Pns(Tree& tree, const PNSParams& pns_params,
+                            typename Tree::Node pns_root) {
+  typename Tree::Node cur_node = pns_root;
 
   StopWatch stop_watch;
   stop_watch.Start();
@@ -86,8 +151,8 @@ void PNSearch<variant>::Pns(const PNSParams& pns_params, PNSNode* pns_root) {
   int depth = 0, num_nodes = 0;
   int log_progress_secs = pns_params.log_progress;
   while (num_nodes < pns_params.max_nodes &&
-         (pns_root->proof != 0 && pns_root->disproof != 0) &&
-         (!timer_ || !timer_->Lapsed())) {
+         (tree.Proof(pns_root) != 0 && tree.Disproof(pns_root) != 0) &&
+         !Stopped()) {
     if (pns_params.log_progress > 0 &&
         stop_watch.ElapsedTime() / 100 > log_progress_secs) {
       std::cout << "# Progress: " << (100.0 * num_nodes) / pns_params.max_nodes
@@ -95,29 +160,37 @@ void PNSearch<variant>::Pns(const PNSParams& pns_params, PNSNode* pns_root) {
                 << std::endl;
       log_progress_secs += pns_params.log_progress;
     }
-    PNSNode* mpn = FindMpn(cur_node, &depth);
-    Expand(pns_params, num_nodes, depth, mpn);
-    num_nodes += mpn->children.size();
-    cur_node = UpdateAncestors(pns_params, mpn, pns_root, &depth);
+    const typename Tree::Node mpn = FindMpn(tree, cur_node, &depth);
+    Expand(tree, pns_params, num_nodes, depth, mpn);
+    num_nodes += tree.NumChildren(mpn);
+    cur_node = UpdateAncestors(tree, pns_params, mpn, pns_root, &depth);
   }
   while (cur_node != pns_root) {
-    cur_node = cur_node->parent;
+    cur_node = tree.Parent(cur_node);
     --depth;
     assert(board_.UnmakeLastMove());
-    UpdateTreeSize(cur_node);
+    tree.UpdateTreeSize(cur_node);
   }
   assert(depth == 0);
 }
 
 template <Variant variant>
   requires(IsAntichessLike(variant))
-bool PNSearch<variant>::RedundantMoves(PNSNode* pns_node) {
-  if (pns_node && pns_node->parent && pns_node->parent->parent &&
-      pns_node->parent->parent->parent) {
-    const Move& m1 = pns_node->move;
-    const Move& m2 = pns_node->parent->move;
-    const Move& m3 = pns_node->parent->parent->move;
-    const Move& m4 = pns_node->parent->parent->parent->move;
+template <typename Tree>
+bool PNSearch<variant>::RedundantMoves(const Tree& tree,
+                                       typename Tree::Node pns_node) {
+  constexpr typename Tree::Node kNullNode = Tree::kNullNode;
+  if (pns_node == kNullNode) {
+    return false;
+  }
+  const typename Tree::Node n2 = tree.Parent(pns_node);
+  const typename Tree::Node n3 = n2 == kNullNode ? kNullNode : tree.Parent(n2);
+  const typename Tree::Node n4 = n3 == kNullNode ? kNullNode : tree.Parent(n3);
+  if (n4 != kNullNode) {
+    const Move m1 = tree.GetMove(pns_node);
+    const Move m2 = tree.GetMove(n2);
+    const Move m3 = tree.GetMove(n3);
+    const Move m4 = tree.GetMove(n4);
     if (m1.from_index() == m3.to_index() && m1.to_index() == m3.from_index() &&
         m2.from_index() == m4.to_index() && m2.to_index() == m4.from_index()) {
       return true;
@@ -128,81 +201,88 @@ bool PNSearch<variant>::RedundantMoves(PNSNode* pns_node) {
 
 template <Variant variant>
   requires(IsAntichessLike(variant))
-PNSNode* PNSearch<variant>::FindMpn(PNSNode* root, int* depth) {
-  PNSNode* mpn = root;
-  while (!mpn->children.empty()) {
+template <typename Tree>
+typename Tree::Node PNSearch<variant>::FindMpn(Tree& tree,
+                                               typename Tree::Node root,
+                                               int* depth) {
+  typename Tree::Node mpn = root;
+  while (const int num_children = tree.NumChildren(mpn)) {
     // If proof number of parent node is INF_NODES, all it's children will have
     // disproof number of INF_NODES. So, select the child node that has a proof
     // number that is not 0 (i.e, not yet proved). Otherwise, we may end up
     // reaching a leaf node that is proved/disproved/drawn with no scope for
     // expansion.
-    if (mpn->proof == INF_NODES) {
-      for (PNSNode* pns_node : mpn->children) {
-        if (pns_node->proof) {
+    const int proof = tree.Proof(mpn);
+    if (proof == INF_NODES) {
+      for (int i = 0; i < num_children; ++i) {
+        const typename Tree::Node pns_node = tree.Child(mpn, i);
+        if (tree.Proof(pns_node)) {
           mpn = pns_node;
           break;
         }
       }
     } else {
-      for (PNSNode* pns_node : mpn->children) {
-        if (mpn->proof == pns_node->disproof) {
+      for (int i = 0; i < num_children; ++i) {
+        const typename Tree::Node pns_node = tree.Child(mpn, i);
+        if (proof == tree.Disproof(pns_node)) {
           mpn = pns_node;
           break;
         }
       }
     }
     ++*depth;
-    board_.MakeMove(mpn->move);
+    board_.MakeMove(tree.GetMove(mpn));
   }
-  assert(mpn->children.empty());
   return mpn;
 }
 
 template <Variant variant>
   requires(IsAntichessLike(variant))
-PNSNode* PNSearch<variant>::UpdateAncestors(const PNSParams& pns_params,
-                                            PNSNode* mpn, PNSNode* pns_root,
-                                            int* depth) {
-  PNSNode* pns_node = mpn;
+template <typename Tree>
+typename Tree::Node PNSearch<variant>::UpdateAncestors(
+    Tree& tree, const PNSParams& pns_params, typename Tree::Node mpn,
+    typename Tree::Node pns_root, int* depth) {
+  typename Tree::Node pns_node = mpn;
   while (true) {
-    if (!pns_node->children.empty()) {
+    if (const int num_children = tree.NumChildren(pns_node)) {
       int proof = INF_NODES;
       int disproof = 0;
-      pns_node->tree_size = 1;
-      for (PNSNode* child : pns_node->children) {
-        if (child->disproof < proof) {
-          proof = child->disproof;
+      for (int i = 0; i < num_children; ++i) {
+        const typename Tree::Node child = tree.Child(pns_node, i);
+        const int child_proof = tree.Proof(child);
+        const int child_disproof = tree.Disproof(child);
+        if (child_disproof < proof) {
+          proof = child_disproof;
         }
-        if (child->proof == INF_NODES) {
+        if (child_proof == INF_NODES) {
           disproof = INF_NODES;
         } else if (disproof != INF_NODES) {
-          disproof += child->proof;
+          disproof += child_proof;
         }
-        pns_node->tree_size += child->tree_size;
       }
+      tree.UpdateTreeSize(pns_node);
       // Terminate updating ancestors if proof/disproof numbers
       // don't change and it is not MPN in a PN^2 higher level
       // tree. In PN^2, MPN will have unevaluated children due to
       // use of delayed evaluation so we must continue even if
       // proof/disproof don't change.
-      if (pns_node->proof == proof && pns_node->disproof == disproof &&
+      if (tree.Proof(pns_node) == proof &&
+          tree.Disproof(pns_node) == disproof &&
           (pns_params.pns_type != PNSParams::PN2 || pns_node != mpn)) {
         return pns_node;
       }
-      if (proof == 0 && transpos_) {
-        transpos_->Put(WIN, NodeType::EXACT_NODE, 0, board_.ZobristKey(),
-                       Move());
-      } else if (proof == INF_NODES && disproof == 0 && transpos_) {
-        transpos_->Put(-WIN, NodeType::EXACT_NODE, 0, board_.ZobristKey(),
-                       Move());
+      if (proof == 0) {
+        SaveProof(WIN);
+      } else if (proof == INF_NODES && disproof == 0) {
+        SaveProof(-WIN);
       }
-      pns_node->proof = proof;
-      pns_node->disproof = disproof;
+      tree.Proof(pns_node) = proof;
+      tree.Disproof(pns_node) = disproof;
     }
     if (pns_node == pns_root) {
       return pns_node;
     }
-    pns_node = pns_node->parent;
+    pns_node = tree.Parent(pns_node);
     --*depth;
     assert(board_.UnmakeLastMove());
   }
@@ -211,81 +291,115 @@ PNSNode* PNSearch<variant>::UpdateAncestors(const PNSParams& pns_params,
 
 template <Variant variant>
   requires(IsAntichessLike(variant))
-void PNSearch<variant>::UpdateTreeSize(PNSNode* pns_node) {
-  if (!pns_node->children.empty()) {
-    pns_node->tree_size = 1;
-    for (PNSNode* child : pns_node->children) {
-      pns_node->tree_size += child->tree_size;
-    }
-  }
-}
-
-template <Variant variant>
-  requires(IsAntichessLike(variant))
-void PNSearch<variant>::Expand(const PNSParams& pns_params, const int num_nodes,
-                               const int pns_node_depth, PNSNode* pns_node) {
-  if (RedundantMoves(pns_node) || pns_node_depth >= PNS_MAX_DEPTH) {
-    pns_node->proof = INF_NODES;
-    pns_node->disproof = INF_NODES;
-    assert(pns_node->children.empty());
+template <typename Tree>
+void PNSearch<variant>::Expand(Tree& tree, const PNSParams& pns_params,
+                               const int num_nodes, const int pns_node_depth,
+                               typename Tree::Node pns_node) {
+  if (RedundantMoves(tree, pns_node) || pns_node_depth >= PNS_MAX_DEPTH) {
+    tree.Proof(pns_node) = INF_NODES;
+    tree.Disproof(pns_node) = INF_NODES;
+    assert(!tree.NumChildren(pns_node));
   } else if (pns_params.pns_type == PNSParams::PN2) {
     PNSParams pns_params2;
     pns_params2.pns_type = PNSParams::PN1;
+    pns_params2.node_store = pns_params.node_store;
     pns_params2.max_nodes = PnNodes(pns_params, num_nodes);
-    Pns(pns_params2, pns_node);
+    // The first expansion of the PN1 search adds the immediate children of
+    // pns_node to the tree, and everything below them is added after. So the
+    // subtree is discarded by rolling the tree back.
+    const size_t tree_store_size = tree.Size();
+    Pns(tree, pns_params2, pns_node);
 
     // If the tree is solved, delete the entire Pn subtree under
     // the pns_node. Else, retain MPN's immediate children only.
-    if (pns_node->proof == 0 || pns_node->disproof == 0) {
-      Delete(pns_node->children);
-      pns_node->tree_size = 1;
+    if (tree.Proof(pns_node) == 0 || tree.Disproof(pns_node) == 0) {
+      tree.RemoveChildren(pns_node);
     } else {
-      for (PNSNode* child : pns_node->children) {
-        Delete(child->children);
-        child->tree_size = 1;
+      for (int i = 0; i < tree.NumChildren(pns_node); ++i) {
+        tree.RemoveChildren(tree.Child(pns_node, i));
       }
-      pns_node->tree_size = 1 + pns_node->children.size();
     }
+    tree.UpdateTreeSize(pns_node);
+    tree.Rollback(tree_store_size, pns_node);
   } else {
     MoveArray move_array = GenerateMoves<variant>(board_);
+    tree.AddChildren(pns_node, move_array);
     for (size_t i = 0; i < move_array.size(); ++i) {
-      PNSNode* child = new PNSNode;
-      pns_node->children.push_back(child);
-      child->move = move_array.get(i);
-      child->parent = pns_node;
-      board_.MakeMove(child->move);
-      int result = EvalResult<variant>(board_);
-      if (result == UNKNOWN && egtb_ &&
-          OnlyOneBitSet(board_.BitBoard(Side::WHITE)) &&
-          OnlyOneBitSet(board_.BitBoard(Side::BLACK))) {
-        const EGTBIndexEntry* egtb_entry = egtb_->Lookup(board_);
-        if (egtb_entry) {
-          result = EGTBResult(*egtb_entry);
-        }
-      }
-      if (result == DRAW) {
-        child->proof = INF_NODES;
-        child->disproof = INF_NODES;
-      } else if (result == -WIN) {
-        child->proof = INF_NODES;
-        child->disproof = 0;
-      } else if (result == WIN) {
-        child->proof = 0;
-        child->disproof = INF_NODES;
-      } else {
-        child->proof = 1;
-        child->disproof = CountMoves<variant>(board_);
-      }
-      if ((result == WIN || result == -WIN) && transpos_) {
-        transpos_->Put(result, NodeType::EXACT_NODE, 0, board_.ZobristKey(),
-                       Move());
-      }
+      const typename Tree::Node child = tree.Child(pns_node, i);
+      board_.MakeMove(move_array.get(i));
+      EvaluateLeaf(&tree.Proof(child), &tree.Disproof(child));
       board_.UnmakeLastMove();
     }
-    pns_node->tree_size = 1 + pns_node->children.size();
   }
 }
 
+template <Variant variant>
+  requires(IsAntichessLike(variant))
+bool PNSearch<variant>::EvaluateLeaf(int* proof, int* disproof) {
+  int result = EvalResult<variant>(board_);
+  if (result == UNKNOWN && egtb_ &&
+      PopCount(board_.BitBoard()) <= egtb_->MaxPieces()) {
+    result = egtb_->ProbeWDL(board_);
+  }
+  // Positions solved by an earlier search, or by another thread of a parallel
+  // search, are in the transposition table, and positions solved in earlier
+  // runs are in the proof cache.
+  bool solved_in_transpos = false;
+  if (result == UNKNOWN && transpos_) {
+    const std::optional<TTData> tdata = transpos_->Get(board_.ZobristKey());
+    if (tdata && tdata->node_type() == NodeType::EXACT_NODE &&
+        (tdata->score == WIN || tdata->score == -WIN)) {
+      result = tdata->score;
+      solved_in_transpos = true;
+    }
+  }
+  if (result == UNKNOWN && proof_cache_) {
+    result = proof_cache_->Get(board_.ZobristKey());
+  }
+  if (result == DRAW) {
+    *proof = INF_NODES;
+    *disproof = INF_NODES;
+  } else if (result == -WIN) {
+    *proof = INF_NODES;
+    *disproof = 0;
+  } else if (result == WIN) {
+    *proof = 0;
+    *disproof = INF_NODES;
+  } else {
+    *proof = 1;
+    *disproof = CountMoves<variant>(board_);
+  }
+  if ((result == WIN || result == -WIN) && transpos_ && !solved_in_transpos) {
+    transpos_->Put(result, NodeType::EXACT_NODE, 0, board_.ZobristKey(),
+                   Move());
+  }
+  return result != UNKNOWN;
+}
+
+template <Variant variant>
+  requires(IsAntichessLike(variant))
+void PNSearch<variant>::SaveProof(const int result) {
+  if (transpos_) {
+    transpos_->Put(result, NodeType::EXACT_NODE, 0, board_.ZobristKey(),
+                   Move());
+  }
+  if (proof_cache_) {
+    new_proofs_.push_back({board_.ZobristKey(), result});
+    if (new_proofs_.size() >= kMaxNewProofs) {
+      FlushProofs();
+    }
+  }
+}
+
+template <Variant variant>
+  requires(IsAntichessLike(variant))
+void PNSearch<variant>::FlushProofs() {
+  if (proof_cache_ && !new_proofs_.empty()) {
+    proof_cache_->Put(new_proofs_);
+  }
+  new_proofs_.clear();
+}
+
 template <Variant variant>
   requires(IsAntichessLike(variant))
 int PNSearch<variant>::PnNodes(const PNSParams& pns_params,
@@ -300,18 +414,464 @@ int PNSearch<variant>::PnNodes(const PNSParams& pns_params,
 
 template <Variant variant>
   requires(IsAntichessLike(variant))
-void PNSearch<variant>::Delete(PNSNode* pns_node) {
-  Delete(pns_node->children);
-  delete pns_node;
+PNSResult PNSearch<variant>::DfpnSearch(const PNSParams& pns_params) {
+  // The table is kept across searches, so that a PNSearch searching the same
+  // positions again (as ParallelSearch does) starts from what it learnt.
+  const uint64_t table_size =
+      ProofTable::SizeForMemory(pns_params.dfpn_table_mb);
+  if (!proof_table_ || proof_table_->Size() != table_size) {
+    proof_table_ = std::make_unique<ProofTable>(table_size);
+  }
+  dfpn_nodes_ = 0;
+  dfpn_path_.clear();
+  // Sized up front so that references to the children of a position stay
+  // valid while deeper positions are searched.
+  dfpn_children_.resize(PNS_MAX_DEPTH + 1);
+
+  PNSResult pns_result;
+  // A root solved by an earlier search is searched all the same, for the move.
+  if (EvalResult<variant>(board_) != UNKNOWN) {
+    EvaluateLeaf(&pns_result.proof, &pns_result.disproof);
+    pns_result.tree_size = 1;
+    return pns_result;
+  }
+  Mid(pns_params, 0, kUnboundedNodes, kUnboundedNodes, &pns_result.proof,
+      &pns_result.disproof);
+  pns_result.tree_size = dfpn_nodes_;
+  for (const DfpnChild& child : dfpn_children_[0]) {
+    pns_result.ordered_moves.push_back(
+        MakeMoveStat(child.move, child.proof, child.disproof, child.work));
+  }
+  OrderMoveStats(pns_params, &pns_result);
+  return pns_result;
+}
+
+// The positions after the root moves are searched with df-pn in rounds. In
+// every round, the threads take the unsolved root moves, most promising first,
+// and search each with a node budget that doubles from one round to the next,
+// so that all root moves get searched however long the search runs. Every
+// thread keeps its own PNSearch, and with it its ProofTable, across rounds, and
+// first takes the root moves it searched in earlier rounds, so that a root
+// move searched again resumes from the numbers of its earlier searches. Solved
+// positions reach the other threads through the transposition table. Once a
+// root move is found to win, the searches on other threads are stopped.
+template <Variant variant>
+  requires(IsAntichessLike(variant))
+PNSResult PNSearch<variant>::ParallelSearch(const PNSParams& pns_params) {
+  SearchThreads& search_threads = *pns_params.search_threads;
+  const int num_threads = search_threads.NumThreads();
+
+  PNSResult pns_result;
+  // A root solved by an earlier search is searched all the same, for the move.
+  if (EvalResult<variant>(board_) != UNKNOWN) {
+    EvaluateLeaf(&pns_result.proof, &pns_result.disproof);
+    pns_result.tree_size = 1;
+    return pns_result;
+  }
+
+  struct RootChild {
+    Move move;
+    int proof;
+    int disproof;
+    uint64_t tree_size;
+    // Thread that last searched the move, or -1.
+    int thread_num;
+  };
+  std::vector<RootChild> children;
+  {
+    const MoveArray move_array = GenerateMoves<variant>(board_);
+    for (size_t i = 0; i < move_array.size(); ++i) {
+      RootChild child{
+          .move = move_array.get(i), .tree_size = 1, .thread_num = -1};
+      board_.MakeMove(child.move);
+      EvaluateLeaf(&child.proof, &child.disproof);
+      board_.UnmakeLastMove();
+      children.push_back(child);
+    }
+  }
+  const auto solved = [](const RootChild& child) {
+    return DfpnSolved(child.proof, child.disproof);
+  };
+
+  PNSParams child_params = pns_params;
+  child_params.quiet = true;
+  child_params.log_progress = -1;
+  child_params.search_threads = nullptr;
+
+  std::vector<std::unique_ptr<PNSearch<variant>>> searches;
+  for (int i = 0; i < num_threads; ++i) {
+    SearchThread& thread = *search_threads.threads[i];
+    thread.board = board_;
+    searches.push_back(std::make_unique<PNSearch<variant>>(
+        thread.board, transpos_, egtb_, timer_, proof_cache_));
+    searches.back()->stop_timer_ = &thread.timer;
+  }
+
+  std::atomic<int64_t> nodes_searched = children.size();
+  std::atomic<bool> root_won = false;
+  for (int round_nodes = kParallelRoundNodes;;
+       round_nodes = std::min<int64_t>(2 * int64_t(round_nodes), INT_MAX)) {
+    std::vector<size_t> unsolved;
+    for (size_t i = 0; i < children.size(); ++i) {
+      if (children[i].disproof == 0) {
+        root_won = true;
+      } else if (!solved(children[i])) {
+        unsolved.push_back(i);
+      }
+    }
+    if (root_won || unsolved.empty() ||
+        nodes_searched >= pns_params.max_nodes || Stopped()) {
+      break;
+    }
+    std::stable_sort(unsolved.begin(), unsolved.end(),
+                     [&children](const size_t a, const size_t b) {
+                       return children[a].disproof < children[b].disproof;
+                     });
+
+    const std::unique_ptr<std::atomic<bool>[]> taken =
+        std::make_unique<std::atomic<bool>[]>(unsolved.size());
+    // Read while the threads of this round update RootChild::thread_num.
+    std::vector<int> last_thread_nums;
+    for (const size_t index : unsolved) {
+      last_thread_nums.push_back(children[index].thread_num);
+    }
+    // Takes the most promising root move left that the thread searched
+    // before, or else the most promising root move left. Returns false if
+    // none is left.
+    const auto take_child = [&](const int thread_num, size_t* index) {
+      for (const bool own : {true, false}) {
+        for (size_t i = 0; i < unsolved.size(); ++i) {
+          if ((!own || last_thread_nums[i] == thread_num) &&
+              !taken[i].exchange(true)) {
+            *index = unsolved[i];
+            return true;
+          }
+        }
+      }
+      return false;
+    };
+    const auto search_children = [&](const int thread_num) {
+      SearchThread& thread = *search_threads.threads[thread_num];
+      PNSearch<variant>& search = *searches[thread_num];
+      thread.timer.Run();
+      size_t index;
+      while (take_child(thread_num, &index)) {
+        const int64_t nodes_left = pns_params.max_nodes - nodes_searched;
+        if (root_won || nodes_left <= 0 || Stopped()) {
+          break;
+        }
+        RootChild& child = children[index];
+        child.thread_num = thread_num;
+        // Leaves every thread a share of the nodes left.
+        PNSParams params = child_params;
+        params.max_nodes = static_cast<int>(std::min<int64_t>(
+            round_nodes, std::max<int64_t>(1, nodes_left / num_threads)));
+        thread.board.MakeMove(child.move);
+        const PNSResult result = search.Search(params);
+        thread.board.UnmakeLastMove();
+        child.proof = result.proof;
+        child.disproof = result.disproof;
+        child.tree_size = result.tree_size;
+        nodes_searched += result.tree_size;
+        if (child.disproof == 0) {
+          root_won = true;
+          for (const auto& other_thread : search_threads.threads) {
+            other_thread->timer.Invalidate();
+          }
+        }
+      }
+    };
+    search_threads.pool.Run(
+        [&](const int worker_num) { search_children(worker_num + 1); });
+    search_children(0);
+    search_threads.pool.Wait();
+  }
+
+  pns_result.tree_size = nodes_searched;
+  pns_result.proof = INF_NODES;
+  pns_result.disproof = 0;
+  for (const RootChild& child : children) {
+    pns_result.proof = std::min(pns_result.proof, child.disproof);
+    pns_result.disproof = SumNodes(pns_result.disproof, child.proof);
+    pns_result.ordered_moves.push_back(MakeMoveStat(
+        child.move, child.proof, child.disproof, child.tree_size));
+  }
+  OrderMoveStats(pns_params, &pns_result);
+  return pns_result;
 }
 
+// With proof and disproof numbers from the point of view of the side to move,
+// the proof number of a position is the least disproof number of its children
+// and its disproof number the sum of their proof numbers. Mid repeatedly
+// searches the child with the least disproof number, with thresholds such that
+// it returns as soon as another child becomes more promising or the numbers of
+// this position cross its own thresholds. As in PN1/PN2, draws have infinite
+// proof and disproof numbers, so a position is only solved once it is won,
+// lost or drawn, and a position that cannot be won is searched further to
+// tell a loss from a draw.
+//
+// Positions repeated on the search path and positions beyond PNS_MAX_DEPTH are
+// taken to be draws, as PN1/PN2 do. Numbers derived from such path dependent
+// draws are stored in the ProofTable all the same.
 template <Variant variant>
   requires(IsAntichessLike(variant))
-void PNSearch<variant>::Delete(std::vector<PNSNode*>& pns_nodes) {
-  for (PNSNode* pns_node : pns_nodes) {
-    Delete(pns_node);
+void PNSearch<variant>::Mid(const PNSParams& pns_params, const int depth,
+                            const int64_t th_proof, const int64_t th_disproof,
+                            int* proof, int* disproof) {
+  const uint64_t start_nodes = dfpn_nodes_;
+  const U64 zkey = board_.ZobristKey();
+  dfpn_path_.push_back(zkey);
+
+  std::vector<DfpnChild>& children = dfpn_children_[depth];
+  children.clear();
+  {
+    const MoveArray move_array = GenerateMoves<variant>(board_);
+    for (size_t i = 0; i < move_array.size(); ++i) {
+      DfpnChild child{.move = move_array.get(i), .work = 0};
+      board_.MakeMove(child.move);
+      const U64 child_zkey = board_.ZobristKey();
+      // Only positions since the last capture or pawn move can repeat.
+      const auto path_begin =
+          dfpn_path_.end() -
+          std::min<size_t>(dfpn_path_.size(), board_.HalfMoveClock());
+      if (depth + 1 >= PNS_MAX_DEPTH ||
+          std::find(path_begin, dfpn_path_.end(), child_zkey) !=
+              dfpn_path_.end()) {
+        child.proof = INF_NODES;
+        child.disproof = INF_NODES;
+      } else if (!EvaluateLeaf(&child.proof, &child.disproof)) {
+        proof_table_->Get(child_zkey, &child.proof, &child.disproof);
+      }
+      board_.UnmakeLastMove();
+      children.push_back(child);
+    }
+  }
+  // Like PN1/PN2, counts the positions evaluated.
+  dfpn_nodes_ += children.size();
+
+  while (true) {
+    int best_index = -1;
+    int second_disproof = INF_NODES;
+    *proof = INF_NODES;
+    *disproof = 0;
+    for (size_t i = 0; i < children.size(); ++i) {
+      const DfpnChild& child = children[i];
+      if (child.disproof < *proof) {
+        second_disproof = *proof;
+        *proof = child.disproof;
+        best_index = i;
+      } else if (child.disproof < second_disproof) {
+        second_disproof = child.disproof;
+      }
+      *disproof = SumNodes(*disproof, child.proof);
+    }
+    if (DfpnSolved(*proof, *disproof) || *proof >= th_proof ||
+        *disproof >= th_disproof ||
+        dfpn_nodes_ >= uint64_t(pns_params.max_nodes) ||
+        Stopped()) {
+      break;
+    }
+    int64_t child_th_disproof =
+        std::min(th_proof, int64_t(second_disproof) + 1);
+    if (*proof == INF_NODES) {
+      // No child can be disproved, so this position is not won, but it may
+      // still be lost or drawn: tries to prove the unsolved child easiest to
+      // prove.
+      best_index = -1;
+      for (size_t i = 0; i < children.size(); ++i) {
+        const int child_proof = children[i].proof;
+        if (child_proof > 0 && child_proof < INF_NODES &&
+            (best_index < 0 || child_proof < children[best_index].proof)) {
+          best_index = i;
+        }
+      }
+      child_th_disproof = kUnboundedNodes;
+    }
+    DfpnChild& best = children[best_index];
+    const int64_t child_th_proof = th_disproof == kUnboundedNodes
+                                       ? kUnboundedNodes
+                                       : th_disproof - *disproof + best.proof;
+    const uint64_t child_start_nodes = dfpn_nodes_;
+    board_.MakeMove(best.move);
+    Mid(pns_params, depth + 1, child_th_proof, child_th_disproof, &best.proof,
+        &best.disproof);
+    board_.UnmakeLastMove();
+    best.work += dfpn_nodes_ - child_start_nodes;
+  }
+
+  if (*proof == 0) {
+    SaveProof(WIN);
+  } else if (*disproof == 0) {
+    SaveProof(-WIN);
+  }
+  // Draws may only be due to repetitions along the current path or the depth
+  // limit, so they are not stored for other paths to the position.
+  if (*proof != INF_NODES || *disproof != INF_NODES) {
+    proof_table_->Put(zkey, *proof, *disproof,
+                      std::max<uint64_t>(1, dfpn_nodes_ - start_nodes));
   }
-  pns_nodes.clear();
+  dfpn_path_.pop_back();
+}
+
+ProofTable::ProofTable(const uint64_t size) : buckets_(size) {}
+
+uint64_t ProofTable::SizeForMemory(const int memory_mb) {
+  const uint64_t bytes = uint64_t(std::max(0, memory_mb)) << 20;
+  return std::max<uint64_t>(1, bytes / sizeof(Bucket));
+}
+
+bool ProofTable::Get(const U64 zkey, int* proof, int* disproof) const {
+  const Bucket& bucket = buckets_[hash(zkey)];
+  for (const Entry& entry : bucket.entries) {
+    if (entry.work && entry.zkey == zkey) {
+      *proof = entry.proof;
+      *disproof = entry.disproof;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ProofTable::Put(const U64 zkey, const int proof, const int disproof,
+                     const uint64_t work) {
+  Bucket& bucket = buckets_[hash(zkey)];
+  Entry* replace = &bucket.entries[0];
+  for (Entry& entry : bucket.entries) {
+    if (!entry.work || entry.zkey == zkey) {
+      replace = &entry;
+      break;
+    }
+    if (entry.work < replace->work) {
+      replace = &entry;
+    }
+  }
+  *replace = Entry{
+      .zkey = zkey, .proof = proof, .disproof = disproof, .work = work};
+}
+
+PNSNode* PNSNodeArena::Allocate(const size_t num_nodes) {
+  assert(num_nodes <= kChunkSize);
+  // Skips the rest of the current chunk if the nodes do not fit in it.
+  if (size_ % kChunkSize + num_nodes > kChunkSize) {
+    size_ += kChunkSize - size_ % kChunkSize;
+  }
+  const size_t chunk = size_ / kChunkSize;
+  if (chunk == chunks_.size()) {
+    chunks_.push_back(std::make_unique_for_overwrite<PNSNode[]>(kChunkSize));
+  }
+  PNSNode* pns_nodes = chunks_[chunk].get() + size_ % kChunkSize;
+  size_ += num_nodes;
+  return pns_nodes;
+}
+
+PNSTree::Node PNSTree::Reset() {
+  arena_.Clear();
+  root_ = arena_.Allocate(1);
+  *root_ = PNSNode();
+  return root_;
+}
+
+void PNSTree::UpdateTreeSize(Node node) {
+  if (node->num_children) {
+    node->tree_size = 1;
+    for (const PNSNode& child : node->Children()) {
+      node->tree_size += child.tree_size;
+    }
+  }
+}
+
+void PNSTree::AddChildren(Node node, const MoveArray& move_array) {
+  node->children = arena_.Allocate(move_array.size());
+  node->num_children = move_array.size();
+  for (size_t i = 0; i < move_array.size(); ++i) {
+    PNSNode& child = node->children[i];
+    child = PNSNode();
+    child.move = move_array.get(i);
+    child.parent = node;
+  }
+  node->tree_size = 1 + node->num_children;
+}
+
+void PNSTree::RemoveChildren(Node node) {
+  node->children = nullptr;
+  node->num_children = 0;
+  node->tree_size = 1;
+}
+
+void PNSTree::Rollback(const size_t size, Node node) {
+  arena_.Rollback(size);
+  // Reallocating the children hands out the very same nodes, with their
+  // contents intact.
+  if (node->num_children) {
+    [[maybe_unused]] const PNSNode* children =
+        arena_.Allocate(node->num_children);
+    assert(children == node->children);
+  }
+}
+
+CompactPNSTree::Node CompactPNSTree::Allocate(const size_t num_nodes) {
+  assert(num_nodes <= kChunkSize);
+  // Skips the rest of the current chunk if the nodes do not fit in it.
+  if (size_ % kChunkSize + num_nodes > kChunkSize) {
+    size_ += kChunkSize - size_ % kChunkSize;
+  }
+  if (size_ + num_nodes >= kNullNode) {
+    throw std::length_error("PNS tree too large for 32-bit node offsets");
+  }
+  if (size_ / kChunkSize == chunks_.size()) {
+    chunks_.push_back(std::make_unique_for_overwrite<Chunk>());
+  }
+  const Node first = size_;
+  size_ += num_nodes;
+  return first;
+}
+
+CompactPNSTree::Node CompactPNSTree::Reset() {
+  size_ = 0;
+  const Node root = Allocate(1);
+  Chunk& chunk = GetChunk(root);
+  chunk.proof[Index(root)] = 1;
+  chunk.disproof[Index(root)] = 1;
+  chunk.move[Index(root)] = Move();
+  chunk.num_children[Index(root)] = 0;
+  chunk.parent[Index(root)] = kNullNode;
+  return root;
+}
+
+uint64_t CompactPNSTree::TreeSize(Node node) const {
+  uint64_t tree_size = 0;
+  std::vector<Node> stack = {node};
+  while (!stack.empty()) {
+    const Node top = stack.back();
+    stack.pop_back();
+    ++tree_size;
+    for (int i = 0; i < NumChildren(top); ++i) {
+      stack.push_back(Child(top, i));
+    }
+  }
+  return tree_size;
+}
+
+void CompactPNSTree::AddChildren(Node node, const MoveArray& move_array) {
+  const Node children = Allocate(move_array.size());
+  Chunk& chunk = GetChunk(node);
+  chunk.children[Index(node)] = children;
+  chunk.num_children[Index(node)] = move_array.size();
+  // Children are allocated within a single chunk.
+  Chunk& children_chunk = GetChunk(children);
+  for (size_t i = 0; i < move_array.size(); ++i) {
+    const size_t index = Index(children + i);
+    children_chunk.proof[index] = 1;
+    children_chunk.disproof[index] = 1;
+    children_chunk.move[index] = move_array.get(i);
+    children_chunk.num_children[index] = 0;
+    children_chunk.parent[index] = node;
+  }
+}
+
+void CompactPNSTree::Rollback(const size_t size, Node node) {
+  // The children of node, if any, are the first allocated after size.
+  size_ = NumChildren(node) ? Child(node, NumChildren(node)) : size;
 }
 
 template class PNSearch<Variant::ANTICHESS>;
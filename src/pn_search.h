@@ -5,15 +5,23 @@
 #include "common.h"
 #include "egtb.h"
 #include "move.h"
+#include "move_array.h"
+#include "proof_cache.h"
+#include "search_threads.h"
 #include "timer.h"
 #include "transpos.h"
 
+#include <array>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <span>
 #include <vector>
 
 #define INF_NODES INT_MAX
 
-typedef int PNSNodeOffset;
+typedef uint32_t PNSNodeOffset;
 
 struct PNSNode {
   int proof = 1;
@@ -21,11 +29,194 @@ struct PNSNode {
   // Move made by the parent leading to this node, valid for all nodes except
   // root node.
   Move move;
-  PNSNode* parent = nullptr;
-  std::vector<PNSNode*> children;
+  uint16_t num_children = 0;
 
   // Number of nodes in the subtree rooted at this node.
   uint32_t tree_size = 1;
+
+  PNSNode* parent = nullptr;
+  // First of the num_children children, which are contiguous in memory.
+  PNSNode* children = nullptr;
+
+  std::span<PNSNode> Children() const { return {children, num_children}; }
+};
+
+// Bump allocator for PNS tree nodes. Nodes are allocated from fixed size chunks
+// that are kept around for reuse across searches, so that a node never moves
+// once allocated and the children of a node can be allocated contiguously.
+// Nodes cannot be freed individually: instead, the arena can be rolled back to
+// an earlier Size(), freeing all nodes allocated after that point at once.
+class PNSNodeArena {
+public:
+  // Allocates num_nodes contiguous nodes. num_nodes must not exceed
+  // kChunkSize. Nodes freed by a rollback are handed out again as they were
+  // left, so callers must initialize the nodes they allocate.
+  PNSNode* Allocate(size_t num_nodes);
+
+  // Number of node slots handed out so far, including the few skipped at the
+  // end of chunks to keep allocations contiguous.
+  size_t Size() const { return size_; }
+
+  // Frees all nodes allocated after the arena had given size.
+  void Rollback(size_t size) { size_ = size; }
+
+  void Clear() { size_ = 0; }
+
+private:
+  static constexpr size_t kChunkSize = 1 << 16;
+
+  std::vector<std::unique_ptr<PNSNode[]>> chunks_;
+  size_t size_ = 0;
+};
+
+// PNSearch works on either of two PNS tree stores with the same interface,
+// where nodes are referred to by a Node handle:
+//
+// PNSTree: PNSNode structs allocated from a PNSNodeArena and linked by
+// pointers, 32 bytes per node.
+//
+// CompactPNSTree: a structure-of-arrays store with nodes referred to by 32-bit
+// offsets, 20 bytes per node, for very large trees such as offline proofs with
+// pns_analyze. Subtree sizes are not stored but counted when asked for.
+//
+// In both stores, the children of a node are added together, and the nodes
+// added after some point can be freed all at once by rolling the store back.
+class PNSTree {
+public:
+  using Node = PNSNode*;
+  static constexpr Node kNullNode = nullptr;
+
+  // Discards all nodes and returns a new root node.
+  Node Reset();
+
+  Node Root() const { return root_; }
+
+  int& Proof(Node node) { return node->proof; }
+  int& Disproof(Node node) { return node->disproof; }
+  Move GetMove(Node node) const { return node->move; }
+  Node Parent(Node node) const { return node->parent; }
+  int NumChildren(Node node) const { return node->num_children; }
+  Node Child(Node node, int i) const { return node->children + i; }
+
+  uint64_t TreeSize(Node node) const { return node->tree_size; }
+
+  // Recomputes the tree size of node from those of its children.
+  void UpdateTreeSize(Node node);
+
+  // Adds children to a leaf node for given moves, with unit proof and disproof
+  // numbers.
+  void AddChildren(Node node, const MoveArray& move_array);
+
+  // Detaches all children of node from the tree. Their nodes are freed only by
+  // a subsequent rollback.
+  void RemoveChildren(Node node);
+
+  size_t Size() const { return arena_.Size(); }
+
+  // Frees all nodes added after the tree had given size except for the
+  // children of node, which must have been the first added after that point.
+  void Rollback(size_t size, Node node);
+
+private:
+  PNSNodeArena arena_;
+  PNSNode* root_ = nullptr;
+};
+
+class CompactPNSTree {
+public:
+  using Node = PNSNodeOffset;
+  static constexpr Node kNullNode = std::numeric_limits<Node>::max();
+
+  Node Reset();
+
+  int& Proof(Node node) { return GetChunk(node).proof[Index(node)]; }
+  int& Disproof(Node node) { return GetChunk(node).disproof[Index(node)]; }
+  Move GetMove(Node node) const { return GetChunk(node).move[Index(node)]; }
+  Node Parent(Node node) const { return GetChunk(node).parent[Index(node)]; }
+  int NumChildren(Node node) const {
+    return GetChunk(node).num_children[Index(node)];
+  }
+  Node Child(Node node, int i) const {
+    return GetChunk(node).children[Index(node)] + i;
+  }
+
+  uint64_t TreeSize(Node node) const;
+
+  void UpdateTreeSize(Node) {}
+
+  void AddChildren(Node node, const MoveArray& move_array);
+
+  void RemoveChildren(Node node) {
+    GetChunk(node).num_children[Index(node)] = 0;
+  }
+
+  size_t Size() const { return size_; }
+
+  void Rollback(size_t size, Node node);
+
+private:
+  static constexpr int kChunkBits = 16;
+  static constexpr size_t kChunkSize = size_t(1) << kChunkBits;
+
+  struct Chunk {
+    std::array<int, kChunkSize> proof;
+    std::array<int, kChunkSize> disproof;
+    std::array<Move, kChunkSize> move;
+    std::array<uint16_t, kChunkSize> num_children;
+    std::array<Node, kChunkSize> parent;
+    std::array<Node, kChunkSize> children;
+  };
+
+  // Allocates num_nodes contiguous nodes and returns the first one.
+  Node Allocate(size_t num_nodes);
+
+  Chunk& GetChunk(Node node) const { return *chunks_[node >> kChunkBits]; }
+  static size_t Index(Node node) { return node & (kChunkSize - 1); }
+
+  std::vector<std::unique_ptr<Chunk>> chunks_;
+  size_t size_ = 0;
+};
+
+// Fixed size hash table of proof and disproof numbers keyed by zobrist key,
+// used by df-pn in place of an explicit tree. Each bucket holds a few entries;
+// when a bucket is full, the entry whose search took the least work is
+// replaced, so that the memory used stays bounded however long the search
+// runs.
+class ProofTable {
+public:
+  // Creates a table with given number of buckets.
+  explicit ProofTable(uint64_t size);
+
+  // Returns the number of buckets that fit in given memory.
+  static uint64_t SizeForMemory(int memory_mb);
+
+  uint64_t Size() const { return buckets_.size(); }
+
+  // Returns true and sets proof and disproof if zkey is in the table.
+  bool Get(U64 zkey, int* proof, int* disproof) const;
+
+  // work is the number of nodes searched to arrive at the numbers.
+  void Put(U64 zkey, int proof, int disproof, uint64_t work);
+
+private:
+  struct Entry {
+    U64 zkey = 0;
+    int proof = 0;
+    int disproof = 0;
+    // 0 for empty entries.
+    uint64_t work = 0;
+  };
+
+  struct Bucket {
+    Entry entries[4];
+  };
+
+  uint64_t hash(U64 zkey) const {
+    return static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(zkey) * buckets_.size()) >> 64);
+  }
+
+  std::vector<Bucket> buckets_;
 };
 
 struct PNSResult {
@@ -37,20 +228,34 @@ struct PNSResult {
   };
   int result = UNKNOWN;
   uint64_t tree_size;
+  // Proof and disproof numbers of the root.
+  int proof;
+  int disproof;
   std::vector<MoveStat> ordered_moves;
-  // Pointer to the root of pns search tree. The tree will be deleted by
-  // subsequent call to PNSearch::Search. So, this pointer must not be referred
-  // afterwards.
+  // Pointer to the root of pns search tree, if the tree is stored as PNSNodes.
+  // The tree will be deleted by subsequent call to PNSearch::Search or when the
+  // PNSearch is destroyed. So, this pointer must not be referred afterwards.
   PNSNode* pns_tree = nullptr;
 };
 
 struct PNSParams {
-  enum PNSearchType { PN1, PN2 };
+  // DFPN is a depth-first proof-number search that keeps proof and disproof
+  // numbers in a ProofTable instead of a tree, so that transpositions share
+  // their work.
+  enum PNSearchType { PN1, PN2, DFPN };
   PNSearchType pns_type = PN1;
 
-  // Maximum number of nodes in PNS tree.
+  // How the tree is stored, see PNSTree and CompactPNSTree.
+  enum NodeStore { POINTER_NODES, COMPACT_NODES };
+  NodeStore node_store = POINTER_NODES;
+
+  // Maximum number of nodes in PNS tree. For DFPN, maximum number of nodes
+  // searched.
   int max_nodes = 100000;
 
+  // Memory used by the ProofTable, if pns_type = DFPN.
+  int dfpn_table_mb = 16;
+
   // Used only if pns_type = PN2 and pn2_full_search = false. See
   // PnNodes() method implementation for how these are used.
   double pn2_max_nodes_fraction_a = 0.001;
@@ -62,52 +267,115 @@ struct PNSParams {
   // Prints progress (in percentage of nodes searched out of max_nodes) after
   // every 'n' secs given by this variable if > 0.
   int log_progress = -1;
+
+  // If not null, there is more than one thread and pns_type = DFPN, the root
+  // moves are searched in parallel on these threads, see
+  // PNSearch::ParallelSearch. max_nodes is then the number of nodes searched
+  // by all threads together. PN1 and PN2 search on one thread, as their trees
+  // are rebuilt by every search.
+  SearchThreads* search_threads = nullptr;
 };
 
 template <Variant variant>
   requires(IsAntichessLike(variant))
 class PNSearch {
 public:
-  // timer_ and egtb may be null.
+  // timer_, egtb and proof_cache may be null.
   // if timer_ is null - PNSearch is not time bound.
-  PNSearch(Board& board, TranspositionTable* transpos, EGTB* egtb, Timer* timer)
-      : board_(board), egtb_(egtb), transpos_(transpos), timer_(timer) {}
-
-  ~PNSearch() {
-    if (pns_tree_) {
-      Delete(pns_tree_);
-      pns_tree_ = nullptr;
-    }
-  }
+  // Positions proven won or lost are looked up in and added to proof_cache.
+  PNSearch(Board& board, TranspositionTable* transpos, EGTB* egtb, Timer* timer,
+           ProofCache* proof_cache = nullptr)
+      : board_(board), egtb_(egtb), transpos_(transpos), timer_(timer),
+        proof_cache_(proof_cache) {}
 
   PNSResult Search(const PNSParams& pns_params);
 
 private:
-  void Expand(const PNSParams& pns_params, const int num_nodes,
-              const int pns_node_depth, PNSNode* pns_node);
+  template <typename Tree>
+  PNSResult Search(Tree& tree, const PNSParams& pns_params);
 
-  void Pns(const PNSParams& pns_params, PNSNode* pns_root);
+  template <typename Tree>
+  void Expand(Tree& tree, const PNSParams& pns_params, const int num_nodes,
+              const int pns_node_depth, typename Tree::Node pns_node);
+
+  template <typename Tree>
+  void Pns(Tree& tree, const PNSParams& pns_params,
+           typename Tree::Node pns_root);
 
   int PnNodes(const PNSParams& pns_params, const int num_nodes);
 
-  bool RedundantMoves(PNSNode* pns_node);
+  template <typename Tree>
+  bool RedundantMoves(const Tree& tree, typename Tree::Node pns_node);
+
+  template <typename Tree>
+  typename Tree::Node FindMpn(Tree& tree, typename Tree::Node pns_node,
+                              int* depth);
 
-  PNSNode* FindMpn(PNSNode* pns_node, int* depth);
+  template <typename Tree>
+  typename Tree::Node UpdateAncestors(Tree& tree, const PNSParams& pns_params,
+                                      typename Tree::Node mpn,
+                                      typename Tree::Node pns_root, int* depth);
 
-  PNSNode* UpdateAncestors(const PNSParams& pns_params, PNSNode* mpn,
-                           PNSNode* pns_root, int* depth);
+  // Sets the initial proof and disproof numbers of a newly reached position.
+  // Returns true if the position is solved.
+  bool EvaluateLeaf(int* proof, int* disproof);
 
-  void UpdateTreeSize(PNSNode* pns_node);
+  // Records the current position, found by search to be won or lost, in the
+  // transposition table and the proof cache. Proofs are put in the proof
+  // cache in batches, see FlushProofs().
+  void SaveProof(int result);
 
-  void Delete(PNSNode* pns_node);
-  void Delete(std::vector<PNSNode*>& pns_nodes);
+  // Puts the proofs saved since the last call in the proof cache.
+  void FlushProofs();
+
+  PNSResult DfpnSearch(const PNSParams& pns_params);
+
+  // Searches the positions after the root moves on the given search threads,
+  // sharing solved positions through the transposition table.
+  PNSResult ParallelSearch(const PNSParams& pns_params);
+
+  // Returns true if the search must stop.
+  bool Stopped() const {
+    return (timer_ && timer_->Lapsed()) ||
+           (stop_timer_ && stop_timer_->Lapsed());
+  }
+
+  // Searches the position at given depth until it is solved, its proof number
+  // reaches th_proof or its disproof number reaches th_disproof, or the search
+  // runs out of nodes or time. On return, proof and disproof are set to the
+  // numbers of the position.
+  void Mid(const PNSParams& pns_params, int depth, int64_t th_proof,
+           int64_t th_disproof, int* proof, int* disproof);
+
+  // A child of a position on the df-pn search path.
+  struct DfpnChild {
+    Move move;
+    int proof;
+    int disproof;
+    // Number of nodes searched under this child.
+    uint64_t work;
+  };
 
   Board& board_;
   EGTB* egtb_;
   TranspositionTable* transpos_;
   Timer* timer_;
+  ProofCache* proof_cache_;
+  // Proofs not yet put in proof_cache_.
+  std::vector<ProofCache::Proof> new_proofs_;
+  // Lapses when a parallel search no longer needs this search, e.g. because
+  // another thread has solved the root.
+  const Timer* stop_timer_ = nullptr;
+
+  PNSTree pns_tree_;
+  CompactPNSTree compact_pns_tree_;
 
-  PNSNode* pns_tree_ = nullptr;
+  std::unique_ptr<ProofTable> proof_table_;
+  // Children of the positions on the df-pn search path, indexed by depth.
+  std::vector<std::vector<DfpnChild>> dfpn_children_;
+  // Zobrist keys of the positions on the df-pn search path.
+  std::vector<U64> dfpn_path_;
+  uint64_t dfpn_nodes_ = 0;
 };
 
 #endif
@@ -3,10 +3,15 @@
 #include "move.h"
 #include "movegen.h"
 #include "pn_search.h"
+#include "proof_cache.h"
 #include "san.h"
+#include "search_threads.h"
+#include "transpos.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -15,6 +20,8 @@ PNSParams::PNSearchType GetPNSType(const char* arg) {
     return PNSParams::PN1;
   } else if (strcmp(arg, "pn2") == 0) {
     return PNSParams::PN2;
+  } else if (strcmp(arg, "dfpn") == 0) {
+    return PNSParams::DFPN;
   } else {
     throw std::invalid_argument("Invalid argument " + std::string(arg));
   }
@@ -35,9 +42,17 @@ std::string GetPosition(const char* arg) {
 }
 
 int main(int argc, char* argv[]) {
-  if (argc != 4) {
-    std::cerr << "Expect arguments: pn1/pn2 <max nodes> <move seq>\n"
-              << "Eg: ./pns_analyze pn1 100000 \"e3 b6\"" << std::endl;
+  if (argc < 4) {
+    std::cerr << "Expect arguments: pn1/pn2/dfpn <max nodes> <move seq> "
+                 "[compact] [threads=<n>] [cache=<file>]\n"
+              << "Eg: ./pns_analyze pn1 100000 \"e3 b6\"\n"
+              << "With 'compact', the tree is stored in a compact layout of "
+                 "about 20 bytes per node, for very large trees.\n"
+              << "With 'threads=<n>' and dfpn, the root moves are searched on "
+                 "n threads sharing a transposition table.\n"
+              << "With 'cache=<file>', proven positions are looked up in and "
+                 "added to the proof cache file."
+              << std::endl;
     return 0;
   }
   const auto pns_type = GetPNSType(argv[1]);
@@ -49,14 +64,36 @@ int main(int argc, char* argv[]) {
   PNSParams pns_params;
   pns_params.max_nodes = max_nodes;
   pns_params.pns_type = pns_type;
+  int num_threads = 1;
+  std::unique_ptr<ProofCache> proof_cache;
+  for (int i = 4; i < argc; ++i) {
+    if (strcmp(argv[i], "compact") == 0) {
+      pns_params.node_store = PNSParams::COMPACT_NODES;
+    } else if (strncmp(argv[i], "threads=", 8) == 0) {
+      num_threads = std::max(1, atoi(argv[i] + 8));
+    } else if (strncmp(argv[i], "cache=", 6) == 0) {
+      proof_cache =
+          std::make_unique<ProofCache>(argv[i] + 6, Variant::ANTICHESS);
+    } else {
+      throw std::invalid_argument("Invalid argument " + std::string(argv[i]));
+    }
+  }
+  SearchThreads search_threads(num_threads);
+  std::unique_ptr<TranspositionTable> transpos;
+  if (num_threads > 1) {
+    pns_params.search_threads = &search_threads;
+    transpos = std::make_unique<TranspositionTable>(
+        TranspositionTable::SizeForMemory(256));
+  }
   pns_params.quiet = false;
   pns_params.log_progress = 10;
   const PNSResult pns_result =
-      PNSearch<Variant::ANTICHESS>(board, nullptr, nullptr, nullptr)
+      PNSearch<Variant::ANTICHESS>(board, transpos.get(), nullptr, nullptr,
+                                   proof_cache.get())
           .Search(pns_params);
-  std::cout << "tree_size: " << pns_result.pns_tree->tree_size << "\n"
-            << "proof: " << pns_result.pns_tree->proof << "\n"
-            << "disproof: " << pns_result.pns_tree->disproof << std::endl;
+  std::cout << "tree_size: " << pns_result.tree_size << "\n"
+            << "proof: " << pns_result.proof << "\n"
+            << "disproof: " << pns_result.disproof << std::endl;
 
   return 0;
 }
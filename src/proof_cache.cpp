@@ -0,0 +1,182 @@
+#include "proof_cache.h"
+#include "board.h"
+#include "common.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[8] = {'N', 'K', 'P', 'R', 'O', 'O', 'F', '\0'};
+constexpr uint32_t kVersion = 1;
+
+std::runtime_error Error(const std::string& path, const std::string& what) {
+  return std::runtime_error("proof cache " + path + ": " + what);
+}
+
+// Takes an exclusive lock on the file, held until flock(fd, LOCK_UN) or until
+// the file is closed. Returns 0 on success, else -1 with errno set.
+int LockFile(const int fd) {
+  int ret;
+  while ((ret = flock(fd, LOCK_EX)) != 0 && errno == EINTR) {
+  }
+  return ret;
+}
+
+} // namespace
+
+ProofCache::Header ProofCache::MakeHeader(const Variant variant) {
+  Header header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.variant = static_cast<uint32_t>(variant);
+  header.zobrist_check = Board(variant).ZobristKey();
+  return header;
+}
+
+ProofCache::ProofCache(const std::string& path, const Variant variant)
+    : variant_(variant) {
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (fd_ < 0) {
+    throw Error(path, strerror(errno));
+  }
+  // Closing the file on error also releases the lock.
+  struct stat st;
+  if (LockFile(fd_) != 0 || fstat(fd_, &st) != 0) {
+    close(fd_);
+    throw Error(path, strerror(errno));
+  }
+  const Header header = MakeHeader(variant);
+  size_t file_bytes = st.st_size;
+  if (file_bytes == 0) {
+    if (write(fd_, &header, sizeof(header)) != sizeof(header)) {
+      close(fd_);
+      throw Error(path, "cannot write header");
+    }
+    file_bytes = sizeof(header);
+  }
+  if (file_bytes < sizeof(header)) {
+    close(fd_);
+    throw Error(path, "truncated header");
+  }
+
+  // Appends are made under the lock, so a record cut short here is left by a
+  // failed write. It would misalign the records appended after it, so it is
+  // dropped.
+  mapped_bytes_ = file_bytes - (file_bytes - sizeof(header)) % sizeof(Record);
+  if (mapped_bytes_ != file_bytes && ftruncate(fd_, mapped_bytes_) != 0) {
+    close(fd_);
+    throw Error(path, strerror(errno));
+  }
+  flock(fd_, LOCK_UN);
+  // Records appended after this point are not mapped.
+  mapped_ = mmap(nullptr, mapped_bytes_, PROT_READ, MAP_SHARED, fd_, 0);
+  if (mapped_ == MAP_FAILED) {
+    mapped_ = nullptr;
+    close(fd_);
+    throw Error(path, strerror(errno));
+  }
+  if (std::memcmp(mapped_, &header, sizeof(header)) != 0) {
+    munmap(mapped_, mapped_bytes_);
+    close(fd_);
+    throw Error(path, "written for another variant or engine version");
+  }
+  records_ = reinterpret_cast<const Record*>(static_cast<const char*>(mapped_) +
+                                             sizeof(header));
+  num_records_ = (mapped_bytes_ - sizeof(header)) / sizeof(Record);
+
+  index_.resize(std::max<size_t>(1, 2 * num_records_));
+  for (size_t i = 0; i < num_records_; ++i) {
+    // The first record of a key wins if more than one process appended it.
+    uint64_t slot = hash(records_[i].zkey);
+    while (index_[slot] &&
+           records_[index_[slot] - 1].zkey != records_[i].zkey) {
+      slot = (slot + 1) % index_.size();
+    }
+    if (!index_[slot]) {
+      index_[slot] = i + 1;
+    }
+  }
+  std::cout << "# Proof cache " << path << ": " << num_records_ << " positions"
+            << std::endl;
+}
+
+ProofCache::~ProofCache() {
+  if (mapped_) {
+    munmap(mapped_, mapped_bytes_);
+  }
+  close(fd_);
+}
+
+int ProofCache::Get(const U64 zkey) const {
+  for (uint64_t slot = hash(zkey); index_[slot];
+       slot = (slot + 1) % index_.size()) {
+    const Record& record = records_[index_[slot] - 1];
+    if (record.zkey == zkey) {
+      return record.result > 0 ? WIN : -WIN;
+    }
+  }
+  return UNKNOWN;
+}
+
+void ProofCache::Put(const std::vector<Proof>& proofs) {
+  std::vector<Record> records;
+  for (const Proof& proof : proofs) {
+    if (Get(proof.zkey) == UNKNOWN) {
+      records.push_back(
+          {.zkey = proof.zkey, .result = proof.result == WIN ? 1 : -1});
+    }
+  }
+  // A search may prove a position more than once.
+  std::sort(records.begin(), records.end(),
+            [](const Record& a, const Record& b) { return a.zkey < b.zkey; });
+  records.erase(std::unique(records.begin(), records.end(),
+                            [](const Record& a, const Record& b) {
+                              return a.zkey == b.zkey;
+                            }),
+                records.end());
+  if (records.empty()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (write_failed_) {
+    return;
+  }
+  // Other processes append under the same lock, so the file does not grow
+  // between fstat() and a truncate undoing a failed write.
+  struct stat st;
+  if (LockFile(fd_) != 0 || fstat(fd_, &st) != 0) {
+    std::cerr << "# Proof cache lock failed: " << strerror(errno) << std::endl;
+    flock(fd_, LOCK_UN);
+    write_failed_ = true;
+    return;
+  }
+  const ssize_t bytes = records.size() * sizeof(Record);
+  const ssize_t written = write(fd_, records.data(), bytes);
+  if (written != bytes) {
+    if (written < 0) {
+      std::cerr << "# Proof cache write failed: " << strerror(errno)
+                << std::endl;
+    } else {
+      std::cerr << "# Proof cache write failed: " << written << " of "
+                << bytes << " bytes written" << std::endl;
+    }
+    // Drops a partly written batch, so that later appends stay aligned.
+    if (ftruncate(fd_, st.st_size) != 0) {
+      std::cerr << "# Proof cache truncate failed: " << strerror(errno)
+                << std::endl;
+    }
+    write_failed_ = true;
+  }
+  flock(fd_, LOCK_UN);
+}
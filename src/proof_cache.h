@@ -0,0 +1,98 @@
+#ifndef PROOF_CACHE_H
+#define PROOF_CACHE_H
+
+#include "common.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Positions proven won or lost by proof-number search, kept in a file so that
+// they are known without search in later runs.
+//
+// The file is append-only: a header followed by fixed size records of a
+// Zobrist key and the result for the side to move. Records present when the
+// file is opened are memory-mapped and indexed, and Get() only sees those.
+// Put() appends to the file, so the records it adds are seen when the file is
+// next opened, by this or another process. Processes sharing the file take an
+// exclusive flock() on it to write the header, append, and truncate away a
+// record cut short by a failed write, so that none of these cuts into the
+// records of another process.
+class ProofCache {
+public:
+  // Opens the cache file at path for given variant, creating it if it does not
+  // exist. Throws std::runtime_error if the file cannot be used, including when
+  // it was written for another variant or with other Zobrist keys.
+  ProofCache(const std::string& path, Variant variant);
+  ~ProofCache();
+
+  ProofCache(const ProofCache&) = delete;
+  ProofCache& operator=(const ProofCache&) = delete;
+
+  Variant variant() const { return variant_; }
+
+  struct Proof {
+    U64 zkey;
+    // WIN or -WIN for the side to move.
+    int result;
+  };
+
+  // Returns WIN or -WIN for the side to move if the position with given key was
+  // in the file when it was opened, else UNKNOWN. Safe to call from concurrent
+  // search threads.
+  int Get(U64 zkey) const;
+
+  // Appends the proofs whose positions were not in the file when it was
+  // opened, in a single write. Searches collect their proofs and put them in
+  // batches, as this takes a lock and a system call. Safe to call from
+  // concurrent threads.
+  void Put(const std::vector<Proof>& proofs);
+
+  // Number of records mapped when the file was opened.
+  size_t Size() const { return num_records_; }
+
+private:
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t variant;
+    // Zobrist key of the initial position, to tell apart files written by an
+    // engine with different Zobrist keys.
+    U64 zobrist_check;
+    uint64_t reserved;
+  };
+
+  struct Record {
+    U64 zkey;
+    // 1 if the side to move wins, -1 if it loses.
+    int32_t result;
+    uint32_t reserved;
+  };
+  static_assert(sizeof(Record) == 16);
+
+  static Header MakeHeader(Variant variant);
+
+  uint64_t hash(const U64 zkey) const {
+    return (static_cast<unsigned __int128>(zkey) * index_.size()) >> 64;
+  }
+
+  const Variant variant_;
+  int fd_ = -1;
+  void* mapped_ = nullptr;
+  size_t mapped_bytes_ = 0;
+  const Record* records_ = nullptr;
+  size_t num_records_ = 0;
+
+  // Open addressed index into records_ with linear probing. Slots hold record
+  // index + 1, or 0 if empty.
+  std::vector<uint32_t> index_;
+
+  // Serializes appends by the threads of this process, which share the file
+  // lock of fd_.
+  std::mutex mutex_;
+  // Set once an append fails, after which nothing more is appended.
+  bool write_failed_ = false;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#include "psqt.h"
+#include "common.h"
+#include "params/params.h"
+#include "std_static_eval.h"
+
+#include <array>
+
+namespace {
+
+constexpr int SQUARE_MAX = 64;
+
+const std::array<std::array<psqt::Score, SQUARE_MAX>, 12> scores_ = []() {
+  const StdEvalParams<int> params = BlessedParams();
+  std::array<std::array<psqt::Score, SQUARE_MAX>, 12> scores;
+  for (Piece piece = -PAWN; piece <= PAWN; ++piece) {
+    if (piece == NULLPIECE) {
+      continue;
+    }
+    const Piece piece_type = PieceType(piece);
+    const bool white = PieceSide(piece) == Side::WHITE;
+    const int sign = white ? 1 : -1;
+    for (int sq = 0; sq < SQUARE_MAX; ++sq) {
+      const int index = white ? (sq ^ 56) : sq;
+      psqt::Score& score = scores[PieceIndex(piece)][sq];
+      score.mgame = sign * (params.pst_mgame[piece_type][index] +
+                            params.pv_mgame[piece_type]);
+      score.egame = sign * (params.pst_egame[piece_type][index] +
+                            params.pv_egame[piece_type]);
+      score.game_phase = standard::GAME_PHASE_INC[piece_type];
+    }
+  }
+  return scores;
+}();
+
+} // namespace
+
+namespace psqt {
+
+Score Get(const Piece piece, const int sq) {
+  return scores_[PieceIndex(piece)][sq];
+}
+
+} // namespace psqt
@@ -0,0 +1,24 @@
+#ifndef PSQT_H
+#define PSQT_H
+
+#include "common.h"
+
+// Material and piece-square table scores under BlessedParams(), which the board
+// keeps up to date incrementally as pieces are placed and removed.
+namespace psqt {
+
+struct Score {
+  // Material plus piece-square scores from white's point of view, so that
+  // black pieces have negated scores.
+  int mgame = 0;
+  int egame = 0;
+
+  // Contribution of the piece towards the middle game phase.
+  int game_phase = 0;
+};
+
+Score Get(Piece piece, int sq);
+
+} // namespace psqt
+
+#endif
@@ -59,7 +59,8 @@ int PVSearch<variant>::PVS(int max_depth, int alpha, int beta, int ply,
   }
 
   if (max_depth <= 0 || (timer_ && timer_->Lapsed())) {
-    return Evaluate<variant>(board_, egtb_, alpha, beta);
+    return Evaluate<variant>(board_, egtb_, alpha, beta, &transpos_,
+                             &search_stats);
   }
 
   Move tt_move = Move();
@@ -104,33 +105,31 @@ int PVSearch<variant>::PVS(int max_depth, int alpha, int beta, int ply,
     if (!in_check && max_depth == 1) {
       const int eval_score = StaticEval(board_);
       if (eval_score + 450 <= alpha) {
-        return Evaluate<variant>(board_, egtb_, alpha, beta);
+        return Evaluate<variant>(board_, egtb_, alpha, beta, &transpos_,
+                                 &search_stats);
       }
     }
   }
 
-  MoveArray move_array = GenerateMoves<variant>(board_);
-
-  // We have essentially reached the end of the game, so evaluate.
-  if (move_array.size() == 0) {
-    return Evaluate<variant>(board_, egtb_, alpha, beta);
-  }
-
   PrefMoves pref_moves;
   pref_moves.tt_move = tt_move;
   pref_moves.killer1 = killers_[ply][0];
   pref_moves.killer2 = killers_[ply][1];
-  const MoveInfoArray move_info_array =
-      OrderMoves<variant>(board_, move_array, &pref_moves);
+  MovePicker<variant> move_picker(board_, pref_moves);
 
   Move best_move;
   NodeType node_type = NodeType::FAIL_LOW_NODE;
   int b = beta;
   int score = -INF;
-  for (size_t index = 0; index < move_info_array.size; ++index) {
-    const MoveInfo& move_info = move_info_array.moves[index];
+  size_t num_moves = 0;
+  for (MoveInfo move_info; move_picker.Next(move_info);) {
+    const size_t index = num_moves++;
     const Move move = move_info.move;
     board_.MakeMove(move);
+    transpos_.Prefetch(board_.ZobristKey());
+    if constexpr (IsStandard(variant)) {
+      standard::PrefetchPawnHashEntry(board_.PawnZobristKey());
+    }
 
     int value = -INF;
 
@@ -188,6 +187,12 @@ int PVSearch<variant>::PVS(int max_depth, int alpha, int beta, int ply,
     b = alpha + 1;
   }
 
+  // We have essentially reached the end of the game, so evaluate.
+  if (num_moves == 0) {
+    return Evaluate<variant>(board_, egtb_, alpha, beta, &transpos_,
+                             &search_stats);
+  }
+
   if (!(timer_ && timer_->Lapsed())) {
     transpos_.Put(score, node_type, max_depth, zkey, best_move);
   }
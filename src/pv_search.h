@@ -8,11 +8,20 @@
 #include "timer.h"
 #include "transpos.h"
 
+#include <array>
+
+// Two killer moves for each ply.
+using Killers = std::array<std::array<Move, 2>, MAX_DEPTH>;
+
 template <Variant variant>
 class PVSearch {
 public:
-  PVSearch(Board& board, Timer* timer, TranspositionTable& transpos, EGTB* egtb)
-      : board_(board), timer_(timer), transpos_(transpos), egtb_(egtb) {}
+  // If killers is not null, killer moves are kept in (and may be carried over
+  // to subsequent searches through) the given table.
+  PVSearch(Board& board, Timer* timer, TranspositionTable& transpos, EGTB* egtb,
+           Killers* killers = nullptr)
+      : board_(board), timer_(timer), transpos_(transpos), egtb_(egtb),
+        killers_(killers ? *killers : own_killers_) {}
 
   int Search(int max_depth, int alpha, int beta, SearchStats& search_stats);
 
@@ -24,7 +33,8 @@ private:
   Timer* timer_;
   TranspositionTable& transpos_;
   EGTB* egtb_;
-  Move killers_[MAX_DEPTH][2];
+  Killers own_killers_ = {};
+  Killers& killers_;
 };
 
 #endif
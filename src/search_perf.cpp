@@ -0,0 +1,105 @@
+#include "board.h"
+#include "common.h"
+#include "egtb.h"
+#include "id_search.h"
+#include "nnue.h"
+#include "stopwatch.h"
+#include "timer.h"
+#include "transpos.h"
+
+#include <cassert>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Fixed-depth search benchmark: searches each of a few positions to given depth
+// with a fresh transposition table and reports the overall node rate, counting
+// both main and quiescence search nodes. Table allocation is not included in
+// the elapsed time. An optional third argument names a network file to evaluate
+// standard chess with, see nnue.h.
+
+constexpr int kTransposMemoryMB = 256;
+
+const std::vector<std::string> kStandardFENs = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ -",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -",
+};
+
+const std::vector<std::string> kAntichessFENs = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - -",
+    "rnbqkbnr/p1pppppp/8/1p6/8/4P3/PPPP1PPP/RNBQKBNR w - -",
+    "rnbqkb1r/pppppppp/5n2/8/8/1P6/P1PPPPPP/RNBQKBNR w - -",
+};
+
+template <Variant variant>
+int64_t SearchNodes(const std::string& fen, unsigned int depth,
+                    TranspositionTable& transpos) {
+  Board board(variant, fen);
+  Timer timer;
+  timer.Run();
+  const IDSResult result = IDSearch<variant>(
+      IDSParams{.search_depth = int(depth)}, board, timer, transpos,
+      GetEGTB(variant));
+  return result.id_search_stats.nodes_searched +
+         result.id_search_stats.qnodes_searched;
+}
+
+int main(int argc, char** argv) {
+  assert(argc == 3 || argc == 4);
+
+  unsigned int depth = 0;
+  Variant variant;
+  const std::vector<std::string>* fens;
+  std::function<int64_t(const std::string& fen, unsigned int depth,
+                        TranspositionTable& transpos)>
+      search_fn;
+  if (argv[1][0] == 's' || argv[1][0] == 'S') {
+    variant = Variant::ANTICHESS;
+    fens = &kAntichessFENs;
+    search_fn = SearchNodes<Variant::ANTICHESS>;
+  } else {
+    variant = Variant::STANDARD;
+    fens = &kStandardFENs;
+    search_fn = SearchNodes<Variant::STANDARD>;
+  }
+  depth = atoi(argv[2]);
+  std::unique_ptr<nnue::Network> network;
+  if (argc == 4) {
+    network = nnue::LoadNetwork(argv[3]);
+    nnue::SetActiveNetwork(network.get());
+  }
+  // Loads endgame tablebases, if any, ahead of the timed searches.
+  GetEGTB(variant);
+
+  int64_t nodes = 0;
+  double elapsed_secs = 0;
+  for (const std::string& fen : *fens) {
+    TranspositionTable transpos(
+        TranspositionTable::SizeForMemory(kTransposMemoryMB));
+    StopWatch stop_watch;
+    stop_watch.Start();
+    nodes += search_fn(fen, depth, transpos);
+    stop_watch.Stop();
+    elapsed_secs += stop_watch.ElapsedTime() / 100.0;
+  }
+
+  printf(
+      "+--------+------------------+-----------------+--------------------+\n");
+  printf(
+      "| Depth  | Elapsed time (s) |    Num Nodes    |   Num Nodes / sec  |\n");
+  printf(
+      "+--------+------------------+-----------------+--------------------+\n");
+  printf("|%6d  | %16.3f | %12" PRId64 "    | %17.3f  |\n", depth, elapsed_secs,
+         nodes, static_cast<double>(nodes) / elapsed_secs);
+  printf(
+      "+--------+------------------+-----------------+--------------------+\n");
+
+  return 0;
+}
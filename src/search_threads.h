@@ -0,0 +1,52 @@
+#ifndef SEARCH_THREADS_H
+#define SEARCH_THREADS_H
+
+#include "board.h"
+#include "common.h"
+#include "move_array.h"
+#include "pv_search.h"
+#include "thread_pool.h"
+#include "timer.h"
+
+#include <memory>
+#include <vector>
+
+// Search state owned by a single search thread. It outlives individual
+// searches so that the board buffer and killer moves are reused across
+// iterations and moves.
+struct SearchThread {
+  Board board = Board(Variant::STANDARD);
+  Killers killers = {};
+
+  // Used only by helper threads to stop searching; the thread calling
+  // IDSearch uses the timer given to it. A parallel proof-number search uses
+  // it on every thread to stop the searches no longer needed.
+  Timer timer;
+
+  // Root moves in the order this thread searches them.
+  MoveArray root_move_array;
+};
+
+// Threads used for Lazy SMP search along with their per-thread state. State at
+// index 0 belongs to the thread calling IDSearch and state at index i > 0 to
+// the pool worker i - 1.
+struct SearchThreads {
+  SearchThreads(int num_threads) { Resize(num_threads); }
+
+  // Sets the total number of search threads, including the calling thread.
+  // Must not be called while a search is running.
+  void Resize(int num_threads) {
+    pool.Resize(num_threads - 1);
+    while (int(threads.size()) < num_threads) {
+      threads.push_back(std::make_unique<SearchThread>());
+    }
+    threads.resize(num_threads);
+  }
+
+  int NumThreads() const { return threads.size(); }
+
+  ThreadPool pool;
+  std::vector<std::unique_ptr<SearchThread>> threads;
+};
+
+#endif
@@ -3,10 +3,64 @@
 
 #include "common.h"
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
 // Stats for search operations.
 struct SearchStats {
+  // Nodes visited by the main search.
   U64 nodes_searched = 0ULL;
+  // Nodes visited by the quiescence search run at main search leaves.
+  U64 qnodes_searched = 0ULL;
   U64 search_depth = 0ULL;
 };
 
+// Counters incremented by concurrent threads mostly without sharing cache
+// lines: each thread adds to counters in its slot, and Sum() adds up the
+// slots. Threads are given slots round robin as they are created, so once more
+// than kNumSlots threads have been created over the life of the process, two
+// live threads may share a slot.
+template <size_t num_counters>
+class ThreadCounters {
+public:
+  void Add(const size_t counter, const uint64_t n = 1) {
+    // A read-modify-write, as the slot may be shared. Uncontended, the line
+    // stays in the cache of the thread.
+    slots_[ThreadSlot()].counts[counter].fetch_add(n,
+                                                   std::memory_order_relaxed);
+  }
+
+  uint64_t Sum(const size_t counter) const {
+    uint64_t sum = 0;
+    for (const Slot& slot : slots_) {
+      sum += slot.counts[counter].load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  void Reset() {
+    for (Slot& slot : slots_) {
+      for (std::atomic<uint64_t>& count : slot.counts) {
+        count.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+private:
+  static constexpr size_t kNumSlots = 64;
+
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> counts[num_counters] = {};
+  };
+
+  static size_t ThreadSlot() {
+    static std::atomic<size_t> next_slot = 0;
+    thread_local const size_t slot = next_slot++ % kNumSlots;
+    return slot;
+  }
+
+  Slot slots_[kNumSlots];
+};
+
 #endif
@@ -9,6 +9,7 @@
 #include "std_eval_params.h"
 #include <array>
 #include <iostream>
+#include <type_traits>
 
 namespace standard {
 
@@ -35,6 +36,38 @@ void AddPSTScores(const StdEvalParams<ValueType>& params, U64 bb,
   }
 }
 
+template <typename ValueType>
+void AddPSTScores(const StdEvalParams<ValueType>& params, const Board& board,
+                  int& game_phase, ValueType& w_mgame_score,
+                  ValueType& w_egame_score, ValueType& b_mgame_score,
+                  ValueType& b_egame_score) {
+  AddPSTScores<KING>(params, board.BitBoard(KING), game_phase, w_mgame_score,
+                     w_egame_score);
+  AddPSTScores<QUEEN>(params, board.BitBoard(QUEEN), game_phase, w_mgame_score,
+                      w_egame_score);
+  AddPSTScores<ROOK>(params, board.BitBoard(ROOK), game_phase, w_mgame_score,
+                     w_egame_score);
+  AddPSTScores<BISHOP>(params, board.BitBoard(BISHOP), game_phase,
+                       w_mgame_score, w_egame_score);
+  AddPSTScores<KNIGHT>(params, board.BitBoard(KNIGHT), game_phase,
+                       w_mgame_score, w_egame_score);
+  AddPSTScores<PAWN>(params, board.BitBoard(PAWN), game_phase, w_mgame_score,
+                     w_egame_score);
+
+  AddPSTScores<-KING>(params, board.BitBoard(-KING), game_phase, b_mgame_score,
+                      b_egame_score);
+  AddPSTScores<-QUEEN>(params, board.BitBoard(-QUEEN), game_phase,
+                       b_mgame_score, b_egame_score);
+  AddPSTScores<-ROOK>(params, board.BitBoard(-ROOK), game_phase, b_mgame_score,
+                      b_egame_score);
+  AddPSTScores<-BISHOP>(params, board.BitBoard(-BISHOP), game_phase,
+                        b_mgame_score, b_egame_score);
+  AddPSTScores<-KNIGHT>(params, board.BitBoard(-KNIGHT), game_phase,
+                        b_mgame_score, b_egame_score);
+  AddPSTScores<-PAWN>(params, board.BitBoard(-PAWN), game_phase, b_mgame_score,
+                      b_egame_score);
+}
+
 struct PawnStructData {
   U64 pawn_zobrist_key;
   U64 white_bb;
@@ -45,6 +78,22 @@ struct PawnStructData {
   int b_egame_score;
 };
 
+inline constexpr int PAWN_HASHTABLE_SIZE = 2048;
+
+// Returns the entry for given pawn zobrist key in this thread's pawn hash
+// table.
+inline PawnStructData& PawnHashEntry(const U64 pawn_zkey) {
+  static thread_local std::array<PawnStructData, PAWN_HASHTABLE_SIZE>
+      pawn_hashtable;
+  return pawn_hashtable[pawn_zkey % PAWN_HASHTABLE_SIZE];
+}
+
+// Hints the CPU to start loading the pawn hash entry for given key into cache,
+// so that it is likely to be there by the time the position is evaluated.
+inline void PrefetchPawnHashEntry(const U64 pawn_zkey) {
+  __builtin_prefetch(&PawnHashEntry(pawn_zkey));
+}
+
 /*
 Params20241117Epoch99Step63720IntegerizedNoP: PawnStructureScores turned off
 Score of Params20241117Epoch99Step63720IntegerizedNoP vs Params20241117Epoch99Step63720Integerized: 747 - 1131 - 584  [0.422] 2462
@@ -156,12 +205,8 @@ void AddWBPawnStructureScores(const StdEvalParams<ValueType>& params,
                               ValueType& w_egame_score,
                               ValueType& b_mgame_score,
                               ValueType& b_egame_score) {
-  static constexpr int PAWN_HASHTABLE_SIZE = 2048;
-  static thread_local std::array<PawnStructData, PAWN_HASHTABLE_SIZE>
-      pawn_hashtable;
   const U64 pawn_zkey = board.PawnZobristKey();
-  const int map_index = static_cast<int>(pawn_zkey % PAWN_HASHTABLE_SIZE);
-  const auto& data = pawn_hashtable[map_index];
+  PawnStructData& data = PawnHashEntry(pawn_zkey);
   if (pawn_zkey == data.pawn_zobrist_key &&
       board.BitBoard(PAWN) == data.white_bb &&
       board.BitBoard(-PAWN) == data.black_bb) {
@@ -173,7 +218,7 @@ void AddWBPawnStructureScores(const StdEvalParams<ValueType>& params,
   }
   ValueType wmscore = 0, wescore = 0, bmscore = 0, bescore = 0;
   AddWBPawnStructureScores<ValueType, false>(params, board, wmscore, wescore, bmscore, bescore);
-  pawn_hashtable[map_index] = PawnStructData{
+  data = PawnStructData{
       .pawn_zobrist_key = pawn_zkey,
       .white_bb = board.BitBoard(PAWN),
       .black_bb = board.BitBoard(-PAWN),
@@ -213,54 +258,34 @@ void AddMobilityScores(const StdEvalParams<ValueType>& params,
   }
 }
 
+// If board_psq_scores is set, the material, piece-square and game phase terms
+// are taken from those the board maintains incrementally rather than computed
+// from params. These are computed with BlessedParams(), so params must be
+// BlessedParams() too.
 template <typename ValueType, bool score_flip = true,
           bool enable_pawn_hashtable = true,
-          bool include_pawn_structure_score = true>
+          bool include_pawn_structure_score = true,
+          bool board_psq_scores = false>
 ValueType StaticEval(const StdEvalParams<ValueType>& params, Board& board) {
-  const U64 w_king = board.BitBoard(KING);
-  const U64 w_queen = board.BitBoard(QUEEN);
-  const U64 w_rook = board.BitBoard(ROOK);
-  const U64 w_bishop = board.BitBoard(BISHOP);
-  const U64 w_knight = board.BitBoard(KNIGHT);
-  const U64 w_pawn = board.BitBoard(PAWN);
-
   int game_phase = 0;
   ValueType w_mgame_score = 0, w_egame_score = 0;
+  ValueType b_mgame_score = 0, b_egame_score = 0;
 
-  AddPSTScores<KING>(params, w_king, game_phase, w_mgame_score, w_egame_score);
-  AddPSTScores<QUEEN>(params, w_queen, game_phase, w_mgame_score,
-                      w_egame_score);
-  AddPSTScores<ROOK>(params, w_rook, game_phase, w_mgame_score, w_egame_score);
-  AddPSTScores<BISHOP>(params, w_bishop, game_phase, w_mgame_score,
-                       w_egame_score);
-  AddPSTScores<KNIGHT>(params, w_knight, game_phase, w_mgame_score,
-                       w_egame_score);
-  AddPSTScores<PAWN>(params, w_pawn, game_phase, w_mgame_score, w_egame_score);
+  if constexpr (board_psq_scores) {
+    static_assert(std::is_same_v<ValueType, int>);
+    w_mgame_score = board.PsqMGameScore();
+    w_egame_score = board.PsqEGameScore();
+    game_phase = board.GamePhase();
+  } else {
+    AddPSTScores(params, board, game_phase, w_mgame_score, w_egame_score,
+                 b_mgame_score, b_egame_score);
+  }
 
   AddMobilityScores<QUEEN>(params, board, w_mgame_score, w_egame_score);
   AddMobilityScores<ROOK>(params, board, w_mgame_score, w_egame_score);
   AddMobilityScores<BISHOP>(params, board, w_mgame_score, w_egame_score);
   AddMobilityScores<KNIGHT>(params, board, w_mgame_score, w_egame_score);
 
-  const U64 b_king = board.BitBoard(-KING);
-  const U64 b_queen = board.BitBoard(-QUEEN);
-  const U64 b_rook = board.BitBoard(-ROOK);
-  const U64 b_bishop = board.BitBoard(-BISHOP);
-  const U64 b_knight = board.BitBoard(-KNIGHT);
-  const U64 b_pawn = board.BitBoard(-PAWN);
-
-  ValueType b_mgame_score = 0, b_egame_score = 0;
-
-  AddPSTScores<-KING>(params, b_king, game_phase, b_mgame_score, b_egame_score);
-  AddPSTScores<-QUEEN>(params, b_queen, game_phase, b_mgame_score,
-                       b_egame_score);
-  AddPSTScores<-ROOK>(params, b_rook, game_phase, b_mgame_score, b_egame_score);
-  AddPSTScores<-BISHOP>(params, b_bishop, game_phase, b_mgame_score,
-                        b_egame_score);
-  AddPSTScores<-KNIGHT>(params, b_knight, game_phase, b_mgame_score,
-                        b_egame_score);
-  AddPSTScores<-PAWN>(params, b_pawn, game_phase, b_mgame_score, b_egame_score);
-
   if constexpr (include_pawn_structure_score) {
     AddWBPawnStructureScores<ValueType, enable_pawn_hashtable>(
         params, board, w_mgame_score, w_egame_score, b_mgame_score,
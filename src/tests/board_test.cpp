@@ -5,6 +5,8 @@
 #include "san.h"
 
 #include <gtest/gtest.h>
+#include <string>
+#include <vector>
 
 #define _ NULLPIECE
 
@@ -602,3 +604,28 @@ TEST(BoardTest, ToCompactBoardDesc) {
   EXPECT_EQ(board.BitBoard(Side::WHITE), board2.BitBoard(Side::WHITE));
   EXPECT_EQ(board.ZobristKey(), board2.ZobristKey());
 }
+
+TEST(BoardTest, MaterialSignature) {
+  // Captures, an en passant capture and a promotion with capture.
+  const std::vector<std::string> moves = {"e2e4", "d7d5", "e4d5", "e7e5",
+                                          "d5e6", "b8c6", "e6f7", "e8e7",
+                                          "f7g8q"};
+  Board board(Variant::STANDARD);
+  std::vector<U64> signatures = {board.MaterialSignature()};
+  for (const std::string& move : moves) {
+    board.MakeMove(Move(move));
+    EXPECT_EQ(Board(Variant::STANDARD, board.ToCompactBoardDesc())
+                  .MaterialSignature(),
+              board.MaterialSignature())
+        << move;
+    signatures.push_back(board.MaterialSignature());
+  }
+  EXPECT_EQ(7U, (board.MaterialSignature() >> (4 * PieceIndex(PAWN))) & 0xF);
+  EXPECT_EQ(5U, (board.MaterialSignature() >> (4 * PieceIndex(-PAWN))) & 0xF);
+  EXPECT_EQ(2U, (board.MaterialSignature() >> (4 * PieceIndex(QUEEN))) & 0xF);
+  EXPECT_EQ(1U, (board.MaterialSignature() >> (4 * PieceIndex(-KNIGHT))) & 0xF);
+  for (size_t i = moves.size(); i > 0; --i) {
+    board.UnmakeLastMove();
+    EXPECT_EQ(signatures[i - 1], board.MaterialSignature());
+  }
+}
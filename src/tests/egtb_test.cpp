@@ -0,0 +1,277 @@
+#include "board.h"
+#include "common.h"
+#include "compact.h"
+#include "egtb.h"
+#include "egtb_generator.h"
+#include "egtb_index.h"
+#include "eval.h"
+#include "movegen.h"
+
+#include <cstdio>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <gtest/gtest.h>
+#include <list>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+egtb::MaterialKey Key(const std::string& fen) {
+  return egtb::GetMaterialKey(Board(Variant::ANTICHESS, fen));
+}
+
+} // namespace
+
+TEST(EGTBTest, MaterialKeys) {
+  const egtb::MaterialKey krk = Key("8/R7/8/8/8/8/8/7k w - -");
+  EXPECT_EQ(krk, egtb::FlipColors(Key("8/r7/8/8/8/8/8/7K w - -")));
+  EXPECT_EQ(egtb::CanonicalKey(krk),
+            egtb::CanonicalKey(egtb::FlipColors(krk)));
+  EXPECT_EQ(2, egtb::NumPieces(krk));
+  EXPECT_EQ(0, egtb::NumPawns(krk));
+  EXPECT_EQ(2, egtb::NumPawns(Key("8/p7/8/8/8/8/P7/8 w - -")));
+  // One piece: 12 pieces of either colour. Two pieces: 6 * 7 / 2 materials of
+  // pieces of the same colour, counted once for both colours, and 6 * 7 / 2
+  // materials of pieces of both colours, counted once for swapped colours.
+  EXPECT_EQ(6u, egtb::AllCanonicalKeys(1).size());
+  EXPECT_EQ(6u + 21u + 21u, egtb::AllCanonicalKeys(2).size());
+}
+
+TEST(EGTBTest, IndexRoundTrip) {
+  for (const std::string fen :
+       {"8/R7/8/8/8/8/8/7k w - -", "8/8/8/8/8/8/Pp6/8 w - -",
+        "8/8/8/8/8/8/1N6/1NN5 w - -", "8/8/8/3p4/8/8/1P6/k7 w - -"}) {
+    const egtb::TableIndexer indexer(egtb::CanonicalKey(Key(fen)));
+    uint64_t num_positions = 0;
+    BoardDesc board_desc;
+    for (uint64_t index = 0; index < indexer.Size(); ++index) {
+      if (indexer.Position(index, &board_desc)) {
+        ++num_positions;
+        ASSERT_EQ(index, indexer.Index(Board(Variant::ANTICHESS, board_desc)))
+            << fen;
+      }
+    }
+    EXPECT_GT(num_positions, indexer.Size() / 16) << fen;
+  }
+}
+
+TEST(EGTBTest, IndexIsSymmetric) {
+  const egtb::TableIndexer indexer(
+      egtb::CanonicalKey(Key("8/R7/8/8/8/8/8/7k w - -")));
+  const uint64_t index =
+      indexer.Index(Board(Variant::ANTICHESS, "8/R7/8/8/8/8/8/7k w - -"));
+  // Reflected and rotated.
+  EXPECT_EQ(index, indexer.Index(
+                       Board(Variant::ANTICHESS, "8/7R/8/8/8/8/8/k7 w - -")));
+  EXPECT_EQ(index, indexer.Index(
+                       Board(Variant::ANTICHESS, "k7/8/8/8/8/8/7R/8 w - -")));
+  EXPECT_EQ(index, indexer.Index(
+                       Board(Variant::ANTICHESS, "k7/8/8/8/8/8/8/6R1 w - -")));
+  // Colours swapped.
+  EXPECT_EQ(index, indexer.Index(
+                       Board(Variant::ANTICHESS, "7K/8/8/8/8/8/r7/8 b - -")));
+  EXPECT_NE(index, indexer.Index(
+                       Board(Variant::ANTICHESS, "8/R7/8/8/8/8/8/7k b - -")));
+
+  // With pawns, only the left-right reflection.
+  const egtb::TableIndexer pawn_indexer(
+      egtb::CanonicalKey(Key("8/8/8/8/8/8/P7/7k w - -")));
+  const uint64_t pawn_index =
+      pawn_indexer.Index(Board(Variant::ANTICHESS, "8/8/8/8/8/8/P7/7k w - -"));
+  EXPECT_EQ(pawn_index, pawn_indexer.Index(Board(Variant::ANTICHESS,
+                                                 "8/8/8/8/8/8/7P/k7 w - -")));
+  EXPECT_NE(pawn_index, pawn_indexer.Index(Board(Variant::ANTICHESS,
+                                                 "7k/P7/8/8/8/8/8/8 w - -")));
+}
+
+// Every entry must follow from the entries of the positions after its moves.
+TEST(EGTBTest, GeneratedEntriesMatchMoves) {
+  egtb::Tables tables;
+  std::list<std::vector<egtb::Entry>> storage;
+  egtb::Generator generator(2, &tables, &storage);
+  for (const egtb::MaterialKey key : egtb::GenerationOrder(2)) {
+    generator.Generate(key);
+  }
+  for (const auto& [key, table] : tables) {
+    BoardDesc board_desc;
+    for (uint64_t index = 0; index < table.indexer.Size(); ++index) {
+      if (!table.indexer.Position(index, &board_desc)) {
+        continue;
+      }
+      Board board(Variant::ANTICHESS, board_desc);
+      const egtb::Entry entry = table.entries[index];
+      const int plies = egtb::EntryPliesToEnd(entry);
+      const int result = EvalResult<Variant::ANTICHESS>(board);
+      if (result != UNKNOWN) {
+        EXPECT_EQ(0, plies);
+        continue;
+      }
+      const MoveArray move_array = GenerateMoves<Variant::ANTICHESS>(board);
+      int best_win = INT_MAX;
+      int worst_loss = 0;
+      bool all_won = true;
+      for (size_t i = 0; i < move_array.size(); ++i) {
+        board.MakeMove(move_array.get(i));
+        const egtb::Entry child = egtb::Probe(tables, board);
+        board.UnmakeLastMove();
+        if (egtb::EntryResult(child) == egtb::Result::LOST) {
+          best_win = std::min(best_win, egtb::EntryPliesToEnd(child) + 1);
+        }
+        if (egtb::EntryResult(child) == egtb::Result::WON) {
+          worst_loss = std::max(worst_loss, egtb::EntryPliesToEnd(child) + 1);
+        } else {
+          all_won = false;
+        }
+      }
+      const std::string fen = board.ParseIntoFEN();
+      if (best_win != INT_MAX) {
+        EXPECT_EQ(egtb::MakeEntry(egtb::Result::WON, best_win), entry) << fen;
+      } else if (all_won) {
+        EXPECT_EQ(egtb::MakeEntry(egtb::Result::LOST, worst_loss), entry)
+            << fen;
+      } else {
+        EXPECT_EQ(egtb::MakeEntry(egtb::Result::DRAWN, 0), entry) << fen;
+      }
+    }
+  }
+}
+
+TEST(EGTBTest, GeneratesTablesInMemory) {
+  EGTB egtb;
+  egtb.Initialize();
+  EXPECT_EQ(2, egtb.MaxPieces());
+  Board board(Variant::ANTICHESS, "8/R7/8/8/8/8/8/7k w - -");
+  std::optional<EGTBIndexEntry> entry = egtb.LookupWithMove(board);
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(WIN, EGTBResult(*entry));
+  EXPECT_TRUE(entry->next_move.is_valid());
+
+  board = Board(Variant::ANTICHESS, "8/R7/8/8/8/8/8/6k1 b - -");
+  entry = egtb.Lookup(board);
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(-WIN, EGTBResult(*entry));
+
+  board = Board(Variant::ANTICHESS, "8/8/8/8/8/8/8/Bb6 w - -");
+  entry = egtb.Lookup(board);
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(DRAW, EGTBResult(*entry));
+
+  // Three pieces are not in the tables.
+  board = Board(Variant::ANTICHESS, "8/R7/8/8/8/8/P7/7k w - -");
+  EXPECT_FALSE(egtb.Lookup(board).has_value());
+}
+
+TEST(EGTBTest, ProbeWDL) {
+  EGTB egtb;
+  egtb.Initialize();
+  EXPECT_EQ(WIN, egtb.ProbeWDL(
+                     Board(Variant::ANTICHESS, "8/R7/8/8/8/8/8/7k w - -")));
+  EXPECT_EQ(-WIN, egtb.ProbeWDL(
+                      Board(Variant::ANTICHESS, "8/R7/8/8/8/8/8/6k1 b - -")));
+  EXPECT_EQ(DRAW, egtb.ProbeWDL(
+                      Board(Variant::ANTICHESS, "8/8/8/8/8/8/8/Bb6 w - -")));
+  EXPECT_EQ(UNKNOWN, egtb.ProbeWDL(Board(Variant::ANTICHESS,
+                                         "8/R7/8/8/8/8/P7/7k w - -")));
+  // Left to search, as the en passant capture is compulsory.
+  EXPECT_EQ(UNKNOWN, egtb.ProbeWDL(Board(Variant::ANTICHESS,
+                                         "8/8/8/Pp6/8/8/8/8 w - b6")));
+
+  // The material signature follows moves into other tables.
+  Board board(Variant::ANTICHESS, "8/8/8/8/8/8/1p6/R7 b - -");
+  for (const std::string move : {"b2a1n", "b2b1q"}) {
+    board.MakeMove(Move(move));
+    const std::optional<EGTBIndexEntry> entry = egtb.Lookup(board);
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(EGTBResult(*entry), egtb.ProbeWDL(board)) << move;
+    board.UnmakeLastMove();
+  }
+}
+
+TEST(EGTBTest, LoadsWrittenFile) {
+  const std::string path = testing::TempDir() + "egtb_test.egtb";
+  WriteEGTBFile(path, 2, 2);
+
+  EGTB egtb;
+  egtb.Initialize(path);
+  EXPECT_EQ(2, egtb.MaxPieces());
+  // The pawn has to capture en passant, after which black has no pieces left.
+  Board board(Variant::ANTICHESS, "8/8/8/Pp6/8/8/8/8 w - b6");
+  std::optional<EGTBIndexEntry> entry = egtb.LookupWithMove(board);
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(-WIN, EGTBResult(*entry));
+  EXPECT_EQ(Move("a5b6"), entry->next_move);
+
+  // The move keeps the win, one ply closer to the end.
+  board = Board(Variant::ANTICHESS, "8/R7/8/8/8/8/8/7k w - -");
+  entry = egtb.LookupWithMove(board);
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(WIN, EGTBResult(*entry));
+  board.MakeMove(entry->next_move);
+  const std::optional<EGTBIndexEntry> child = egtb.LookupWithMove(board);
+  ASSERT_TRUE(child.has_value());
+  EXPECT_EQ(-WIN, EGTBResult(*child));
+  EXPECT_EQ(entry->moves_to_end - 1, child->moves_to_end);
+  std::remove(path.c_str());
+}
+
+// The compressed tables must decompress to the generated entries.
+TEST(EGTBTest, CompressedEntriesMatchGenerated) {
+  egtb::Tables tables;
+  std::list<std::vector<egtb::Entry>> storage;
+  egtb::Generator generator(2, &tables, &storage);
+  for (const egtb::MaterialKey key : egtb::GenerationOrder(2)) {
+    generator.Generate(key);
+  }
+  EGTB egtb;
+  egtb.Initialize();
+  for (const auto& [key, table] : tables) {
+    BoardDesc board_desc;
+    for (uint64_t index = 0; index < table.indexer.Size(); ++index) {
+      if (!table.indexer.Position(index, &board_desc)) {
+        continue;
+      }
+      Board board(Variant::ANTICHESS, board_desc);
+      const std::optional<EGTBIndexEntry> entry = egtb.LookupWithMove(board);
+      ASSERT_TRUE(entry.has_value());
+      const egtb::Result result = egtb::EntryResult(table.entries[index]);
+      EXPECT_EQ(result == egtb::Result::WON    ? 1
+                : result == egtb::Result::LOST ? -1
+                                               : 0,
+                entry->result);
+      EXPECT_EQ(egtb::EntryPliesToEnd(table.entries[index]),
+                entry->moves_to_end);
+    }
+  }
+}
+
+TEST(EGTBTest, RejectsCorruptBlockOffsets) {
+  const std::string path = testing::TempDir() + "egtb_test_corrupt.egtb";
+  WriteEGTBFile(path, 2, 2);
+  std::string image;
+  {
+    std::ifstream in(path, std::ios::binary);
+    image.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  // Makes the first result block of the first table empty. The header is 24
+  // bytes, and the result offsets of a table are the third field of its info.
+  uint64_t wdl_offsets;
+  std::memcpy(&wdl_offsets, image.data() + 24 + 16, sizeof(wdl_offsets));
+  std::memcpy(image.data() + wdl_offsets, image.data() + wdl_offsets + 8,
+              sizeof(uint64_t));
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << image;
+  EGTB egtb;
+  EXPECT_THROW(egtb.Initialize(path), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(EGTBTest, RejectsOtherFiles) {
+  const std::string path = testing::TempDir() + "egtb_test_bad.egtb";
+  std::ofstream(path) << "not an EGTB file, but long enough for a header";
+  EGTB egtb;
+  EXPECT_THROW(egtb.Initialize(path), std::runtime_error);
+  std::remove(path.c_str());
+}
@@ -21,6 +21,69 @@ TEST(EvalStandardTest, EvaluateStalemate) {
   EXPECT_EQ(DRAW, Evaluate<Variant::STANDARD>(board, nullptr, -INF, INF));
 }
 
+TEST(EvalStandardTest, EvaluateStalemateWithPinnedPiece) {
+  // Black's rook is pinned to its king and the king has no squares.
+  Board board(Variant::STANDARD, "5K1k/6r1/8/6N1/8/8/8/B7 b - -");
+  EXPECT_EQ(DRAW, Evaluate<Variant::STANDARD>(board, nullptr, -INF, INF));
+}
+
+TEST(EvalStandardTest, EvaluateWithTransposTable) {
+  Board board(
+      Variant::STANDARD,
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+  const int score = Evaluate<Variant::STANDARD>(board, nullptr, -INF, INF);
+
+  TranspositionTable transpos(1024);
+  SearchStats search_stats;
+  EXPECT_EQ(score, Evaluate<Variant::STANDARD>(board, nullptr, -INF, INF,
+                                               &transpos, &search_stats));
+  EXPECT_GT(search_stats.qnodes_searched, 1);
+  const std::optional<TTData> tdata = transpos.Get(board.ZobristKey());
+  ASSERT_TRUE(tdata);
+  EXPECT_EQ(0, tdata->depth);
+  EXPECT_EQ(NodeType::EXACT_NODE, tdata->node_type());
+  EXPECT_EQ(score, tdata->score);
+
+  // Second evaluation is answered by the stored entry.
+  search_stats = SearchStats();
+  EXPECT_EQ(score, Evaluate<Variant::STANDARD>(board, nullptr, -INF, INF,
+                                               &transpos, &search_stats));
+  EXPECT_EQ(1, search_stats.qnodes_searched);
+}
+
+// Walks all moves to given depth checking that the evaluation using the
+// board's incremental piece-square scores matches the one computed from
+// scratch.
+void CheckIncrementalStaticEval(Board& board, int depth) {
+  static const StdEvalParams<int> params = BlessedParams();
+  ASSERT_EQ(standard::StaticEval(params, board), StaticEval(board))
+      << board.ParseIntoFEN();
+  if (depth == 0) {
+    return;
+  }
+  const MoveArray move_array = GenerateMoves<Variant::STANDARD>(board);
+  for (size_t i = 0; i < move_array.size(); ++i) {
+    board.MakeMove(move_array.get(i));
+    CheckIncrementalStaticEval(board, depth - 1);
+    board.UnmakeLastMove();
+  }
+  board.MakeNullMove();
+  ASSERT_EQ(standard::StaticEval(params, board), StaticEval(board));
+  board.UnmakeNullMove();
+}
+
+TEST(EvalStandardTest, IncrementalStaticEval) {
+  const std::string fens[] = {
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq -",
+      "rnbqkbnr/pp1ppppp/8/2pP4/8/8/PPP1PPPP/RNBQKBNR w KQkq c6",
+  };
+  for (const std::string& fen : fens) {
+    Board board(Variant::STANDARD, fen);
+    CheckIncrementalStaticEval(board, 2);
+  }
+}
+
 TEST(EvalAntichessTest, Evaluate) {
   Board board(Variant::ANTICHESS, "8/8/8/5p2/5P2/8/8/8 w - -");
   EXPECT_EQ(WIN, Evaluate<Variant::ANTICHESS>(board, nullptr, -INF, INF));
@@ -67,3 +67,13 @@ TEST(ExecutorTest, VerifyResultBlackWins_Standard) {
   EXPECT_EQ(1, response.size());
   EXPECT_EQ("0-1 {Black Wins}", response.at(0));
 }
+
+TEST(ExecutorTest, MateInOneWithMultipleThreads_Standard) {
+  const string fen = "6k1/5ppp/8/8/8/8/8/R5K1 w - -";
+  Executor executor("nakshatra-test", fen, Variant::STANDARD);
+  executor.Execute("cores 4");
+  executor.Execute("sd 4");
+  auto response = executor.Execute("go");
+  EXPECT_EQ(1, response.size());
+  EXPECT_EQ("move a1a8", response.at(0));
+}
@@ -0,0 +1,59 @@
+#include "lru_cache.h"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(LRUCacheTest, GetsPutValues) {
+  LRUCache<int, std::string> cache(4, 1);
+  EXPECT_EQ(nullptr, cache.Get(1));
+  cache.Put(1, std::make_shared<std::string>("one"));
+  cache.Put(2, std::make_shared<std::string>("two"));
+  ASSERT_NE(nullptr, cache.Get(1));
+  EXPECT_EQ("one", *cache.Get(1));
+  EXPECT_EQ("two", *cache.Get(2));
+
+  cache.Put(1, std::make_shared<std::string>("uno"));
+  EXPECT_EQ("uno", *cache.Get(1));
+}
+
+TEST(LRUCacheTest, EvictsLeastRecentlyUsed) {
+  LRUCache<int, int> cache(2, 1);
+  cache.Put(1, std::make_shared<int>(1));
+  cache.Put(2, std::make_shared<int>(2));
+  // 1 is now used more recently than 2.
+  std::shared_ptr<const int> one = cache.Get(1);
+  cache.Put(3, std::make_shared<int>(3));
+  EXPECT_NE(nullptr, cache.Get(1));
+  EXPECT_EQ(nullptr, cache.Get(2));
+  EXPECT_NE(nullptr, cache.Get(3));
+
+  // Evicted values stay valid while in use.
+  cache.Put(4, std::make_shared<int>(4));
+  cache.Put(5, std::make_shared<int>(5));
+  EXPECT_EQ(nullptr, cache.Get(1));
+  EXPECT_EQ(1, *one);
+}
+
+TEST(LRUCacheTest, ConcurrentUse) {
+  LRUCache<int, int> cache(64);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache, t] {
+      for (int i = 0; i < 10000; ++i) {
+        const int key = (i * 7 + t) % 100;
+        std::shared_ptr<const int> value = cache.Get(key);
+        if (value) {
+          EXPECT_EQ(key, *value);
+        } else {
+          cache.Put(key, std::make_shared<int>(key));
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
@@ -6,6 +6,9 @@
 #include "movegen.h"
 
 #include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <vector>
 
 TEST(StandardMoveOrderer, Order) {
   Board board(Variant::STANDARD, "2k5/8/3r2n1/2P5/8/6Q1/2B5/1K6 w - -");
@@ -24,3 +27,35 @@ TEST(StandardMoveOrderer, Order) {
   // Losing capture will be at the end.
   EXPECT_EQ("g3g6", move_info_array.moves[move_info_array.size - 1].move.str());
 }
+
+TEST(StandardMovePicker, Order) {
+  Board board(Variant::STANDARD, "2k5/8/3r2n1/2P5/8/6Q1/2B5/1K6 w - -");
+  const MoveArray move_array = GenerateMoves<Variant::STANDARD>(board);
+  PrefMoves pref_moves;
+  pref_moves.tt_move = Move("b1a1");
+  pref_moves.killer1 = Move("c2b3");
+  // Illegal in this position, must be skipped.
+  pref_moves.killer2 = Move("c2c4");
+  MovePicker<Variant::STANDARD> move_picker(board, pref_moves);
+
+  std::vector<MoveInfo> picked;
+  for (MoveInfo move_info; move_picker.Next(move_info);) {
+    picked.push_back(move_info);
+  }
+  ASSERT_EQ(move_array.size(), picked.size());
+  for (const MoveInfo& move_info : picked) {
+    EXPECT_TRUE(move_array.Contains(move_info.move));
+  }
+  EXPECT_EQ("b1a1", picked[0].move.str());
+  EXPECT_EQ(MoveType::TT, picked[0].type);
+  // Gaining captures come next. The two captures of the rook gain the same.
+  const std::set<std::string> rook_captures = {picked[1].move.str(),
+                                               picked[2].move.str()};
+  EXPECT_EQ((std::set<std::string>{"g3d6", "c5d6"}), rook_captures);
+  EXPECT_EQ("c2g6", picked[3].move.str());
+  EXPECT_EQ("c2b3", picked[4].move.str());
+  EXPECT_EQ(MoveType::KILLER, picked[4].type);
+  // Losing capture will be at the end.
+  EXPECT_EQ("g3g6", picked.back().move.str());
+  EXPECT_EQ(MoveType::SEE_BAD_CAPTURE, picked.back().type);
+}
@@ -400,6 +400,128 @@ TEST_F(MoveGeneratorTest, CountMoves) {
   EXPECT_EQ(1761505, CountLeafMoves<variant>(&board, 4));
 }
 
+TEST_F(MoveGeneratorTest, CountMovesWithPinsAndChecks) {
+  constexpr Variant variant = Variant::STANDARD;
+  // Positions rich in pins, discovered checks, en passant and castling.
+  Board kiwipete(
+      variant,
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+  EXPECT_EQ(48, CountLeafMoves<variant>(&kiwipete, 1));
+  EXPECT_EQ(2039, CountLeafMoves<variant>(&kiwipete, 2));
+  EXPECT_EQ(97862, CountLeafMoves<variant>(&kiwipete, 3));
+
+  Board rook_endgame(variant, "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -");
+  EXPECT_EQ(14, CountLeafMoves<variant>(&rook_endgame, 1));
+  EXPECT_EQ(191, CountLeafMoves<variant>(&rook_endgame, 2));
+  EXPECT_EQ(2812, CountLeafMoves<variant>(&rook_endgame, 3));
+  EXPECT_EQ(43238, CountLeafMoves<variant>(&rook_endgame, 4));
+
+  Board promotions(
+      variant,
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq -");
+  EXPECT_EQ(6, CountLeafMoves<variant>(&promotions, 1));
+  EXPECT_EQ(264, CountLeafMoves<variant>(&promotions, 2));
+  EXPECT_EQ(9467, CountLeafMoves<variant>(&promotions, 3));
+}
+
+TEST_F(MoveGeneratorTest, GenerateCaptures) {
+  constexpr Variant variant = Variant::STANDARD;
+  const string fens[] = {
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+      // En passant capture and a capture by a pinned piece.
+      "4k3/8/8/2KPp2r/8/8/8/8 w - e6",
+      // Capturing and non-capturing promotions.
+      "1n2k3/P7/8/8/8/8/8/4K3 w - -",
+  };
+  for (const string& fen : fens) {
+    Board board(variant, fen);
+    const MoveArray captures = GenerateCaptures<variant>(board);
+    const MoveArray moves = GenerateMoves<variant>(board);
+    size_t num_captures = 0;
+    for (size_t i = 0; i < moves.size(); ++i) {
+      const Move move = moves.get(i);
+      const bool is_capture =
+          board.PieceAt(move.to_index()) != NULLPIECE ||
+          (PieceType(board.PieceAt(move.from_index())) == PAWN &&
+           move.to_index() == board.EnpassantTarget());
+      EXPECT_EQ(is_capture, captures.Contains(move))
+          << fen << " " << move.str();
+      num_captures += is_capture;
+    }
+    EXPECT_EQ(num_captures, captures.size()) << fen;
+  }
+  Board board(variant, fens[0]);
+  EXPECT_EQ(8, GenerateCaptures<variant>(board).size());
+}
+
+TEST_F(MoveGeneratorTest, GenerateQuiets) {
+  constexpr Variant variant = Variant::STANDARD;
+  const string fens[] = {
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+      "4k3/8/8/2KPp2r/8/8/8/8 w - e6",
+      "1n2k3/P7/8/8/8/8/8/4K3 w - -",
+      // In check.
+      "rnb1kbnr/pppp1p1p/6p1/4P3/1q2P3/8/PPPK1PPP/RNBQ1BNR w KQkq -",
+  };
+  // Quiet moves are exactly the moves that are not captures.
+  for (const string& fen : fens) {
+    Board board(variant, fen);
+    const MoveArray captures = GenerateCaptures<variant>(board);
+    const MoveArray quiets = GenerateQuiets<variant>(board);
+    const MoveArray moves = GenerateMoves<variant>(board);
+    EXPECT_EQ(moves.size(), captures.size() + quiets.size()) << fen;
+    for (size_t i = 0; i < moves.size(); ++i) {
+      const Move move = moves.get(i);
+      EXPECT_NE(captures.Contains(move), quiets.Contains(move))
+          << fen << " " << move.str();
+    }
+  }
+}
+
+TEST_F(MoveGeneratorTest, GenerateEvasions) {
+  constexpr Variant variant = Variant::STANDARD;
+  Board board(variant,
+              "rnb1kbnr/pppp1p1p/6p1/4P3/1q2P3/8/PPPK1PPP/RNBQ1BNR w KQkq -");
+  const MoveArray evasions = GenerateEvasions<variant>(board);
+  const MoveArray moves = GenerateMoves<variant>(board);
+  EXPECT_EQ(moves.size(), evasions.size());
+  for (size_t i = 0; i < moves.size(); ++i) {
+    EXPECT_TRUE(evasions.Contains(moves.get(i)));
+  }
+}
+
+TEST_F(MoveGeneratorTest, IsLegalMove) {
+  constexpr Variant variant = Variant::STANDARD;
+  // King may not step next to the opponent king; knight on d2 is pinned.
+  Board board(variant, "3r4/8/8/8/8/2k5/3N4/3K4 w - -");
+  EXPECT_FALSE(IsLegalMove<variant>(board, Move("d1c2")));
+  EXPECT_FALSE(IsLegalMove<variant>(board, Move("d2b3")));
+  EXPECT_TRUE(IsLegalMove<variant>(board, Move("d1e2")));
+  EXPECT_FALSE(IsLegalMove<variant>(board, Move("d1d3")));
+
+  // Captures are compulsory in antichess.
+  Board antichess_board(Variant::ANTICHESS, "8/8/8/5p2/4P3/8/8/8 w - -");
+  EXPECT_TRUE(IsLegalMove<Variant::ANTICHESS>(antichess_board, Move("e4f5")));
+  EXPECT_FALSE(IsLegalMove<Variant::ANTICHESS>(antichess_board, Move("e4e5")));
+}
+
+TEST_F(MoveGeneratorTest, IsCapture) {
+  constexpr Variant variant = Variant::STANDARD;
+  Board board(variant,
+              "rnbqkbnr/pppp1ppp/8/8/3Pp3/5N2/PPP1PPPP/RNBQKB1R b KQkq d3");
+  EXPECT_TRUE(IsCapture(board, Move("e4d3")));
+  EXPECT_TRUE(IsCapture(board, Move("e4f3")));
+  EXPECT_FALSE(IsCapture(board, Move("e4e3")));
+  const MoveArray captures = GenerateCaptures<variant>(board);
+  for (size_t i = 0; i < captures.size(); ++i) {
+    EXPECT_TRUE(IsCapture(board, captures.get(i)));
+  }
+  const MoveArray quiets = GenerateQuiets<variant>(board);
+  for (size_t i = 0; i < quiets.size(); ++i) {
+    EXPECT_FALSE(IsCapture(board, quiets.get(i)));
+  }
+}
+
 // U64 P(U64 bb) {
 //   for (int i = 7; i >= 0; --i) {
 //     for (int j = 0; j < 8; ++j) {
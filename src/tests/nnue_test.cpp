@@ -0,0 +1,194 @@
+#include "board.h"
+#include "common.h"
+#include "eval.h"
+#include "move_array.h"
+#include "movegen.h"
+#include "nnue.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const std::vector<std::string> kFENs = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -",
+    "r3k2r/pPppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPpP/R3K2R w KQkq -",
+    "rnbqkbnr/pppp1ppp/8/8/3Pp3/8/PPP1PPPP/RNBQKBNR b Kq d3",
+    "8/5pk1/6p1/3P4/1P3P2/P5PP/6K1/8 w - -"};
+
+std::unique_ptr<nnue::Network> RandomNetwork() {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> weight(-64, 64);
+  auto network = std::make_unique<nnue::Network>();
+  for (auto& feature_weights : network->feature_weights) {
+    for (int16_t& w : feature_weights) {
+      w = weight(rng);
+    }
+  }
+  for (int16_t& b : network->feature_biases) {
+    b = weight(rng) + 64;
+  }
+  for (auto& output_weights : network->output_weights) {
+    for (int16_t& w : output_weights) {
+      w = weight(rng);
+    }
+  }
+  network->output_bias = 100 * weight(rng);
+  return network;
+}
+
+// Activates a random network for the boards constructed during a test.
+class NNUETest : public testing::Test {
+protected:
+  void SetUp() override {
+    network_ = RandomNetwork();
+    nnue::SetActiveNetwork(network_.get());
+  }
+
+  void TearDown() override { nnue::SetActiveNetwork(nullptr); }
+
+  std::unique_ptr<nnue::Network> network_;
+};
+
+bool SameAccumulator(const nnue::Accumulator& a, const nnue::Accumulator& b) {
+  return std::memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Evaluation computed directly from the pieces on board.
+int ReferenceEvaluate(const nnue::Network& network, const Board& board) {
+  int32_t hidden[2][nnue::kHiddenSize];
+  for (int side = 0; side < 2; ++side) {
+    std::copy(std::begin(network.feature_biases),
+              std::end(network.feature_biases), hidden[side]);
+  }
+  for (int sq = 0; sq < BOARD_SIZE; ++sq) {
+    const Piece piece = board.PieceAt(sq);
+    if (piece == NULLPIECE) {
+      continue;
+    }
+    const int white_feature = PieceIndex(piece) * 64 + sq;
+    const int black_feature = PieceIndex(-piece) * 64 + (sq ^ 56);
+    for (int i = 0; i < nnue::kHiddenSize; ++i) {
+      hidden[0][i] += network.feature_weights[white_feature][i];
+      hidden[1][i] += network.feature_weights[black_feature][i];
+    }
+  }
+  const int us = board.SideToMove() == Side::WHITE ? 0 : 1;
+  int64_t sum = network.output_bias;
+  for (int i = 0; i < nnue::kHiddenSize; ++i) {
+    sum += std::clamp(hidden[us][i], 0, nnue::kQA) *
+           network.output_weights[0][i];
+    sum += std::clamp(hidden[us ^ 1][i], 0, nnue::kQA) *
+           network.output_weights[1][i];
+  }
+  return sum * nnue::kScale / (nnue::kQA * nnue::kQB);
+}
+
+} // namespace
+
+TEST_F(NNUETest, IncrementalMatchesRefresh) {
+  std::mt19937 rng(7);
+  for (const std::string& fen : kFENs) {
+    Board board(Variant::STANDARD, fen);
+    ASSERT_EQ(network_.get(), board.Network());
+    const nnue::Accumulator initial = board.NnueAccumulator();
+    int num_moves = 0;
+    for (; num_moves < 60; ++num_moves) {
+      const MoveArray move_array = GenerateMoves<Variant::STANDARD>(board);
+      if (move_array.size() == 0) {
+        break;
+      }
+      board.MakeMove(move_array.get(rng() % move_array.size()));
+      if (num_moves % 7 == 3) {
+        board.MakeNullMove();
+        board.UnmakeNullMove();
+      }
+      const Board refreshed(Variant::STANDARD, board.ParseIntoFEN());
+      ASSERT_TRUE(SameAccumulator(refreshed.NnueAccumulator(),
+                                  board.NnueAccumulator()))
+          << board.ParseIntoFEN();
+    }
+    for (; num_moves > 0; --num_moves) {
+      board.UnmakeLastMove();
+    }
+    EXPECT_TRUE(SameAccumulator(initial, board.NnueAccumulator()));
+  }
+}
+
+TEST_F(NNUETest, CopiesKeepAccumulators) {
+  Board board(Variant::STANDARD, kFENs[1]);
+  const nnue::Accumulator initial = board.NnueAccumulator();
+  const MoveArray move_array = GenerateMoves<Variant::STANDARD>(board);
+  board.MakeMove(move_array.get(0));
+  Board copy = board;
+  EXPECT_TRUE(SameAccumulator(board.NnueAccumulator(), copy.NnueAccumulator()));
+  copy.UnmakeLastMove();
+  EXPECT_TRUE(SameAccumulator(initial, copy.NnueAccumulator()));
+
+  // Boards without a network drop the accumulators of the board assigned to.
+  copy = Board(Variant::ANTICHESS);
+  EXPECT_EQ(nullptr, copy.Network());
+  copy = board;
+  EXPECT_TRUE(SameAccumulator(board.NnueAccumulator(), copy.NnueAccumulator()));
+}
+
+TEST_F(NNUETest, MovedFromBoardsHaveNoNetwork) {
+  Board board(Variant::STANDARD, kFENs[1]);
+  const nnue::Accumulator accumulator = board.NnueAccumulator();
+  Board moved = std::move(board);
+  EXPECT_TRUE(SameAccumulator(accumulator, moved.NnueAccumulator()));
+  // The moved-from board can still be used, without its network.
+  EXPECT_EQ(nullptr, board.Network());
+  board.MakeMove(GenerateMoves<Variant::STANDARD>(board).get(0));
+  board.UnmakeLastMove();
+
+  board = std::move(moved);
+  EXPECT_EQ(network_.get(), board.Network());
+  EXPECT_TRUE(SameAccumulator(accumulator, board.NnueAccumulator()));
+  EXPECT_EQ(nullptr, moved.Network());
+}
+
+TEST_F(NNUETest, EvaluateMatchesReference) {
+  for (const std::string& fen : kFENs) {
+    Board board(Variant::STANDARD, fen);
+    const int score = nnue::Evaluate(*network_, board.NnueAccumulator(),
+                                     board.SideToMove());
+    EXPECT_EQ(ReferenceEvaluate(*network_, board), score) << fen;
+    EXPECT_EQ(score, StaticEval(board)) << fen;
+  }
+}
+
+TEST_F(NNUETest, ColorFlippedPositionsEvaluateSame) {
+  Board board(Variant::STANDARD, "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/"
+                                 "PPPP1PPP/RNBQK2R w KQkq -");
+  Board flipped(Variant::STANDARD, "rnbqk2r/pppp1ppp/5n2/2b1p3/4P3/2N2N2/"
+                                   "PPPP1PPP/R1BQKB1R b KQkq -");
+  EXPECT_EQ(StaticEval(board), StaticEval(flipped));
+}
+
+TEST_F(NNUETest, OnlyStandardBoardsUseNetwork) {
+  EXPECT_EQ(nullptr, Board(Variant::ANTICHESS).Network());
+  nnue::SetActiveNetwork(nullptr);
+  EXPECT_EQ(nullptr, Board(Variant::STANDARD).Network());
+}
+
+TEST_F(NNUETest, SaveLoadRoundTrip) {
+  const std::string path = testing::TempDir() + "nnue_test.nnue";
+  nnue::SaveNetwork(*network_, path);
+  const std::unique_ptr<nnue::Network> loaded = nnue::LoadNetwork(path);
+  EXPECT_EQ(0, std::memcmp(network_.get(), loaded.get(), sizeof(*loaded)));
+
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a network";
+  EXPECT_THROW(nnue::LoadNetwork(path), std::runtime_error);
+  std::remove(path.c_str());
+  EXPECT_THROW(nnue::LoadNetwork(path), std::runtime_error);
+}
@@ -0,0 +1,117 @@
+#include "board.h"
+#include "common.h"
+#include "pn_search.h"
+#include "search_threads.h"
+#include "transpos.h"
+
+#include <gtest/gtest.h>
+#include <string>
+
+namespace {
+
+PNSResult Search(const std::string& fen, PNSParams::PNSearchType pns_type,
+                 int max_nodes, PNSParams::NodeStore node_store) {
+  Board board(Variant::ANTICHESS, fen);
+  PNSParams pns_params;
+  pns_params.pns_type = pns_type;
+  pns_params.max_nodes = max_nodes;
+  pns_params.node_store = node_store;
+  pns_params.quiet = true;
+  return PNSearch<Variant::ANTICHESS>(board, nullptr, nullptr, nullptr)
+      .Search(pns_params);
+}
+
+} // namespace
+
+TEST(PNSearchTest, SolvesWin) {
+  // This position can be won by white at depth 7.
+  const std::string fen = "8/R7/8/8/8/8/8/7k w - -";
+  for (const auto node_store :
+       {PNSParams::POINTER_NODES, PNSParams::COMPACT_NODES}) {
+    const PNSResult pns_result =
+        Search(fen, PNSParams::PN1, 100000, node_store);
+    EXPECT_EQ(0, pns_result.proof);
+    ASSERT_FALSE(pns_result.ordered_moves.empty());
+    EXPECT_EQ(WIN, pns_result.ordered_moves[0].result);
+  }
+}
+
+TEST(PNSearchTest, DfpnSolvesWin) {
+  Board board(Variant::ANTICHESS, "8/R7/8/8/8/8/8/7k w - -");
+  PNSParams pns_params;
+  pns_params.pns_type = PNSParams::DFPN;
+  pns_params.dfpn_table_mb = 1;
+  pns_params.quiet = true;
+  const PNSResult pns_result =
+      PNSearch<Variant::ANTICHESS>(board, nullptr, nullptr, nullptr)
+          .Search(pns_params);
+  EXPECT_EQ(0, pns_result.proof);
+  EXPECT_EQ(INF_NODES, pns_result.disproof);
+  ASSERT_FALSE(pns_result.ordered_moves.empty());
+  EXPECT_EQ(WIN, pns_result.ordered_moves[0].result);
+  // The search leaves the board as it was.
+  EXPECT_EQ("8/R7/8/8/8/8/8/7k w - -", board.ParseIntoFEN());
+
+  // Black loses whatever it plays.
+  board = Board(Variant::ANTICHESS, "8/R7/8/8/8/8/8/6k1 b - -");
+  const PNSResult black_result =
+      PNSearch<Variant::ANTICHESS>(board, nullptr, nullptr, nullptr)
+          .Search(pns_params);
+  EXPECT_EQ(INF_NODES, black_result.proof);
+  EXPECT_EQ(0, black_result.disproof);
+}
+
+TEST(PNSearchTest, NodeStoresAgree) {
+  const std::string fen =
+      "rnbqkbnr/p1pppppp/1p6/8/8/4P3/PPPP1PPP/RNBQKBNR w - -";
+  for (const auto& [pns_type, max_nodes] :
+       {std::pair{PNSParams::PN1, 20000}, std::pair{PNSParams::PN2, 500}}) {
+    const PNSResult pointer_result =
+        Search(fen, pns_type, max_nodes, PNSParams::POINTER_NODES);
+    const PNSResult compact_result =
+        Search(fen, pns_type, max_nodes, PNSParams::COMPACT_NODES);
+    EXPECT_EQ(pointer_result.tree_size, compact_result.tree_size);
+    EXPECT_EQ(pointer_result.proof, compact_result.proof);
+    EXPECT_EQ(pointer_result.disproof, compact_result.disproof);
+    ASSERT_EQ(pointer_result.ordered_moves.size(),
+              compact_result.ordered_moves.size());
+    for (size_t i = 0; i < pointer_result.ordered_moves.size(); ++i) {
+      const auto& pointer_stat = pointer_result.ordered_moves[i];
+      const auto& compact_stat = compact_result.ordered_moves[i];
+      EXPECT_EQ(pointer_stat.move, compact_stat.move);
+      EXPECT_EQ(pointer_stat.tree_size, compact_stat.tree_size);
+      EXPECT_EQ(pointer_stat.result, compact_stat.result);
+    }
+  }
+}
+
+TEST(PNSearchTest, ParallelSearchSolves) {
+  SearchThreads search_threads(4);
+  TranspositionTable transpos(TranspositionTable::SizeForMemory(16));
+  for (const auto pns_type : {PNSParams::PN1, PNSParams::DFPN}) {
+    PNSParams pns_params;
+    pns_params.pns_type = pns_type;
+    pns_params.dfpn_table_mb = 1;
+    pns_params.quiet = true;
+    pns_params.search_threads = &search_threads;
+
+    Board board(Variant::ANTICHESS, "8/R7/8/8/8/8/8/7k w - -");
+    const PNSResult pns_result =
+        PNSearch<Variant::ANTICHESS>(board, &transpos, nullptr, nullptr)
+            .Search(pns_params);
+    EXPECT_EQ(0, pns_result.proof);
+    ASSERT_FALSE(pns_result.ordered_moves.empty());
+    EXPECT_EQ(WIN, pns_result.ordered_moves[0].result);
+    EXPECT_EQ("8/R7/8/8/8/8/8/7k w - -", board.ParseIntoFEN());
+
+    board = Board(Variant::ANTICHESS, "8/R7/8/8/8/8/8/6k1 b - -");
+    pns_params.max_nodes = 1000000;
+    const PNSResult black_result =
+        PNSearch<Variant::ANTICHESS>(board, &transpos, nullptr, nullptr)
+            .Search(pns_params);
+    EXPECT_EQ(0, black_result.disproof);
+    for (const auto& move_stat : black_result.ordered_moves) {
+      EXPECT_EQ(-WIN, move_stat.result);
+    }
+  }
+}
@@ -0,0 +1,91 @@
+#include "board.h"
+#include "common.h"
+#include "movegen.h"
+#include "pn_search.h"
+#include "proof_cache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+std::string CachePath(const std::string& name) {
+  const std::string path = testing::TempDir() + name;
+  std::remove(path.c_str());
+  return path;
+}
+
+} // namespace
+
+TEST(ProofCacheTest, KeepsResultsAcrossOpens) {
+  const std::string path = CachePath("proof_cache_test_keeps_results");
+  {
+    ProofCache cache(path, Variant::ANTICHESS);
+    EXPECT_EQ(0, cache.Size());
+    cache.Put({{0x1234ULL, WIN}, {0x5678ULL, -WIN}, {0x1234ULL, WIN}});
+    // Appended again, as the cache only knows the records it mapped.
+    cache.Put({{0x1234ULL, WIN}});
+    // Results put are only seen once the file is opened again.
+    EXPECT_EQ(UNKNOWN, cache.Get(0x1234ULL));
+  }
+  ProofCache cache(path, Variant::ANTICHESS);
+  EXPECT_EQ(3, cache.Size());
+  EXPECT_EQ(WIN, cache.Get(0x1234ULL));
+  EXPECT_EQ(-WIN, cache.Get(0x5678ULL));
+  EXPECT_EQ(UNKNOWN, cache.Get(0x9abcULL));
+
+  // The file belongs to antichess.
+  EXPECT_THROW(ProofCache(path, Variant::SUICIDE), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(ProofCacheTest, DropsPartialRecord) {
+  const std::string path = CachePath("proof_cache_test_partial_record");
+  {
+    ProofCache cache(path, Variant::ANTICHESS);
+    cache.Put({{0x1234ULL, WIN}});
+  }
+  // A write cut short leaves part of a record at the end of the file.
+  std::ofstream(path, std::ios::binary | std::ios::app) << "partial";
+  {
+    ProofCache cache(path, Variant::ANTICHESS);
+    EXPECT_EQ(1, cache.Size());
+    cache.Put({{0x5678ULL, -WIN}});
+  }
+  ProofCache cache(path, Variant::ANTICHESS);
+  EXPECT_EQ(2, cache.Size());
+  EXPECT_EQ(WIN, cache.Get(0x1234ULL));
+  EXPECT_EQ(-WIN, cache.Get(0x5678ULL));
+  std::remove(path.c_str());
+}
+
+TEST(ProofCacheTest, AnswersSearch) {
+  const std::string path = CachePath("proof_cache_test_answers_search");
+  const std::string fen = "8/R7/8/8/8/8/8/7k w - -";
+  PNSParams pns_params;
+  pns_params.quiet = true;
+  {
+    ProofCache cache(path, Variant::ANTICHESS);
+    Board board(Variant::ANTICHESS, fen);
+    const PNSResult pns_result =
+        PNSearch<Variant::ANTICHESS>(board, nullptr, nullptr, nullptr, &cache)
+            .Search(pns_params);
+    ASSERT_EQ(0, pns_result.proof);
+  }
+  // With the proof from the first run, the root's children are solved as soon
+  // as they are reached.
+  ProofCache cache(path, Variant::ANTICHESS);
+  EXPECT_GT(cache.Size(), 0);
+  Board board(Variant::ANTICHESS, fen);
+  const PNSResult pns_result =
+      PNSearch<Variant::ANTICHESS>(board, nullptr, nullptr, nullptr, &cache)
+          .Search(pns_params);
+  EXPECT_EQ(0, pns_result.proof);
+  EXPECT_EQ(CountMoves<Variant::ANTICHESS>(board), pns_result.tree_size - 1);
+  ASSERT_FALSE(pns_result.ordered_moves.empty());
+  EXPECT_EQ(WIN, pns_result.ordered_moves[0].result);
+  std::remove(path.c_str());
+}
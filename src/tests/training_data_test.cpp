@@ -0,0 +1,100 @@
+#include "board.h"
+#include "common.h"
+#include "training_data.h"
+
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::vector<std::string> kFENs = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -",
+    "rnbqkbnr/pppp1ppp/8/8/3Pp3/8/PPP1PPPP/RNBQKBNR b Kq d3",
+    "8/5pk1/6p1/3P4/1P3P2/P5PP/6K1/8 w - -"};
+
+} // namespace
+
+TEST(TrainingDataTest, PackRoundTrip) {
+  for (const std::string& fen : kFENs) {
+    const Board board(Variant::STANDARD, fen);
+    const PackedPosition position = PackPosition(board, -123, 0.5);
+    EXPECT_EQ(fen, Board(Variant::STANDARD, UnpackPosition(position))
+                       .ParseIntoFEN());
+    EXPECT_EQ(-123, position.score);
+    EXPECT_EQ(0.5, position.Result());
+  }
+}
+
+TEST(TrainingDataTest, WritesAndMapsFile) {
+  const std::string path = testing::TempDir() + "training_data_test.bin";
+  std::remove(path.c_str());
+  {
+    PackedPositionWriter writer(path);
+    writer.Write(PackPosition(Board(Variant::STANDARD, kFENs[0]), 10, 1.0));
+    writer.Flush();
+  }
+  {
+    // Appends to the existing file.
+    PackedPositionWriter writer(path);
+    for (size_t i = 1; i < kFENs.size(); ++i) {
+      writer.Write(PackPosition(Board(Variant::STANDARD, kFENs[i]), 0, 0.0));
+    }
+    writer.Flush();
+  }
+  const PackedPositionFile file(path);
+  ASSERT_EQ(kFENs.size(), file.Size());
+  for (size_t i = 0; i < kFENs.size(); ++i) {
+    EXPECT_EQ(kFENs[i], Board(Variant::STANDARD, UnpackPosition(file[i]))
+                            .ParseIntoFEN());
+  }
+  EXPECT_EQ(10, file[0].score);
+  EXPECT_EQ(1.0, file[0].Result());
+  EXPECT_EQ(0.0, file[1].Result());
+  std::remove(path.c_str());
+}
+
+TEST(TrainingDataTest, RejectsOtherFiles) {
+  const std::string path = testing::TempDir() + "training_data_test_bad.bin";
+  std::ofstream(path) << "not packed positions, but long enough";
+  EXPECT_THROW(PackedPositionFile file(path), std::runtime_error);
+  EXPECT_THROW(PackedPositionWriter writer(path), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(TrainingDataTest, WriterDropsPartialPosition) {
+  const std::string path = testing::TempDir() + "training_data_test_tail.bin";
+  std::remove(path.c_str());
+  {
+    PackedPositionWriter writer(path);
+    writer.Write(PackPosition(Board(Variant::STANDARD, kFENs[0]), 0, 1.0));
+    writer.Flush();
+  }
+  // An interrupted write leaves part of a position at the end of the file.
+  std::ofstream(path, std::ios::binary | std::ios::app) << "partial";
+  {
+    PackedPositionWriter writer(path);
+    writer.Write(PackPosition(Board(Variant::STANDARD, kFENs[1]), 0, 0.0));
+    writer.Flush();
+  }
+  const PackedPositionFile file(path);
+  ASSERT_EQ(2, file.Size());
+  for (size_t i = 0; i < file.Size(); ++i) {
+    EXPECT_EQ(kFENs[i], Board(Variant::STANDARD, UnpackPosition(file[i]))
+                            .ParseIntoFEN());
+  }
+  std::remove(path.c_str());
+}
+
+TEST(TrainingDataTest, UnpackRejectsInvalidPieces) {
+  PackedPosition position =
+      PackPosition(Board(Variant::STANDARD, kFENs[0]), 0, 0.5);
+  position.pieces[3] |= 0xF0;
+  EXPECT_THROW(UnpackPosition(position), std::runtime_error);
+  position = PackPosition(Board(Variant::STANDARD, kFENs[0]), 0, 0.5);
+  position.occupancy = ~0ULL;
+  EXPECT_THROW(UnpackPosition(position), std::runtime_error);
+}
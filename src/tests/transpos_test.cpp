@@ -20,3 +20,33 @@ TEST(TransposTest, VerifyEntries) {
   EXPECT_EQ(10, t.Get(zkey)->depth);
   EXPECT_EQ(m.encoded_move(), t.Get(zkey)->best_move.encoded_move());
 }
+
+TEST(TransposTest, Resize) {
+  EXPECT_EQ(16384, TranspositionTable::SizeForMemory(1));
+  EXPECT_EQ(1, TranspositionTable::SizeForMemory(0));
+
+  Board board(Variant::STANDARD);
+  TranspositionTable t(TranspositionTable::SizeForMemory(1));
+  const U64 zkey = board.ZobristKey();
+  t.Put(100, NodeType::EXACT_NODE, 5, zkey, Move("e2e4"));
+  EXPECT_TRUE(t.Get(zkey));
+
+  // Resizing discards all entries.
+  t.Resize(TranspositionTable::SizeForMemory(4));
+  EXPECT_FALSE(t.Get(zkey));
+  t.Put(100, NodeType::EXACT_NODE, 5, zkey, Move("e2e4"));
+  EXPECT_EQ(100, t.Get(zkey)->score);
+}
+
+TEST(TransposTest, NonPowerOfTwoSize) {
+  TranspositionTable t(3);
+  // Keys at both ends of the range must map to valid buckets.
+  const U64 zkeys[] = {0ULL, 1ULL, 0x8000000000000000ULL, ~0ULL};
+  for (const U64 zkey : zkeys) {
+    t.Put(100, NodeType::EXACT_NODE, 5, zkey, Move("e2e4"));
+  }
+  for (const U64 zkey : zkeys) {
+    ASSERT_TRUE(t.Get(zkey));
+    EXPECT_EQ(100, t.Get(zkey)->score);
+  }
+}
@@ -0,0 +1,112 @@
+#include "board.h"
+#include "common.h"
+#include "params/params.h"
+#include "std_static_eval.h"
+#include "tuning/features.h"
+#include "tuning/parameters.h"
+#include "tuning/variable.h"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::vector<std::string> kFENs = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N2N2/PP2BPPP/R2QKB1R b KQ -",
+    "8/5pk1/6p1/3P4/1P3P2/P5PP/6K1/8 w - -",
+    "4k3/1p6/1p6/8/8/3P4/3P4/4K3 b - -",
+    "2r3k1/5ppp/8/3N4/8/1B6/5PPP/6K1 w - -"};
+
+} // namespace
+
+// Features must give the score of standard::StaticEval() as tuned.
+TEST(TuneFeaturesTest, EvalMatchesStaticEval) {
+  const StdEvalParams<double> params = BlessedParamsDbl();
+  const std::vector<double> flat = tuning::Flatten(params);
+  tuning::FeatureSet feature_set;
+  for (const std::string& fen : kFENs) {
+    feature_set.Add(Board(Variant::STANDARD, fen), 1.0);
+  }
+  for (size_t i = 0; i < kFENs.size(); ++i) {
+    Board board(Variant::STANDARD, kFENs[i]);
+    EXPECT_NEAR((standard::StaticEval<double, false, false>(params, board)),
+                feature_set.Eval(i, flat.data()), 1e-3)
+        << kFENs[i];
+  }
+}
+
+// The gradient of the score by each parameter must match the one autodiff
+// computes over the evaluation graph.
+TEST(TuneFeaturesTest, GradientMatchesAutodiff) {
+  const std::vector<double> flat = tuning::Flatten(BlessedParamsDbl());
+  for (const std::string& fen : kFENs) {
+    tuning::FeatureSet feature_set;
+    feature_set.Add(Board(Variant::STANDARD, fen), 1.0);
+    std::vector<double> grad(tuning::kNumParams);
+    feature_set.AddGradient(0, 1.0, grad.data());
+
+    StdEvalParams<Variable> eval_params;
+    std::vector<Variable*> variables;
+    const auto collect = [&variables](auto& array) {
+      for (auto& v : array) {
+        variables.push_back(&v);
+      }
+    };
+    collect(eval_params.pv_mgame);
+    collect(eval_params.pv_egame);
+    for (auto* pst : {&eval_params.pst_mgame, &eval_params.pst_egame}) {
+      for (auto& array : *pst) {
+        collect(array);
+      }
+    }
+    collect(eval_params.doubled_pawns_mgame);
+    collect(eval_params.doubled_pawns_egame);
+    collect(eval_params.passed_pawns_mgame);
+    collect(eval_params.passed_pawns_egame);
+    collect(eval_params.isolated_pawns_mgame);
+    collect(eval_params.isolated_pawns_egame);
+    collect(eval_params.defended_pawns_mgame);
+    collect(eval_params.defended_pawns_egame);
+    for (auto* pst :
+         {&eval_params.mobility_mgame, &eval_params.mobility_egame}) {
+      for (auto& array : *pst) {
+        collect(array);
+      }
+    }
+    variables.push_back(&eval_params.tempo_w_mgame);
+    variables.push_back(&eval_params.tempo_w_egame);
+    variables.push_back(&eval_params.tempo_b_mgame);
+    variables.push_back(&eval_params.tempo_b_egame);
+    ASSERT_EQ(tuning::kNumParams, variables.size());
+    for (size_t i = 0; i < variables.size(); ++i) {
+      *variables[i] = Variable(flat[i]);
+    }
+
+    Board board(Variant::STANDARD, fen);
+    Variable score =
+        standard::StaticEval<Variable, false, false>(eval_params, board);
+    score.Backward();
+    for (size_t i = 0; i < variables.size(); ++i) {
+      EXPECT_NEAR(variables[i]->data_->grad, grad[i], 1e-5)
+          << fen << " param " << i;
+    }
+  }
+}
+
+TEST(TuneFeaturesTest, Append) {
+  const std::vector<double> flat = tuning::Flatten(BlessedParamsDbl());
+  tuning::FeatureSet all, first, second;
+  for (size_t i = 0; i < kFENs.size(); ++i) {
+    const Board board(Variant::STANDARD, kFENs[i]);
+    all.Add(board, i * 0.25);
+    (i < 2 ? first : second).Add(board, i * 0.25);
+  }
+  first.Append(second);
+  ASSERT_EQ(all.Size(), first.Size());
+  for (size_t i = 0; i < all.Size(); ++i) {
+    EXPECT_EQ(all.Result(i), first.Result(i));
+    EXPECT_EQ(all.Eval(i, flat.data()), first.Eval(i, flat.data()));
+  }
+}
@@ -0,0 +1,68 @@
+#include "thread_pool.h"
+
+#include <cassert>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+ThreadPool::~ThreadPool() { Stop(); }
+
+void ThreadPool::Resize(const int num_workers) {
+  Stop();
+  for (int i = 0; i < num_workers; ++i) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this, i, generation_);
+  }
+}
+
+void ThreadPool::Run(std::function<void(int)> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    assert(pending_ == 0);
+    task_ = std::move(task);
+    pending_ = workers_.size();
+    ++generation_;
+  }
+  work_cv_.notify_all();
+}
+
+void ThreadPool::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] { return pending_ == 0; });
+}
+
+void ThreadPool::WorkerLoop(const int worker_num, uint64_t generation) {
+  while (true) {
+    std::function<void(int)> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_cv_.wait(lock,
+                    [&] { return quit_ || generation_ != generation; });
+      if (quit_) {
+        return;
+      }
+      generation = generation_;
+      task = task_;
+    }
+    task(worker_num);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--pending_ == 0) {
+        done_cv_.notify_all();
+      }
+    }
+  }
+}
+
+void ThreadPool::Stop() {
+  Wait();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+  quit_ = false;
+}
@@ -0,0 +1,51 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of long-lived worker threads that sleep on a condition variable
+// between tasks, so that dispatching work does not pay for thread creation.
+class ThreadPool {
+public:
+  ThreadPool() = default;
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Sets the number of worker threads. Must not be called while a task is
+  // running.
+  void Resize(int num_workers);
+
+  int NumWorkers() const { return workers_.size(); }
+
+  // Wakes up all workers to run task(worker_num), where worker_num is in
+  // [0, NumWorkers()). Returns without waiting for the task to finish.
+  void Run(std::function<void(int)> task);
+
+  // Blocks until all workers finish the task given to the last Run().
+  void Wait();
+
+private:
+  void WorkerLoop(int worker_num, uint64_t generation);
+  void Stop();
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  std::function<void(int)> task_;
+  // Incremented for every Run() so that workers can tell a new task apart
+  // from a spurious wakeup.
+  uint64_t generation_ = 0;
+  // Number of workers yet to finish the current task.
+  int pending_ = 0;
+  bool quit_ = false;
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "training_data.h"
+#include "board.h"
+#include "common.h"
+#include "compact.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+};
+
+constexpr char kMagic[8] = {'N', 'K', 'P', 'O', 'S', '\0', '\0', '\0'};
+constexpr uint32_t kVersion = 1;
+
+Header MakeHeader() {
+  Header header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.record_size = sizeof(PackedPosition);
+  return header;
+}
+
+std::runtime_error Error(const std::string& path, const std::string& what) {
+  return std::runtime_error("training data " + path + ": " + what);
+}
+
+} // namespace
+
+PackedPosition PackPosition(const Board& board, const int score,
+                            const double result) {
+  PackedPosition position = {};
+  position.occupancy = board.BitBoard();
+  int n = 0;
+  for (U64 bb = position.occupancy; bb; bb &= bb - 1) {
+    const uint8_t piece = PieceIndex(board.PieceAt(Lsb1(bb)));
+    position.pieces[n / 2] |= (n % 2) ? piece << 4 : piece;
+    ++n;
+  }
+  const BoardDesc board_desc = board.ToCompactBoardDesc();
+  position.flags =
+      (board.SideToMove() == Side::BLACK ? 1 : 0) | (board_desc.castle << 1);
+  position.ep_index = board.EnpassantTarget();
+  position.score = std::clamp(score, INT16_MIN, INT16_MAX);
+  position.result = static_cast<uint8_t>(std::lround(result * 2));
+  return position;
+}
+
+BoardDesc UnpackPosition(const PackedPosition& position) {
+  if (PopCount(position.occupancy) > 2 * int(sizeof(position.pieces))) {
+    throw std::runtime_error("packed position with too many pieces");
+  }
+  BoardDesc board_desc = {};
+  int n = 0;
+  for (U64 bb = position.occupancy; bb; bb &= bb - 1) {
+    const uint8_t piece = (position.pieces[n / 2] >> (4 * (n % 2))) & 0xF;
+    if (piece >= 12) {
+      throw std::runtime_error("packed position with invalid piece");
+    }
+    board_desc.bitboard_pieces[piece] |= 1ULL << Lsb1(bb);
+    ++n;
+  }
+  board_desc.side_to_move = (position.flags & 1) ? Side::BLACK : Side::WHITE;
+  board_desc.castle = (position.flags >> 1) & 0xF;
+  board_desc.ep_index = position.ep_index;
+  return board_desc;
+}
+
+PackedPositionWriter::PackedPositionWriter(const std::string& path)
+    : path_(path) {
+  const Header header = MakeHeader();
+  if (std::ifstream in(path, std::ios::binary); in) {
+    Header existing;
+    in.read(reinterpret_cast<char*>(&existing), sizeof(existing));
+    if (in.gcount() == sizeof(existing)) {
+      if (std::memcmp(&existing, &header, sizeof(header)) != 0) {
+        throw Error(path, "not a packed position file of this version");
+      }
+    } else if (in.gcount() != 0) {
+      throw Error(path, "truncated header");
+    }
+  }
+  // A position cut short by an interrupted write is dropped, so that appended
+  // positions stay aligned to records.
+  struct stat st;
+  if (stat(path.c_str(), &st) == 0 && st.st_size > off_t(sizeof(header))) {
+    const off_t partial =
+        (st.st_size - sizeof(header)) % sizeof(PackedPosition);
+    if (partial != 0 && truncate(path.c_str(), st.st_size - partial) != 0) {
+      throw Error(path, strerror(errno));
+    }
+  }
+  out_.open(path, std::ios::binary | std::ios::app);
+  if (!out_) {
+    throw Error(path, strerror(errno));
+  }
+  if (out_.tellp() == 0) {
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+}
+
+void PackedPositionWriter::Write(const PackedPosition& position) {
+  out_.write(reinterpret_cast<const char*>(&position), sizeof(position));
+}
+
+void PackedPositionWriter::Flush() {
+  out_.flush();
+  if (!out_) {
+    throw Error(path_, "write failed");
+  }
+}
+
+PackedPositionFile::PackedPositionFile(const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw Error(path, strerror(errno));
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < off_t(sizeof(Header))) {
+    close(fd);
+    throw Error(path, "cannot read header");
+  }
+  mapped_bytes_ = st.st_size;
+  mapped_ = mmap(nullptr, mapped_bytes_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped_ == MAP_FAILED) {
+    mapped_ = nullptr;
+    throw Error(path, strerror(errno));
+  }
+  const Header header = MakeHeader();
+  if (std::memcmp(mapped_, &header, sizeof(header)) != 0) {
+    munmap(mapped_, mapped_bytes_);
+    mapped_ = nullptr;
+    throw Error(path, "not a packed position file of this version");
+  }
+  // A position cut short by an interrupted write is ignored.
+  positions_ = std::span<const PackedPosition>(
+      reinterpret_cast<const PackedPosition*>(
+          static_cast<const char*>(mapped_) + sizeof(header)),
+      (mapped_bytes_ - sizeof(header)) / sizeof(PackedPosition));
+}
+
+PackedPositionFile::~PackedPositionFile() {
+  if (mapped_) {
+    munmap(mapped_, mapped_bytes_);
+  }
+}
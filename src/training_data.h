@@ -0,0 +1,92 @@
+#ifndef TRAINING_DATA_H
+#define TRAINING_DATA_H
+
+#include "board.h"
+#include "common.h"
+#include "compact.h"
+
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+
+// A standard chess position for tuning, packed into 32 bytes: the occupied
+// squares, then the piece on each occupied square in order of square index as
+// a 4 bit PieceIndex(), then side to move, castling rights, en passant target,
+// search score and game result.
+struct PackedPosition {
+  U64 occupancy;
+  // Two pieces per byte, the first in the low 4 bits. A legal position has
+  // at most 32 pieces.
+  uint8_t pieces[16];
+  // Bit 0 is set if black is to move, and bits 1-4 hold the castling rights
+  // in the order of BoardDesc::castle.
+  uint8_t flags;
+  // En passant target square, or NO_EP.
+  uint8_t ep_index;
+  // Search score from white's point of view, or 0 if not searched.
+  int16_t score;
+  // 0 if black won the game, 1 for a draw and 2 if white won.
+  uint8_t result;
+  uint8_t reserved[3];
+
+  // Game result for white: 0, 0.5 or 1.
+  double Result() const { return result / 2.0; }
+};
+static_assert(sizeof(PackedPosition) == 32);
+
+// Packs the position on board, with given search score from white's point of
+// view and game result for white (0, 0.5 or 1).
+PackedPosition PackPosition(const Board& board, int score, double result);
+
+// Unpacks a position packed by PackPosition(). Throws std::runtime_error if
+// the position holds more pieces than fit or an invalid piece index.
+BoardDesc UnpackPosition(const PackedPosition& position);
+
+// Appends packed positions to a file: a header followed by PackedPosition
+// records. Not safe for concurrent use.
+class PackedPositionWriter {
+public:
+  // Opens the file at path for appending, writing its header if it is new and
+  // dropping a trailing position cut short by an interrupted write. Throws
+  // std::runtime_error if the file cannot be written or is not a packed
+  // position file.
+  explicit PackedPositionWriter(const std::string& path);
+
+  void Write(const PackedPosition& position);
+
+  // Writes out buffered positions. Throws std::runtime_error on failure.
+  void Flush();
+
+private:
+  std::string path_;
+  std::ofstream out_;
+};
+
+// A file written by PackedPositionWriter, memory-mapped so that positions are
+// paged in as they are read rather than loaded up front.
+class PackedPositionFile {
+public:
+  // Throws std::runtime_error if the file cannot be mapped or is not a packed
+  // position file.
+  explicit PackedPositionFile(const std::string& path);
+  ~PackedPositionFile();
+
+  PackedPositionFile(const PackedPositionFile&) = delete;
+  PackedPositionFile& operator=(const PackedPositionFile&) = delete;
+
+  std::span<const PackedPosition> Positions() const { return positions_; }
+
+  size_t Size() const { return positions_.size(); }
+
+  const PackedPosition& operator[](const size_t i) const {
+    return positions_[i];
+  }
+
+private:
+  void* mapped_ = nullptr;
+  size_t mapped_bytes_ = 0;
+  std::span<const PackedPosition> positions_;
+};
+
+#endif
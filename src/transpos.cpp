@@ -3,88 +3,168 @@
 #include "stopwatch.h"
 #include "zobrist.h"
 
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <new>
 #include <optional>
+#include <sys/mman.h>
 
-uint64_t ZKey(const TTEntry& tt_entry) {
-  const uint64_t& data = reinterpret_cast<const uint64_t&>(tt_entry.data);
-  return tt_entry.zkey ^ data;
+namespace {
+
+constexpr size_t kCacheLineSize = 64;
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+// Loads an entry, setting zkey to the key the entry was stored with. A torn
+// entry yields a key that does not match any position.
+TTData Load(const TTEntry& tt_entry, U64& zkey) {
+  const uint64_t data = tt_entry.data.load(std::memory_order_relaxed);
+  zkey = tt_entry.zkey.load(std::memory_order_relaxed) ^ data;
+  return std::bit_cast<TTData>(data);
+}
+
+void Store(U64 zkey, const TTData& tdata, TTEntry& tt_entry) {
+  const uint64_t data = std::bit_cast<uint64_t>(tdata);
+  tt_entry.zkey.store(zkey ^ data, std::memory_order_relaxed);
+  tt_entry.data.store(data, std::memory_order_relaxed);
+}
+
+} // namespace
+
+TranspositionTable::TranspositionTable(uint64_t size) : size_(size) {
+  Allocate();
 }
 
-void SetZKey(int64_t zkey, TTEntry& tt_entry) {
-  const uint64_t data = reinterpret_cast<const uint64_t&>(tt_entry.data);
-  tt_entry.zkey = (zkey ^ data);
+TranspositionTable::~TranspositionTable() { Deallocate(); }
+
+uint64_t TranspositionTable::SizeForMemory(int memory_mb) {
+  const uint64_t bytes = uint64_t(std::max(0, memory_mb)) << 20;
+  return std::max<uint64_t>(1, bytes / sizeof(TTBucket));
 }
 
-TranspositionTable::TranspositionTable(int size) : size_(size) {
-  std::cout << "# Transposition table memory usage: "
-            << (size_ * sizeof(TTBucket)) / (1U << 20) << " MB" << std::endl;
-  tt_buckets_ = new TTBucket[size_];
+void TranspositionTable::Resize(uint64_t size) {
+  Deallocate();
+  size_ = size;
+  stats_.Reset();
+  Allocate();
 }
 
-TranspositionTable::~TranspositionTable() { delete tt_buckets_; }
+// Buckets are cache line aligned so that a probe touches exactly one cache
+// line. Tables spanning at least one huge page are backed by huge pages where
+// possible to cut down on TLB misses: explicitly reserved huge pages are tried
+// first, falling back to huge page aligned heap memory advised for transparent
+// huge pages.
+void TranspositionTable::Allocate() {
+  const size_t bytes = size_t(size_) * sizeof(TTBucket);
+  const size_t alignment =
+      bytes >= kHugePageSize ? kHugePageSize : kCacheLineSize;
+  alloc_bytes_ = (bytes + alignment - 1) / alignment * alignment;
+  hugetlb_ = false;
+
+  void* mem = MAP_FAILED;
+  if (alignment == kHugePageSize) {
+    mem = mmap(nullptr, alloc_bytes_, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  }
+  if (mem != MAP_FAILED) {
+    hugetlb_ = true;
+  } else {
+    mem = std::aligned_alloc(alignment, alloc_bytes_);
+    if (!mem) {
+      throw std::bad_alloc();
+    }
+    if (alignment == kHugePageSize) {
+      madvise(mem, alloc_bytes_, MADV_HUGEPAGE);
+    }
+  }
+  // Value initialization zeroes all entries, marking them invalid.
+  tt_buckets_ = static_cast<TTBucket*>(mem);
+  std::uninitialized_value_construct_n(tt_buckets_, size_);
+
+  std::cout << "# Transposition table memory usage: " << (bytes >> 20)
+            << " MB" << (hugetlb_ ? " (huge pages)" : "") << std::endl;
+}
+
+void TranspositionTable::Deallocate() {
+  if (!tt_buckets_) {
+    return;
+  }
+  if (hugetlb_) {
+    munmap(tt_buckets_, alloc_bytes_);
+  } else {
+    std::free(tt_buckets_);
+  }
+  tt_buckets_ = nullptr;
+}
 
 std::optional<TTData> TranspositionTable::Get(U64 zkey) {
   TTBucket& bucket = tt_buckets_[hash(zkey)];
   for (int i = 0; i < 4; ++i) {
-    TTEntry tt_entry = bucket.tt_entries[i];
-    if (tt_entry.data.is_valid() && ZKey(tt_entry) == zkey) {
-      tt_entry.data.epoch = epoch_;
-      SetZKey(zkey, tt_entry);
-      ++hits_;
-      bucket.tt_entries[i] = tt_entry;
-      return tt_entry.data;
+    TTEntry& tt_entry = bucket.tt_entries[i];
+    U64 entry_zkey;
+    TTData tdata = Load(tt_entry, entry_zkey);
+    if (tdata.is_valid() && entry_zkey == zkey) {
+      tdata.epoch = epoch_;
+      Store(zkey, tdata, tt_entry);
+      stats_.Add(HITS);
+      return tdata;
     }
   }
-  ++misses_;
+  stats_.Add(MISSES);
   return std::nullopt;
 }
 
 void TranspositionTable::Put(int score, NodeType node_type, int depth, U64 zkey,
                              Move best_move) {
   TTBucket& bucket = tt_buckets_[hash(zkey)];
+  TTData tdatas[4];
   for (int i = 0; i < 4; ++i) {
     TTEntry& tt_entry = bucket.tt_entries[i];
-    if (!tt_entry.data.is_valid() || ZKey(tt_entry) == zkey) {
-      ++new_puts_;
+    U64 entry_zkey;
+    tdatas[i] = Load(tt_entry, entry_zkey);
+    if (!tdatas[i].is_valid() || entry_zkey == zkey) {
+      stats_.Add(NEW_PUTS);
       Set(score, node_type, depth, zkey, best_move, tt_entry);
       return;
     }
   }
   for (int i = 0; i < 4; ++i) {
-    TTEntry& tt_entry = bucket.tt_entries[i];
-    if (tt_entry.data.epoch < epoch_) {
-      ++old_replace_;
-      Set(score, node_type, depth, zkey, best_move, tt_entry);
+    if (tdatas[i].epoch < epoch_) {
+      stats_.Add(OLD_REPLACE);
+      Set(score, node_type, depth, zkey, best_move, bucket.tt_entries[i]);
       return;
     }
   }
-  TTEntry* shallow_entry = &bucket.tt_entries[0];
+  int shallow_index = 0;
   for (int i = 1; i < 4; ++i) {
-    TTEntry& tt_entry = bucket.tt_entries[i];
-    if (tt_entry.data.depth < shallow_entry->data.depth) {
-      shallow_entry = &tt_entry;
+    if (tdatas[i].depth < tdatas[shallow_index].depth) {
+      shallow_index = i;
     }
   }
-  ++depth_replace_;
-  Set(score, node_type, depth, zkey, best_move, *shallow_entry);
+  stats_.Add(DEPTH_REPLACE);
+  Set(score, node_type, depth, zkey, best_move,
+      bucket.tt_entries[shallow_index]);
 }
 
 void TranspositionTable::Set(int score, NodeType node_type, int depth, U64 zkey,
                              Move best_move, TTEntry& tt_entry) {
-  tt_entry.data.best_move = best_move;
-  tt_entry.data.score = score;
-  tt_entry.data.depth = depth;
-  tt_entry.data.epoch = epoch_;
-  tt_entry.data.flags = (uint16_t(node_type) << 1) | (0x1);
-  SetZKey(zkey, tt_entry);
+  TTData tdata;
+  tdata.best_move = best_move;
+  tdata.score = score;
+  tdata.depth = depth;
+  tdata.epoch = epoch_;
+  tdata.flags = (uint16_t(node_type) << 1) | (0x1);
+  Store(zkey, tdata, tt_entry);
 }
 
 double TranspositionTable::UtilizationFactor() const {
-  unsigned int num_filled_entries = 0;
-  for (int i = 0; i < size_; ++i) {
+  uint64_t num_filled_entries = 0;
+  for (uint64_t i = 0; i < size_; ++i) {
     for (int j = 0; j < 4; ++j) {
-      if (tt_buckets_[i].tt_entries[j].data.is_valid()) {
+      U64 unused_zkey;
+      if (Load(tt_buckets_[i].tt_entries[j], unused_zkey).is_valid()) {
         ++num_filled_entries;
       }
     }
@@ -95,14 +175,15 @@ double TranspositionTable::UtilizationFactor() const {
 void TranspositionTable::LogStats() const {
   using std::cout;
   using std::endl;
-  cout << "# Transpos hits:\t" << hits_ << endl;
-  cout << "# Transpos misses:\t" << misses_ << endl;
+  const uint64_t hits = stats_.Sum(HITS);
+  const uint64_t misses = stats_.Sum(MISSES);
+  cout << "# Transpos hits:\t" << hits << endl;
+  cout << "# Transpos misses:\t" << misses << endl;
   cout << "# Transpos util %:\t" << UtilizationFactor() << endl;
-  if (hits_ + misses_ > 0) {
-    cout << "# Transpos hits %:\t" << (100.0 * (hits_)) / (hits_ + misses_)
-         << endl;
+  if (hits + misses > 0) {
+    cout << "# Transpos hits %:\t" << (100.0 * hits) / (hits + misses) << endl;
   }
-  cout << "# Transpos new entries:\t" << new_puts_ << endl;
-  cout << "# Transpos old replace:\t" << old_replace_ << endl;
-  cout << "# Transpos depth replace:\t" << depth_replace_ << endl;
+  cout << "# Transpos new entries:\t" << stats_.Sum(NEW_PUTS) << endl;
+  cout << "# Transpos old replace:\t" << stats_.Sum(OLD_REPLACE) << endl;
+  cout << "# Transpos depth replace:\t" << stats_.Sum(DEPTH_REPLACE) << endl;
 }
@@ -3,8 +3,10 @@
 
 #include "common.h"
 #include "move.h"
+#include "stats.h"
 #include "zobrist.h"
 
+#include <atomic>
 #include <cstdio>
 #include <optional>
 
@@ -24,24 +26,50 @@ struct TTData {
 
 static_assert(sizeof(TTData) == 8);
 
+// Entries are read and written by concurrent search threads without locks.
+// Each entry is a pair of independently atomic 64-bit words with the key
+// stored XOR-ed with the data, so an entry torn by racing writers fails the
+// key check and is treated as a miss.
 struct TTEntry {
-  U64 zkey;
-  TTData data;
+  std::atomic<uint64_t> zkey;
+  std::atomic<uint64_t> data;
 };
 
 static_assert(sizeof(TTEntry) == 16);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
 
-struct TTBucket {
+struct alignas(64) TTBucket {
   TTEntry tt_entries[4];
 };
 
+static_assert(sizeof(TTBucket) == 64);
+
 class TranspositionTable {
 public:
-  TranspositionTable(int size);
+  // Constructs a table with given number of buckets. The number of buckets need
+  // not be a power of two.
+  TranspositionTable(uint64_t size);
   ~TranspositionTable();
 
+  TranspositionTable(const TranspositionTable&) = delete;
+  TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+  // Returns the number of buckets that fit in given memory budget (in MB).
+  static uint64_t SizeForMemory(int memory_mb);
+
+  // Discards all entries and reallocates the table with given number of
+  // buckets. Must not be called while a search is using the table.
+  void Resize(uint64_t size);
+
   std::optional<TTData> Get(U64 zkey);
 
+  // Hints the CPU to start loading the bucket for given key into cache. Called
+  // right after making a move so that the bucket is likely to be in cache by
+  // the time the resulting position is probed.
+  void Prefetch(U64 zkey) const {
+    __builtin_prefetch(&tt_buckets_[hash(zkey)]);
+  }
+
   void Put(int score, NodeType node_type, int depth, U64 zkey, Move best_move);
 
   void SetEpoch(uint8_t epoch) { epoch_ = epoch; }
@@ -52,18 +80,30 @@ private:
   void Set(int score, NodeType node_type, int depth, U64 zkey, Move best_move,
            TTEntry& t);
 
-  int hash(const U64 key) const { return key % size_; }
+  // Counted per thread, so that threads sharing the table do not contend on
+  // the counters.
+  enum Stat { HITS, MISSES, NEW_PUTS, OLD_REPLACE, DEPTH_REPLACE, NUM_STATS };
+
+  void Allocate();
+  void Deallocate();
+
+  // Maps key uniformly onto [0, size_) by taking the high 64 bits of the
+  // 128-bit product key * size_, which avoids a division on every probe.
+  uint64_t hash(const U64 key) const {
+    return (static_cast<unsigned __int128>(key) * size_) >> 64;
+  }
 
   double UtilizationFactor() const;
 
-  const int size_;
-  TTBucket* tt_buckets_;
+  uint64_t size_;
+  TTBucket* tt_buckets_ = nullptr;
+  // Size of the memory block backing tt_buckets_, in bytes.
+  size_t alloc_bytes_ = 0;
+  // True if tt_buckets_ is backed by explicitly reserved huge pages (mmap),
+  // false if it came from the regular heap.
+  bool hugetlb_ = false;
   uint8_t epoch_ = 0;
-  uint64_t hits_ = 0;
-  uint64_t misses_ = 0;
-  uint64_t new_puts_ = 0;
-  uint64_t old_replace_ = 0;
-  uint64_t depth_replace_ = 0;
+  ThreadCounters<NUM_STATS> stats_;
 };
 
 #endif
@@ -0,0 +1,65 @@
+#include "board.h"
+#include "common.h"
+#include "training_data.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// Converts tuning positions from EPD lines such as
+//   rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 c9 "1-0";
+// into packed positions (see training_data.h), which the tuner reads without
+// parsing. Positions are appended if the output file exists.
+int main(int argc, char* argv[]) {
+  if (argc != 3) {
+    std::cerr << "Expect arguments: <input EPD file> <output file>\n"
+              << "Eg: ./epd_convert main.epd main.bin" << std::endl;
+    return 1;
+  }
+  std::ifstream ifs(argv[1]);
+  if (!ifs) {
+    std::cerr << "Unable to open EPD file: " << argv[1] << std::endl;
+    return 1;
+  }
+  try {
+    PackedPositionWriter writer(argv[2]);
+    size_t num_positions = 0;
+    std::string line;
+    for (int line_num = 1; std::getline(ifs, line); ++line_num) {
+      std::istringstream iss(line);
+      std::string placement, side, castling, ep, opcode, result;
+      if (!(iss >> placement)) {
+        continue;
+      }
+      if (!(iss >> side >> castling >> ep >> opcode >> result) ||
+          opcode != "c9") {
+        throw std::runtime_error("line " + std::to_string(line_num) +
+                                 ": expected FEN and c9 result");
+      }
+      double white_result;
+      if (result == "\"1-0\";") {
+        white_result = 1.0;
+      } else if (result == "\"0-1\";") {
+        white_result = 0.0;
+      } else if (result == "\"1/2-1/2\";") {
+        white_result = 0.5;
+      } else {
+        throw std::runtime_error("line " + std::to_string(line_num) +
+                                 ": unexpected result " + result);
+      }
+      const Board board(Variant::STANDARD, placement + " " + side + " " +
+                                               castling + " " + ep);
+      writer.Write(PackPosition(board, 0, white_result));
+      ++num_positions;
+    }
+    writer.Flush();
+    std::cout << "Wrote " << num_positions << " positions to " << argv[2]
+              << std::endl;
+  } catch (const std::runtime_error& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
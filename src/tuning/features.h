@@ -0,0 +1,219 @@
+#ifndef FEATURES_H
+#define FEATURES_H
+
+#include "attacks.h"
+#include "board.h"
+#include "common.h"
+#include "pawns.h"
+#include "std_eval_params.h"
+#include "std_static_eval.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// The standard evaluation is linear in its parameters for a fixed position:
+// standard::StaticEval() with score_flip off is a sum of parameters times
+// coefficients that depend only on the position, such as piece counts,
+// mobility counts and the game phase. A position is therefore extracted once
+// into its sparse list of (parameter, coefficient) features, after which its
+// score under any parameters, and the gradient of the score, are dot products
+// over that list.
+namespace tuning {
+
+// All parameters of StdEvalParams<double> as one flat vector, in declaration
+// order.
+constexpr size_t kNumParams = sizeof(StdEvalParams<double>) / sizeof(double);
+static_assert(std::is_standard_layout_v<StdEvalParams<double>> &&
+              kNumParams * sizeof(double) == sizeof(StdEvalParams<double>));
+
+inline std::vector<double> Flatten(const StdEvalParams<double>& params) {
+  std::vector<double> flat(kNumParams);
+  std::memcpy(flat.data(), &params, sizeof(params));
+  return flat;
+}
+
+inline StdEvalParams<double> Unflatten(const std::vector<double>& flat) {
+  StdEvalParams<double> params;
+  std::memcpy(static_cast<void*>(&params), flat.data(), sizeof(params));
+  return params;
+}
+
+// Index of a parameter in the flat vector, from the offset of its array in
+// StdEvalParams and its index in the array.
+#define PARAM_INDEX(field, i)                                                  \
+  static_cast<uint32_t>(offsetof(StdEvalParams<double>, field) /               \
+                            sizeof(double) +                                   \
+                        (i))
+
+struct Feature {
+  uint32_t index;
+  float coef;
+};
+
+// Appends the features of the position on board to features, merged so that
+// every parameter appears at most once.
+inline void ExtractFeatures(const Board& board,
+                            std::vector<Feature>* features) {
+  std::vector<Feature> terms;
+  int game_phase = 0;
+  // Terms are first added with a coefficient of 1 for the middle game, and
+  // for the end game with the parameter index flagged by kEGame.
+  constexpr uint32_t kEGame = 1U << 31;
+  const auto add = [&terms](const uint32_t mgame_index,
+                            const uint32_t egame_index, const float coef) {
+    terms.push_back({mgame_index, coef});
+    terms.push_back({egame_index | kEGame, coef});
+  };
+
+  for (Piece piece = -PAWN; piece <= PAWN; ++piece) {
+    if (piece == NULLPIECE) {
+      continue;
+    }
+    const Piece type = PieceType(piece);
+    const Side side = PieceSide(piece);
+    const float sign = side == Side::WHITE ? 1.0f : -1.0f;
+    const U64 self_occ = board.BitBoard(side);
+    for (U64 bb = board.BitBoard(piece); bb; bb &= bb - 1) {
+      const int sq = Lsb1(bb);
+      const int index = side == Side::WHITE ? sq ^ 56 : sq;
+      add(PARAM_INDEX(pv_mgame, type), PARAM_INDEX(pv_egame, type), sign);
+      add(PARAM_INDEX(pst_mgame, type * 64 + index),
+          PARAM_INDEX(pst_egame, type * 64 + index), sign);
+      game_phase += standard::GAME_PHASE_INC[type];
+      if (type != KING && type != PAWN) {
+        const int mobility = PopCount(
+            attacks::Attacks(board.BitBoard(), sq, piece) & ~self_occ);
+        add(PARAM_INDEX(mobility_mgame, type * 64 + index),
+            PARAM_INDEX(mobility_egame, type * 64 + index), sign * mobility);
+      }
+    }
+  }
+
+  for (const Side side : {Side::WHITE, Side::BLACK}) {
+    const bool white = side == Side::WHITE;
+    const float sign = white ? 1.0f : -1.0f;
+    const auto add_pawns = [&](U64 bb, const uint32_t mgame_index,
+                               const uint32_t egame_index) {
+      for (; bb; bb &= bb - 1) {
+        const int index = white ? Lsb1(bb) ^ 56 : Lsb1(bb);
+        add(mgame_index + index, egame_index + index, sign);
+      }
+    };
+    add_pawns(white ? pawns::DoubledPawns<Side::WHITE>(board)
+                    : pawns::DoubledPawns<Side::BLACK>(board),
+              PARAM_INDEX(doubled_pawns_mgame, 0),
+              PARAM_INDEX(doubled_pawns_egame, 0));
+    add_pawns(white ? pawns::PassedPawns<Side::WHITE>(board)
+                    : pawns::PassedPawns<Side::BLACK>(board),
+              PARAM_INDEX(passed_pawns_mgame, 0),
+              PARAM_INDEX(passed_pawns_egame, 0));
+    add_pawns(white ? pawns::IsolatedPawns<Side::WHITE>(board)
+                    : pawns::IsolatedPawns<Side::BLACK>(board),
+              PARAM_INDEX(isolated_pawns_mgame, 0),
+              PARAM_INDEX(isolated_pawns_egame, 0));
+    add_pawns(white ? pawns::DefendedPawns<Side::WHITE>(board)
+                    : pawns::DefendedPawns<Side::BLACK>(board),
+              PARAM_INDEX(defended_pawns_mgame, 0),
+              PARAM_INDEX(defended_pawns_egame, 0));
+  }
+
+  if (board.SideToMove() == Side::WHITE) {
+    add(PARAM_INDEX(tempo_w_mgame, 0), PARAM_INDEX(tempo_w_egame, 0), 1.0f);
+  } else {
+    add(PARAM_INDEX(tempo_b_mgame, 0), PARAM_INDEX(tempo_b_egame, 0), -1.0f);
+  }
+
+  // Scale by the phase weights and merge terms of the same parameter.
+  const int mgame_phase = std::min(24, game_phase);
+  const float mgame_weight = mgame_phase / 24.0f;
+  const float egame_weight = (24 - mgame_phase) / 24.0f;
+  for (Feature& term : terms) {
+    if (term.index & kEGame) {
+      term.index &= ~kEGame;
+      term.coef *= egame_weight;
+    } else {
+      term.coef *= mgame_weight;
+    }
+  }
+  std::sort(terms.begin(), terms.end(), [](const Feature& a, const Feature& b) {
+    return a.index < b.index;
+  });
+  for (size_t i = 0; i < terms.size();) {
+    Feature feature = terms[i];
+    for (++i; i < terms.size() && terms[i].index == feature.index; ++i) {
+      feature.coef += terms[i].coef;
+    }
+    if (feature.coef != 0.0f) {
+      features->push_back(feature);
+    }
+  }
+}
+
+#undef PARAM_INDEX
+
+// Features of many positions stored contiguously, with the game result of
+// each position (1 for a white win, 0.5 for a draw, 0 for a black win).
+class FeatureSet {
+public:
+  void Add(const Board& board, const double result) {
+    ExtractFeatures(board, &features_);
+    offsets_.push_back(features_.size());
+    results_.push_back(result);
+  }
+
+  // Adds the positions of other after those of this set.
+  void Append(const FeatureSet& other) {
+    for (size_t i = 1; i < other.offsets_.size(); ++i) {
+      offsets_.push_back(features_.size() + other.offsets_[i]);
+    }
+    features_.insert(features_.end(), other.features_.begin(),
+                     other.features_.end());
+    results_.insert(results_.end(), other.results_.begin(),
+                    other.results_.end());
+  }
+
+  void Clear() {
+    features_.clear();
+    offsets_.resize(1);
+    results_.clear();
+  }
+
+  size_t Size() const { return results_.size(); }
+
+  double Result(const size_t i) const { return results_[i]; }
+
+  // Score of position i from white's point of view under the flat params.
+  double Eval(const size_t i, const double* params) const {
+    double score = 0.0;
+    for (uint64_t f = offsets_[i]; f < offsets_[i + 1]; ++f) {
+      score += features_[f].coef * params[features_[f].index];
+    }
+    return score;
+  }
+
+  // Adds d_score times the gradient of Eval(i, ...) to grad.
+  void AddGradient(const size_t i, const double d_score, double* grad) const {
+    for (uint64_t f = offsets_[i]; f < offsets_[i + 1]; ++f) {
+      grad[features_[f].index] += d_score * features_[f].coef;
+    }
+  }
+
+  // Average number of features per position.
+  double AvgFeatures() const {
+    return Size() ? double(features_.size()) / Size() : 0.0;
+  }
+
+private:
+  std::vector<Feature> features_;
+  std::vector<uint64_t> offsets_ = {0};
+  std::vector<float> results_;
+};
+
+} // namespace tuning
+
+#endif
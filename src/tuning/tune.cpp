@@ -2,32 +2,84 @@
 #include "common.h"
 #include "params/params.h"
 #include "std_static_eval.h"
+#include "stopwatch.h"
+#include "thread_pool.h"
+#include "training_data.h"
+#include "tuning/features.h"
 #include "tuning/parameters.h"
 #include "tuning/variable.h"
 
 #include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <cstdint>
 #include <random>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
 const std::string kExperimentName = "Exp20251229Iter1";
-const std::string kDataFile = "/home/goutham/workspace/github/goutham/nakshatra-tools/tuning/main.epd";
+// Packed positions, see training_data.h. epd_convert writes them from EPD.
+const std::string kDataFile = "/home/goutham/workspace/github/goutham/nakshatra-tools/tuning/main.bin";
 constexpr double kMultiplier = 1.0 / 113.6;
 constexpr double kLearningRate = 10.0;
 constexpr int kBatchSize = 1024;
 constexpr int kMaxEpochs = 100;
 
-struct EPDRecord {
-  std::string fen;
-  double result;
+// Workers that split batches, losses and feature extraction, one per hardware
+// thread unless set by "--threads=N".
+ThreadPool thread_pool;
+
+// Runs task(worker_num, begin, end) on every worker of thread_pool for its
+// share [begin, end) of [0, size), and waits for all of them.
+void ParallelFor(const size_t size,
+                 const std::function<void(int, size_t, size_t)>& task) {
+  const size_t num_workers = thread_pool.NumWorkers();
+  thread_pool.Run([&](const int worker_num) {
+    task(worker_num, size * worker_num / num_workers,
+         size * (worker_num + 1) / num_workers);
+  });
+  thread_pool.Wait();
+}
+
+// Sums value(worker_num, begin, end) over the shares of [0, size) of all
+// workers, in worker order so that the sum does not depend on timing.
+double ParallelSum(
+    const size_t size,
+    const std::function<double(int, size_t, size_t)>& value) {
+  std::vector<double> sums(thread_pool.NumWorkers());
+  ParallelFor(size, [&](const int worker_num, const size_t begin,
+                        const size_t end) {
+    sums[worker_num] = value(worker_num, begin, end);
+  });
+  double sum = 0.0;
+  for (const double worker_sum : sums) {
+    sum += worker_sum;
+  }
+  return sum;
+}
+
+// Positions of the training or test set, as indices into the memory-mapped
+// data file so that the sets take 4 bytes per position.
+class Records {
+public:
+  Records(const PackedPositionFile& file, std::vector<uint32_t> indices)
+      : file_(file), indices_(std::move(indices)) {}
+
+  size_t size() const { return indices_.size(); }
 
-  friend std::ostream& operator<<(std::ostream& os, const EPDRecord& val) {
-    os << val.fen << " | " << val.result;
-    return os;
+  const PackedPosition& operator[](const size_t i) const {
+    return file_[indices_[i]];
   }
+
+private:
+  const PackedPositionFile& file_;
+  std::vector<uint32_t> indices_;
 };
 
 template <typename FromType, typename ToType>
@@ -206,49 +258,6 @@ void WriteFile(const StdEvalParams<double>& params, int epoch, int step,
   ofs << "#endif" << std::endl;
 }
 
-std::vector<EPDRecord> Parse() {
-  std::ifstream ifs(kDataFile);
-  if (!ifs) {
-    std::cerr << "Unable to open data file: " << kDataFile << std::endl;
-    exit(-1);
-  }
-  std::vector<EPDRecord> epd_records;
-  while (true) {
-    std::string fen;
-    std::string nextp;
-    std::string castling;
-    std::string ep;
-    std::string comment;
-    std::string result;
-    if (ifs >> fen) {
-      ifs >> nextp;
-      ifs >> castling;
-      ifs >> ep;
-      ifs >> comment;
-      assert(comment == "c9");
-      ifs >> result;
-    } else {
-      break;
-    }
-    EPDRecord epd_record;
-    epd_record.fen = fen + " " + nextp + " " + castling + " " + ep;
-    if (result == "\"1-0\";") {
-      epd_record.result = 1.0;
-    } else if (result == "\"0-1\";") {
-      epd_record.result = 0.0;
-    } else if (result == "\"1/2-1/2\";") {
-      epd_record.result = 0.5;
-    } else {
-      throw std::invalid_argument("unexpected str: " + result);
-    }
-    // if (nextp == "b") {
-    //   epd_record.result = 1.0 - epd_record.result;
-    // }
-    epd_records.push_back(epd_record);
-  }
-  return epd_records;
-}
-
 template <typename ValueType>
 double Loss(double score, double result, const StdEvalParams<ValueType>& params,
             double multiplier = kMultiplier) {
@@ -262,17 +271,102 @@ Variable Loss(Variable score, double result,
 }
 
 template <typename ValueType>
-double AvgLoss(const std::vector<EPDRecord>& epd_records,
-               const StdEvalParams<ValueType>& params,
+double AvgLoss(const Records& records, const StdEvalParams<ValueType>& params,
                double multiplier = kMultiplier) {
-  double loss = 0.0;
-  for (const auto& record : epd_records) {
-    Board board(Variant::STANDARD, record.fen);
-    const double score =
-        standard::StaticEval<ValueType, false, false>(params, board);
-    loss += double(Loss(score, record.result, params, multiplier));
+  const double loss = ParallelSum(
+      records.size(), [&](int, const size_t begin, const size_t end) {
+        double loss = 0.0;
+        for (size_t i = begin; i < end; ++i) {
+          Board board(Variant::STANDARD, UnpackPosition(records[i]));
+          const double score =
+              standard::StaticEval<ValueType, false, false>(params, board);
+          loss += double(Loss(score, records[i].Result(), params, multiplier));
+        }
+        return loss;
+      });
+  return loss / records.size();
+}
+
+// Features of records, either extracted once up front or, if streamed,
+// extracted again for every use so that record sets whose features do not fit
+// in memory can be trained on.
+class Features {
+public:
+  Features(const Records& records, const bool stream)
+      : records_(records), stream_(stream),
+        worker_sets_(thread_pool.NumWorkers()) {
+    if (stream_) {
+      return;
+    }
+    ParallelFor(records.size(), [this](const int worker_num, const size_t begin,
+                                       const size_t end) {
+      Extract(begin, end, &worker_sets_[worker_num]);
+    });
+    for (tuning::FeatureSet& worker_set : worker_sets_) {
+      all_.Append(worker_set);
+      worker_set = tuning::FeatureSet();
+    }
   }
-  return loss / epd_records.size();
+
+  size_t Size() const { return records_.size(); }
+
+  // Returns a feature set with the features of records [begin, end) from
+  // index *first on, for use by given worker until its next call.
+  const tuning::FeatureSet& Get(const int worker_num, const size_t begin,
+                                const size_t end, size_t* first) {
+    if (!stream_) {
+      *first = begin;
+      return all_;
+    }
+    tuning::FeatureSet& worker_set = worker_sets_[worker_num];
+    worker_set.Clear();
+    Extract(begin, end, &worker_set);
+    *first = 0;
+    return worker_set;
+  }
+
+  // Average number of features per position, of those extracted so far.
+  double AvgFeatures() const { return all_.AvgFeatures(); }
+
+private:
+  void Extract(const size_t begin, const size_t end,
+               tuning::FeatureSet* feature_set) const {
+    for (size_t i = begin; i < end; ++i) {
+      feature_set->Add(Board(Variant::STANDARD, UnpackPosition(records_[i])),
+                       records_[i].Result());
+    }
+  }
+
+  const Records& records_;
+  const bool stream_;
+  tuning::FeatureSet all_;
+  std::vector<tuning::FeatureSet> worker_sets_;
+};
+
+// Average loss of the positions of features under flat params.
+double AvgLoss(Features& features, const std::vector<double>& params,
+               double multiplier = kMultiplier) {
+  // Streamed features are extracted in chunks of this many positions.
+  constexpr size_t kChunkSize = 4096;
+  const double loss = ParallelSum(
+      features.Size(),
+      [&](const int worker_num, const size_t begin, const size_t end) {
+        double loss = 0.0;
+        for (size_t chunk = begin; chunk < end; chunk += kChunkSize) {
+          size_t first;
+          const tuning::FeatureSet& feature_set = features.Get(
+              worker_num, chunk, std::min(end, chunk + kChunkSize), &first);
+          for (size_t i = first;
+               i < first + std::min(end - chunk, kChunkSize); ++i) {
+            const double p =
+                1.0 /
+                (1.0 + exp(-feature_set.Eval(i, params.data()) * multiplier));
+            loss += (feature_set.Result(i) - p) * (feature_set.Result(i) - p);
+          }
+        }
+        return loss;
+      });
+  return loss / features.Size();
 }
 
 void LogMetric(int epoch, int step, const std::string& metric, double value) {
@@ -307,31 +401,130 @@ int _main() {
 }
 */
 
-int main() {
+// Trains on features extracted once from every record, see
+// tuning/features.h. Each step is a pass over the features of a batch, with no
+// boards or evaluation graphs built. If stream is set, features are extracted
+// for every batch instead, trading time for memory.
+void TrainWithFeatures(const Records& train_records,
+                       const Records& test_records, const bool stream) {
+  StopWatch stop_watch;
+  stop_watch.Start();
+  Features train_set(train_records, stream);
+  Features test_set(test_records, stream);
+  if (!stream) {
+    std::cout << "Features per position: " << train_set.AvgFeatures()
+              << ", extracted in " << stop_watch.ElapsedTime() / 100 << "s"
+              << std::endl;
+  }
+
+  std::vector<double> params = tuning::Flatten(BlessedParamsDbl());
+  // std::vector<double> params = tuning::Flatten(ZeroParams<double>());
+  std::vector<double> grad(params.size());
+  std::vector<double> velocity(params.size());
+  // Every worker accumulates the gradient of its share of a batch in its own
+  // vector, and the vectors are summed after.
+  std::vector<std::vector<double>> worker_grads(
+      thread_pool.NumWorkers(), std::vector<double>(params.size()));
+  const auto integerized = [](std::vector<double> params) {
+    // Ignores the rounding of the phase-weighted division in the integer
+    // evaluation.
+    for (double& param : params) {
+      param = std::round(param);
+    }
+    return params;
+  };
+
+  int step = 0;
+  int log_step = 0;
+  int epoch = 0;
+  do {
+    epoch++;
+    stop_watch.Start();
+    for (size_t begin = 0; begin + kBatchSize <= train_set.Size();
+         begin += kBatchSize) {
+      step++;
+      log_step++;
+      const double batch_loss = ParallelSum(
+          kBatchSize, [&](const int worker_num, const size_t batch_begin,
+                          const size_t batch_end) {
+            std::vector<double>& worker_grad = worker_grads[worker_num];
+            std::fill(worker_grad.begin(), worker_grad.end(), 0.0);
+            size_t first;
+            const tuning::FeatureSet& feature_set =
+                train_set.Get(worker_num, begin + batch_begin,
+                              begin + batch_end, &first);
+            double loss = 0.0;
+            for (size_t i = first; i < first + batch_end - batch_begin; ++i) {
+              const double p =
+                  1.0 / (1.0 + exp(-feature_set.Eval(i, params.data()) *
+                                   kMultiplier));
+              const double error = feature_set.Result(i) - p;
+              loss += error * error;
+              // Derivative of the loss by the score. The multiplier is left
+              // out, as in Variable::Sigmoid(), so that kLearningRate keeps
+              // its meaning.
+              feature_set.AddGradient(
+                  i, -2.0 * error * p * (1.0 - p) / kBatchSize,
+                  worker_grad.data());
+            }
+            return loss;
+          });
+      ParallelFor(params.size(), [&](int, const size_t param_begin,
+                                     const size_t param_end) {
+        for (size_t i = param_begin; i < param_end; ++i) {
+          grad[i] = 0.0;
+          for (const std::vector<double>& worker_grad : worker_grads) {
+            grad[i] += worker_grad[i];
+          }
+        }
+      });
+      LogMetric(epoch, step, "batch_loss", batch_loss / kBatchSize);
+      double grad_norm = 0.0;
+      double weights_mag = 0.0;
+      for (size_t i = 0; i < params.size(); ++i) {
+        velocity[i] = velocity[i] * 0.9 + (1 - 0.9) * grad[i];
+        grad_norm += velocity[i] * velocity[i];
+        params[i] -= velocity[i] * kLearningRate;
+        weights_mag += params[i] * params[i];
+      }
+      LogMetric(epoch, step, "grad_norm", std::sqrt(grad_norm));
+      LogMetric(epoch, step, "weights", std::sqrt(weights_mag));
+
+      if (log_step >= 50) {
+        log_step = 0;
+        WriteFile(tuning::Unflatten(params), epoch, step);
+        LogMetric(epoch, step, "train_loss", AvgLoss(train_set, params));
+        LogMetric(epoch, step, "test_loss", AvgLoss(test_set, params));
+        LogMetric(epoch, step, "integerized_train_loss",
+                  AvgLoss(train_set, integerized(params)));
+        LogMetric(epoch, step, "integerized_test_loss",
+                  AvgLoss(test_set, integerized(params)));
+      }
+    }
+    LogMetric(epoch, step, "epoch_secs", stop_watch.ElapsedTime() / 100);
+  } while (epoch + 1 <= kMaxEpochs);
+
+  std::cout << "Final Train Loss: " << AvgLoss(train_set, params) << std::endl;
+  std::cout << "Final Test Loss: " << AvgLoss(test_set, params) << std::endl;
+  std::cout << "Final Train Loss (integerized): "
+            << AvgLoss(train_set, integerized(params)) << std::endl;
+  std::cout << "Final Test Loss (integerized): "
+            << AvgLoss(test_set, integerized(params)) << std::endl;
+  WriteFile(tuning::Unflatten(params), epoch, step, "Final");
+}
+
+// Trains by building the evaluation graph of every record with Variable.
+// Slower than TrainWithFeatures() by orders of magnitude, but also works for
+// evaluation terms that are not linear in the parameters. The graph shares the
+// parameter variables, so batches are evaluated on one thread; only the
+// losses of whole record sets are computed in parallel.
+void TrainWithAutodiff(const Records& train_records,
+                       const Records& test_records) {
   StdEvalParams<Variable> eval_params =
       Convert<double, Variable>(BlessedParamsDbl());
   //StdEvalParams<Variable> eval_params = ZeroParams<Variable>();
   Parameters params = AsParameters(eval_params);
 
-  auto epd_records = Parse();
-  std::cout << "Records: " << epd_records.size() << std::endl;
-
-  std::random_device rd;
-  std::mt19937 g(rd());
-  std::shuffle(epd_records.begin(), epd_records.end(), g);
-
-  std::vector<EPDRecord> train_records, test_records;
-  int num_train_records = int(epd_records.size() * 0.9);
-  for (int i = 0; i < num_train_records; ++i) {
-    train_records.push_back(epd_records[i]);
-  }
-  for (size_t i = num_train_records; i < epd_records.size(); ++i) {
-    test_records.push_back(epd_records[i]);
-  }
-  epd_records.clear();
-  std::cout << "Train records size: " << train_records.size() << std::endl;
-  std::cout << "Test records size: " << test_records.size() << std::endl;
-
   //  std::cout << "Train Loss (step 0): " << AvgLoss(train_records,
   //  double_params)
   //            << std::endl;
@@ -345,12 +538,12 @@ int main() {
   int epoch = 0;
   do {
     epoch++;
-    for (const auto& record : train_records) {
-      Board board(Variant::STANDARD, record.fen);
+    for (size_t i = 0; i < train_records.size(); ++i) {
+      Board board(Variant::STANDARD, UnpackPosition(train_records[i]));
       auto score =
           standard::StaticEval<Variable, false, false>(eval_params, board);
       {
-        auto loss = Loss(score, record.result, eval_params);
+        auto loss = Loss(score, train_records[i].Result(), eval_params);
         losses.push_back(loss);
       }
       if (losses.size() >= kBatchSize) {
@@ -400,6 +593,72 @@ int main() {
               << AvgLoss(test_records, int_params) << std::endl;
     WriteFile(double_params, epoch, step, "Final");
   }
+}
+
+// Tunes the standard evaluation parameters on the packed positions of
+// kDataFile, or of the file given by "--data=FILE". "--autodiff" trains with
+// TrainWithAutodiff() instead of TrainWithFeatures(), "--stream" streams
+// features rather than keeping them in memory, and "--threads=N" sets the
+// number of threads.
+int main(int argc, char** argv) {
+  std::string data_file = kDataFile;
+  bool autodiff = false;
+  bool stream = false;
+  int num_threads = std::max(1U, std::thread::hardware_concurrency());
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const std::string data_flag = "--data=";
+    const std::string threads_flag = "--threads=";
+    if (arg == "--autodiff") {
+      autodiff = true;
+    } else if (arg == "--stream") {
+      stream = true;
+    } else if (arg.rfind(data_flag, 0) == 0) {
+      data_file = arg.substr(data_flag.size());
+    } else if (arg.rfind(threads_flag, 0) == 0) {
+      num_threads = std::max(1, std::stoi(arg.substr(threads_flag.size())));
+    } else {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+      return 1;
+    }
+  }
+  thread_pool.Resize(num_threads);
+  std::cout << "Threads: " << num_threads << std::endl;
+
+  std::unique_ptr<PackedPositionFile> file;
+  try {
+    file = std::make_unique<PackedPositionFile>(data_file);
+  } catch (const std::runtime_error& e) {
+    std::cerr << "Unable to open data file: " << e.what() << std::endl;
+    return 1;
+  }
+  if (file->Size() > UINT32_MAX) {
+    std::cerr << "Too many positions: " << file->Size() << std::endl;
+    return 1;
+  }
+  std::cout << "Records: " << file->Size() << std::endl;
+
+  std::vector<uint32_t> indices(file->Size());
+  for (size_t i = 0; i < indices.size(); ++i) {
+    indices[i] = i;
+  }
+  std::random_device rd;
+  std::mt19937 g(rd());
+  std::shuffle(indices.begin(), indices.end(), g);
+
+  const size_t num_train_records = size_t(indices.size() * 0.9);
+  const Records test_records(
+      *file, std::vector<uint32_t>(indices.begin() + num_train_records,
+                                   indices.end()));
+  indices.resize(num_train_records);
+  const Records train_records(*file, std::move(indices));
+  std::cout << "Train records size: " << train_records.size() << std::endl;
+  std::cout << "Test records size: " << test_records.size() << std::endl;
 
+  if (autodiff) {
+    TrainWithAutodiff(train_records, test_records);
+  } else {
+    TrainWithFeatures(train_records, test_records, stream);
+  }
   return 0;
 }